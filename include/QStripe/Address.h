@@ -1,11 +1,14 @@
 #pragma once
 // Qt
+#include <QJsonObject>
 #include <QObject>
 #include <QVariantMap>
 
 namespace QStripe
 {
 
+struct AddressData;
+
 class Address : public QObject
 {
     Q_OBJECT
@@ -166,8 +169,17 @@ public:
     Q_INVOKABLE void set(Address *other);
 
     /**
-     * @brief Resets every property to its default state. When the clearing is complete, `cleared()` signal will be emitted.
-     * The changes in the properties does NOT emit the related signals.
+     * @brief Changes the fields that exist in object, e.g the address of a server response. The other fields are not changed, and the changed signals are
+     * only emitted for the fields with a different value. Returns true If any field has changed.
+     * @param object
+     * @param prefix
+     * @return bool
+     */
+    bool applyJson(const QJsonObject &object, const QString &prefix = "");
+
+    /**
+     * @brief Resets every property to its default state. The changed signal of every property is emitted, even If the property was already empty. When
+     * the clearing is complete, `cleared()` signal will be emitted.
      */
     Q_INVOKABLE void clear();
 
@@ -180,6 +192,26 @@ public:
      */
     Q_INVOKABLE static Address *fromJson(const QVariantMap &data, const QString &prefix = "");
 
+    /**
+     * @brief Same as the QVariantMap overload, but reads the fields directly from the JSON object in a single pass over its keys.
+     * @param object
+     * @param prefix
+     * @return Address
+     */
+    static Address *fromJson(const QJsonObject &object, const QString &prefix = "");
+
+    /**
+     * @brief Returns the fields of this instance as a value.
+     * @return AddressData
+     */
+    AddressData data() const;
+
+    /**
+     * @brief Changes the fields of this instance to the ones in data.
+     * @param data
+     */
+    void setData(const AddressData &data);
+
     /**
      * @brief Returns an Address instance from a json string. See Address::json().
      * @param prefix See Address::json()
@@ -2,6 +2,7 @@
 // Qt
 #include <QObject>
 #include <QVector>
+#include <QDate>
 // QStripe
 #include "NetworkUtils.h"
 #include "Address.h"
@@ -11,6 +12,7 @@ namespace QStripe
 {
 
 class Token;
+struct CardData;
 
 class Card : public QObject
 {
@@ -35,6 +37,7 @@ class Card : public QObject
     Q_PROPERTY(TokenizationMethod tokenizationMethod READ tokenizationMethod WRITE setTokenizationMethod NOTIFY tokenizationMethodChanged)
     Q_PROPERTY(QVariantMap metaData READ metaData WRITE setMetaData NOTIFY metaDataChanged)
     Q_PROPERTY(QString cardNumber READ cardNumber WRITE setCardNumber NOTIFY cardNumberChanged)
+    Q_PROPERTY(QString formattedCardNumber READ formattedCardNumber NOTIFY cardNumberChanged)
 
     Q_PROPERTY(QVariantMap json READ json CONSTANT)
     Q_PROPERTY(QString jsonString READ jsonString CONSTANT)
@@ -86,7 +89,13 @@ public:
         DinersClub,
         Visa,
         MasterCard,
-        Unknown
+        Unknown,
+        // The new brands are added after Unknown so that the values of the existing ones do not change.
+        UnionPay,
+        // Maestro and Mir are not brand names used by Stripe. They are only detected from the card number, so possibleCardBrand() can return them but
+        // the brand of a card received from Stripe is never one of them.
+        Maestro,
+        Mir
     };
     Q_ENUM(CardBrand);
 
@@ -286,8 +295,17 @@ public:
      */
     QString cardNumber() const;
 
+    /**
+     * @brief Returns the digits of the card number in groups for display, e.g "3782 822463 10005" for an American Express card and
+     * "4242 4242 4242 4242" for the other brands. The characters that are not digits are left out.
+     * @return QString
+     */
+    QString formattedCardNumber() const;
+
     /**
      * @brief Set card number. This will also cause the last four digits to be changed as well. The card brand will also be reset based on the new number.
+     * If a single character is appended to or removed from the end of the number, e.g as the user types, the validity, the brand and the formatted card
+     * number are updated from that character alone.
      * @param number
      */
     void setCardNumber(const QString &number);
@@ -320,7 +338,7 @@ public:
 
     /**
      * @brief Returns the possible card brand based on the card number. This method will be automatically called whenever the card number changes to a valid
-     * one. The check can be done If the card number contains at least 4 characters.
+     * one. The check can be done If the card number contains at least 4 digits. Spaces and dashes between the digits are ignored.
      * @return CardBrand
      */
     CardBrand possibleCardBrand() const;
@@ -392,12 +410,20 @@ public:
      */
     Q_INVOKABLE void set(Card *other);
 
+    /**
+     * @brief Changes the fields that exist in object, e.g a card that is returned from the API. The other fields, including the card number and the CVC,
+     * are not changed. The changed signals are only emitted for the fields with a different value.
+     * @param object
+     */
+    void applyJson(const QJsonObject &object);
+
     /**
      * @brief If the card is valid and there's no valid Token for the instance, this will create a token and set the response to the attached token.
      * If the card is not valid, returns false.
+     * @param idempotencyKey If it is not empty, submitting the same key again does not create another token. Otherwise a new key is generated.
      * @return  bool
      */
-    Q_INVOKABLE bool createToken();
+    Q_INVOKABLE bool createToken(const QString &idempotencyKey = "");
 
     /**
      * @brief Fetches the token with the given ID. When the token is cetched, the contents of the card will be overwritten by the card that belongs to the
@@ -411,8 +437,9 @@ public:
      * You can provide the customerID here. If the parent of this instance is a Customer object, the customer ID will be fetched from that Customer.
      * If that's not the case and you provided an empty customerID, this will return false. You cannot call the create method If the card ID exists.
      * @param customerID
+     * @param idempotencyKey If it is not empty, submitting the same key again does not create another card. Otherwise a new key is generated.
      */
-    Q_INVOKABLE bool create(QString customerID = "");
+    Q_INVOKABLE bool create(QString customerID = "", const QString &idempotencyKey = "");
 
     /**
      * @brief This will only work If the card has an ID. If the ID does not exist, it will return false.
@@ -425,10 +452,38 @@ public:
     Q_INVOKABLE bool deleteCard(QString customerID = "");
 
     /**
-     * @brief Resets the properties to their defaults.
+     * @brief This will only work If the card has an ID. Sends the name, expiration date, address and metadata fields that have changed since the card was
+     * last created, fetched or updated. If none of them have changed, no request is sent and this will return false. The customer ID is found the same way as
+     * create(). When the card is updated, `updated()` signal will be emitted.
+     * @param customerID
+     * @param idempotencyKey If it is not empty, submitting the same key again does not send another update. Otherwise a new key is generated.
+     * @return bool
+     */
+    Q_INVOKABLE bool update(QString customerID = "", const QString &idempotencyKey = "");
+
+    /**
+     * @brief Returns true If any of the fields that are sent with update() has changed since the card was last created, fetched or updated.
+     * @return bool
+     */
+    Q_INVOKABLE bool isDirty() const;
+
+    /**
+     * @brief Resets the properties to their defaults. The changed signals are emitted once for the properties that had a value. Before version 2.0 the
+     * changed signal of every property was emitted, including the ones that were already empty.
      */
     Q_INVOKABLE void clear();
 
+    /**
+     * @brief Starts a batch of changes. Until the matching endUpdate() is called, the changed signals are not emitted. Instead, each of the changed
+     * signals is emitted once when the batch ends. The calls can be nested, and the signals are emitted when the outermost batch ends.
+     */
+    Q_INVOKABLE void beginUpdate();
+
+    /**
+     * @brief Ends the batch that is started with beginUpdate(), and emits the changed signals for the properties that have changed during the batch.
+     */
+    Q_INVOKABLE void endUpdate();
+
     /**
      * @brief Returns the last ocurred error.
      * @return const Error *
@@ -449,6 +504,24 @@ public:
      */
     Q_INVOKABLE static CardBrand cardBrandType(const QString &name);
 
+    /**
+     * @brief Returns the card brand for the first digits of a card number. prefix is the number that is formed by the first digitCount digits, e.g 3714
+     * for an American Express card. At least 4 and at most 6 digits are used. Otherwise, the brand is unknown. possibleCardBrand() uses this method.
+     * @param prefix
+     * @param digitCount
+     * @return CardBrand
+     */
+    static CardBrand cardBrandForPrefix(int prefix, int digitCount);
+
+    /**
+     * @brief Returns true If a card number of the given brand can have length digits. Some brands have more than one valid length, e.g a Maestro card can
+     * have between 12 and 19 digits.
+     * @param brand
+     * @param length
+     * @return bool
+     */
+    static bool validCardNumberLength(CardBrand brand, int length);
+
     /**
      * @brief Returns the string representation of the funding type.
      * @param type
@@ -498,6 +571,26 @@ public:
      */
     Q_INVOKABLE static Card *fromJson(const QVariantMap &data);
 
+    /**
+     * @brief Same as the QVariantMap overload, but reads the fields directly from the JSON object in a single pass over its keys.
+     * @param object
+     * @return Card*
+     */
+    static Card *fromJson(const QJsonObject &object);
+
+    /**
+     * @brief Returns a Card instance with the fields in data. Use this to create a Card only when it is needed, e.g for a QML view.
+     * @param data
+     * @return Card*
+     */
+    static Card *fromData(const CardData &data);
+
+    /**
+     * @brief Returns the fields of this instance as a value. The card number and the CVC are not included.
+     * @return CardData
+     */
+    CardData data() const;
+
     /**
      * @brief Returns a Card instance from the json string.
      * @param dataStr
@@ -619,6 +712,11 @@ signals:
      */
     void deleted();
 
+    /**
+     * @brief Emitted when the card is updated.
+     */
+    void updated();
+
     /**
      * @brief Emitted when validCardLenght changes.
      */
@@ -682,6 +780,15 @@ private:
     TokenizationMethod m_TokenizationMethod;
     QVariantMap m_MetaData;
     QString m_CardNumber;
+    // These are updated incrementally as the card number changes. See updateCardNumberState().
+    int m_LuhnSum,
+        m_ShiftedLuhnSum,
+        m_CardNumberDigitCount,
+        m_CardNumberNonDigitCount,
+        m_BrandPrefix,
+        m_BrandPrefixDigitCount;
+    bool m_IsBrandPrefixClosed;
+    QString m_FormattedCardNumber;
 
     QString m_CVC;
     Token *m_Token;
@@ -700,27 +807,37 @@ private:
          m_IsValidExpirationYear,
          m_IsValidCVC;
 
+    using ChangedSignal = void (Card::*)();
+    int m_UpdateDepth;
+    QVector<ChangedSignal> m_PendingSignals;
+
+    // The fields that are sent with update(). The setters mark them when they change, and they are cleared when the card is synced with Stripe.
+    enum DirtyField {
+        DirtyNone = 0x0,
+        DirtyName = 0x1,
+        DirtyExpirationMonth = 0x2,
+        DirtyExpirationYear = 0x4,
+        DirtyMetadata = 0x8
+    };
+
+    int m_DirtyFields;
+    // The values on Stripe. The removed metadata keys are sent as empty strings, and the address can also be changed through address() without calling
+    // setAddress(), so these are used to find the changes.
+    QVariantMap m_SyncedMetadata,
+                m_SyncedAddress;
+
 private:
+    /**
+     * @brief Emits changedSignal, or queues it until the end of the batch If beginUpdate() is called.
+     * @param changedSignal
+     */
+    void notify(ChangedSignal changedSignal);
     /**
      * @brief Card ID can only be changed internally.
      * @param id
      */
     void setCardID(const QString &id);
 
-    /**
-     * @brief Returns the card number prefixes for the brand.
-     * Card number prefixes are based on http://en.wikipedia.org/wiki/Bank_card_number#Issuer_identification_number_.28IIN.29
-     * @return QVector<QString>
-     */
-    QVector<QString> prefixes(CardBrand brand) const;
-
-    /**
-     * @brief Returns the max card number length based on the brand.
-     * @param brand
-     * @return int
-     */
-    int maxCardNumberLenght(CardBrand brand) const;
-
     /**
      * @brief Returns the maximum CVC number length for the given brand.
      * @param brand
@@ -771,7 +888,7 @@ private:
     void setValidCVC(bool valid);
 
     /**
-     * @brief This is connected to the cardNumberChanged() signal. And it udates the brand.
+     * @brief This is called when the card number changes. And it udates the brand.
      */
     void updateCardBrand();
 
@@ -781,6 +898,31 @@ private:
      */
     QVariantMap jsonForTokenCreation() const;
 
+    /**
+     * @brief Returns only the fields that have changed since the last sync. This is sent with update().
+     * @return QVariantMap
+     */
+    QVariantMap updateData() const;
+
+    /**
+     * @brief Changes the fields of this instance to the ones in data through the setters, so the changed signals are only emitted for the fields with a
+     * different value.
+     * @param data
+     */
+    void applyData(const CardData &data);
+
+    /**
+     * @brief Marks field as changed.
+     * @param field
+     */
+    void markDirty(DirtyField field);
+
+    /**
+     * @brief Clears the changed fields, and keeps the current metadata and address as the values on Stripe. This is called after the card is created,
+     * fetched or updated.
+     */
+    void markSynced();
+
     /**
      * @brief If the parent of this instance is a Customer object, returns the ID of that customer. Otherwise returns an empty string.
      * @return QString
@@ -790,9 +932,43 @@ private:
     /**
      * @brief Returns the >four digit year for the expiration year.
      * @param year
+     * @param today
      * @return
      */
-    int normilizedYear(int year) const;
+    int normilizedYear(int year, const QDate &today) const;
+
+    /**
+     * @brief Updates the Luhn sums, the brand prefix and the formatted card number after the card number is changed from previousNumber. If only the last
+     * character is appended or removed, only that character is processed. Otherwise, the whole card number is processed again.
+     * @param previousNumber
+     */
+    void updateCardNumberState(const QString &previousNumber);
+
+    /**
+     * @brief Updates the card number state for a character that is appended to the end of the card number.
+     * @param character
+     */
+    void appendCardNumberCharacter(QChar character);
+
+    /**
+     * @brief Updates the card number state for a character that is removed from the end of the card number. If the state cannot be updated from the
+     * character alone, returns false.
+     * @param character
+     * @return bool
+     */
+    bool removeCardNumberCharacter(QChar character);
+
+    /**
+     * @brief Processes the whole card number again.
+     */
+    void resetCardNumberState();
+
+    /**
+     * @brief Returns the value that is added to the Luhn sum for a digit that is doubled.
+     * @param digit
+     * @return int
+     */
+    static int doubledLuhnDigit(int digit);
 };
 
 }
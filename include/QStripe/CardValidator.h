@@ -0,0 +1,82 @@
+#pragma once
+// Qt
+#include <QByteArray>
+#include <QBitArray>
+#include <QVector>
+#include <QDate>
+// QStripe
+#include "Card.h"
+
+namespace QStripe
+{
+
+/**
+ * @brief CardValidator validates a large number of card numbers without creating a Card for each of them, e.g when the cards on file are imported from
+ * another payment processor. The card numbers are contiguous ASCII buffers that only contain digits. The brand is found with Card::cardBrandForPrefix(), so
+ * the results match the Card validation. The rows are split into chunks that are validated in parallel with QtConcurrent.
+ */
+class CardValidator
+{
+public:
+    struct Row {
+        Row();
+        Row(const QByteArray &_number, int _expirationMonth, int _expirationYear);
+
+        // Only the digits of the card number, e.g "4242424242424242".
+        QByteArray number;
+        int expirationMonth;
+        // This can be a 2 digit or 4 digit number.
+        int expirationYear;
+    };
+
+    /**
+     * @brief Returns true If the given digits pass the Luhn check. If any of the characters is not a digit, returns false.
+     * @param digits
+     * @param length
+     * @return bool
+     */
+    static bool validLuhn(const char *digits, int length);
+
+    /**
+     * @brief Returns true If number passes the Luhn check and its length is valid for its brand. This is the same check as Card::validCardNumber().
+     * @param number
+     * @return bool
+     */
+    static bool validCardNumber(const QByteArray &number);
+
+    /**
+     * @brief Returns true If the card number and the expiration date of the row are valid. This is the same check as Card::validCard(), except for the CVC
+     * which is not stored for the cards on file. today is used to check If the card is expired.
+     * @param row
+     * @param today
+     * @return bool
+     */
+    static bool validRow(const Row &row, const QDate &today);
+
+    /**
+     * @brief Validates each of the rows. Bit n of the returned array is set If the row at index n is valid. This blocks until all of the rows are validated.
+     * @param rows
+     * @return QBitArray
+     */
+    static QBitArray validate(const QVector<Row> &rows);
+
+    /**
+     * @brief Validates each of the card numbers with validCardNumber(). Bit n of the returned array is set If the card number at index n is valid. This blocks
+     * until all of the card numbers are validated.
+     * @param numbers
+     * @return QBitArray
+     */
+    static QBitArray validateCardNumbers(const QVector<QByteArray> &numbers);
+
+private:
+    /**
+     * @brief Calls check for each index between 0 and count in parallel, and returns the results as a bit array.
+     * @param count
+     * @param check
+     * @return QBitArray
+     */
+    template<typename Check>
+    static QBitArray validateInParallel(int count, Check check);
+};
+
+}
@@ -3,6 +3,7 @@
 #include <QQmlListProperty>
 #include <QObject>
 #include <QVector>
+#include <QTimer>
 // QStripe
 #include "ShippingInformation.h"
 #include "NetworkUtils.h"
@@ -12,6 +13,8 @@
 namespace QStripe
 {
 
+struct CustomerData;
+
 class Customer : public QObject
 {
     Q_OBJECT
@@ -28,6 +31,9 @@ class Customer : public QObject
     Q_PROPERTY(bool deleted READ deleted CONSTANT)
     Q_PROPERTY(QQmlListProperty<QStripe::Card> cards READ cards)
 
+    Q_PROPERTY(bool autoSave READ autoSave WRITE setAutoSave NOTIFY autoSaveChanged)
+    Q_PROPERTY(int autoSaveInterval READ autoSaveInterval WRITE setAutoSaveInterval NOTIFY autoSaveIntervalChanged)
+
     Q_CLASSINFO("DefaultProperty", "cards")
 
 public:
@@ -128,6 +134,32 @@ public:
      */
     bool deleted() const;
 
+    /**
+     * @brief If true, the changes are saved with update() once no other change is made for autoSaveInterval milliseconds. The changes that are made in
+     * quick succession are sent with a single update. If the update fails because of a network error, a conflict or a server error, the changes are sent
+     * again after the interval. This only works for a customer that has an ID. The default value is false.
+     * @return bool
+     */
+    bool autoSave() const;
+
+    /**
+     * @brief Set autoSave.
+     * @param enabled
+     */
+    void setAutoSave(bool enabled);
+
+    /**
+     * @brief Returns the number of milliseconds to wait after the last change before the changes are saved. The default value is 500.
+     * @return int
+     */
+    int autoSaveInterval() const;
+
+    /**
+     * @brief Set autoSaveInterval.
+     * @param interval
+     */
+    void setAutoSaveInterval(int interval);
+
     /**
      * @brief Sett shipping information.
      * @param shippingInformation
@@ -155,6 +187,27 @@ public:
      */
     Q_INVOKABLE static Customer *fromJson(const QVariantMap &data);
 
+    /**
+     * @brief Same as the QVariantMap overload, but reads the fields directly from the JSON object in a single pass over its keys. This is used for the
+     * network replies.
+     * @param object
+     * @return Customer *
+     */
+    static Customer *fromJson(const QJsonObject &object);
+
+    /**
+     * @brief Returns a Customer instance with the fields in data. Use this to create a Customer only when it is needed, e.g for a QML view.
+     * @param data
+     * @return Customer *
+     */
+    static Customer *fromData(const CustomerData &data);
+
+    /**
+     * @brief Returns the fields of this instance as a value. The cards are not included.
+     * @return CustomerData
+     */
+    CustomerData data() const;
+
     /**
      * @brief Returns a Customer instance from the given dataStr.
      * @param dataStr
@@ -168,20 +221,37 @@ public:
      */
     Q_INVOKABLE void set(Customer *other);
 
+    /**
+     * @brief Changes the fields that exist in object, e.g a customer that is returned from the API. The other fields are not changed, and the changed
+     * signals are only emitted for the fields with a different value.
+     * @param object
+     */
+    void applyJson(const QJsonObject &object);
+
     /**
      * @brief If this instance does not have an assosicated customer ID, you can create a new customer. When the customer is created, the customer ID of this
      * instance will change accordingly. If the customer instance does not have a valid ID, you can create the customer and this function will return true.
      * If the instance already has a customer ID, this will return false and do nothing. When the customer is created, `created()` signal will be emitted.
+     * @param idempotencyKey If it is not empty, submitting the same key again does not create another customer. Otherwise a new key is generated.
+     * @return bool
+     */
+    Q_INVOKABLE bool create(const QString &idempotencyKey = "");
+
+    /**
+     * @brief If the customer instance has an ID, this method will send the fields that have changed since the customer was last created, fetched or updated,
+     * and update the remote. If there's no customer ID present or none of the fields have changed, no request is sent and this method will return false.
+     * When the customer is updated, `updated()` signal will be emitted. Only one update is sent at a time. If an update is already in flight, this returns
+     * true and the changes are sent when it finishes.
+     * @param idempotencyKey If it is not empty, submitting the same key again does not send another update. Otherwise a new key is generated.
      * @return bool
      */
-    Q_INVOKABLE bool create();
+    Q_INVOKABLE bool update(const QString &idempotencyKey = "");
 
     /**
-     * @brief If the customer instance has an ID, this method will send the current details of the instance and update the remote. If there's no customer ID
-     * present, this method will return false. When the customer is updated, `updated()` signal will be emitted.
+     * @brief Returns true If any of the fields that are sent with update() has changed since the customer was last created, fetched or updated.
      * @return bool
      */
-    Q_INVOKABLE bool update();
+    Q_INVOKABLE bool isDirty() const;
 
     /**
      * @brief If the customer instance has an ID, this method will send the current details of the instance and delete the remote. If there's no customer ID
@@ -192,11 +262,22 @@ public:
     Q_INVOKABLE bool deleteCustomer();
 
     /**
-     * @brief Resets every property to its default state. When the clearing is complete, `cleared()` signal will be emitted.
-     * The changes in the properties does NOT emit the related signals.
+     * @brief Resets every property to its default state. The changed signals are emitted once for the properties that had a value, and then `cleared()`
+     * signal will be emitted. Before version 2.0 the changed signal of every property was emitted, including the ones that were already empty.
      */
     Q_INVOKABLE void clear();
 
+    /**
+     * @brief Starts a batch of changes. Until the matching endUpdate() is called, the changed signals are not emitted. Instead, each of the changed
+     * signals is emitted once when the batch ends. The calls can be nested, and the signals are emitted when the outermost batch ends.
+     */
+    Q_INVOKABLE void beginUpdate();
+
+    /**
+     * @brief Ends the batch that is started with beginUpdate(), and emits the changed signals for the properties that have changed during the batch.
+     */
+    Q_INVOKABLE void endUpdate();
+
     /**
      * @brief Returns the list of customer currently attached to this instance.
      * @return QQmlListProperty<cards>
@@ -301,6 +382,16 @@ signals:
      */
     void cleared();
 
+    /**
+     * @brief Emitted when autoSave changes.
+     */
+    void autoSaveChanged();
+
+    /**
+     * @brief Emitted when autoSaveInterval changes.
+     */
+    void autoSaveIntervalChanged();
+
 private:
     QString m_CustomerID,
             m_DefaultSource,
@@ -316,7 +407,37 @@ private:
     Error m_Error;
     QVector<Card *> m_Cards;
 
+    using ChangedSignal = void (Customer::*)();
+    int m_UpdateDepth;
+    QVector<ChangedSignal> m_PendingSignals;
+
+    // The fields that are sent with update(). The setters mark them when they change, and they are cleared when the customer is synced with Stripe.
+    enum DirtyField {
+        DirtyNone = 0x0,
+        DirtyDefaultSource = 0x1,
+        DirtyEmail = 0x2,
+        DirtyDescription = 0x4,
+        DirtyMetadata = 0x8
+    };
+
+    int m_DirtyFields;
+    // The values on Stripe. The removed metadata keys are sent as empty strings, and the shipping information can also be changed through
+    // shippingInformation() without calling setShippingInformation(), so these are used to find the changes.
+    QVariantMap m_SyncedMetadata,
+                m_SyncedShipping;
+
+    QTimer m_AutoSaveTimer;
+    bool m_IsAutoSave;
+    // Only one update is in flight at a time. The update() calls that are made during the flight are sent once it finishes.
+    bool m_IsUpdateInFlight,
+         m_IsUpdateQueued;
+
 private:
+    /**
+     * @brief Emits changedSignal, or queues it until the end of the batch If beginUpdate() is called.
+     * @param changedSignal
+     */
+    void notify(ChangedSignal changedSignal);
     /**
      * @brief Customer ID cannot be changed from the outside.
      * @param id
@@ -329,6 +450,53 @@ private:
      */
     void setDeleted(bool deleted);
 
+    /**
+     * @brief Returns the fields that are sent when the customer is created or updated.
+     * @return QVariantMap
+     */
+    QVariantMap requestData() const;
+
+    /**
+     * @brief Returns the shipping information in the format that is sent when the customer is created or updated.
+     * @return QVariant
+     */
+    QVariant shippingRequestData() const;
+
+    /**
+     * @brief Returns only the fields that have changed since the last sync. This is sent with update().
+     * @return QVariantMap
+     */
+    QVariantMap updateData() const;
+
+    /**
+     * @brief Changes the fields of this instance to the ones in data through the setters, so the changed signals are only emitted for the fields with a
+     * different value.
+     * @param data
+     */
+    void applyData(const CustomerData &data);
+
+    /**
+     * @brief Marks field as changed.
+     * @param field
+     */
+    void markDirty(DirtyField field);
+
+    /**
+     * @brief Clears the changed fields, and keeps the current metadata and shipping information as the values on Stripe. This is called after the customer
+     * is created, fetched or updated.
+     */
+    void markSynced();
+
+    /**
+     * @brief Restarts the auto save timer If autoSave is enabled.
+     */
+    void scheduleAutoSave();
+
+    /**
+     * @brief Called when the auto save timer times out. Calls update() If there are any changes.
+     */
+    void autoSaveTimeout();
+
     /**
      * @brief Append function for QQmlListProperty.
      * @param list
@@ -0,0 +1,88 @@
+#pragma once
+// Qt
+#include <QLatin1String>
+#include <QString>
+
+namespace QStripe
+{
+
+/**
+ * @brief An entry of an enum table. The name is a string literal, and its length is calculated at compile time.
+ */
+template<typename Enum>
+struct EnumName {
+    constexpr EnumName(Enum _value, const char *_name)
+        : value(_value)
+        , name(_name)
+        , length(stringLength(_name))
+    {
+    }
+
+    static constexpr int stringLength(const char *str)
+    {
+        return *str == '\0' ? 0 : 1 + stringLength(str + 1);
+    }
+
+    Enum value;
+    const char *name;
+    int length;
+};
+
+/**
+ * @brief EnumTable converts the enums to the names used by the Stripe API and back, using a `static constexpr EnumName<Enum>[]` table, e.g
+ *
+ *     static constexpr EnumName<Token::Type> TOKEN_TYPES[] = {
+ *         {Token::TypeCard, "card"},
+ *         {Token::TypeUnknown, "unknown"}
+ *     };
+ *
+ *     Token::Type type = EnumTable::value(TOKEN_TYPES, name, Token::TypeUnknown);
+ *
+ * The names are compared with their lengths first and then as Latin-1, so the lookup itself does not allocate. The name that is passed in still has to
+ * be a QString: When an enum field is parsed from JSON, reading the value out of the QJsonObject creates that string, so parsing a field is not free
+ * of allocations.
+ */
+class EnumTable
+{
+public:
+    /**
+     * @brief Returns the enum value for name. If the name does not exist in table, returns defaultValue.
+     * @param table
+     * @param name
+     * @param defaultValue
+     * @return Enum
+     */
+    template<typename Enum, int Size>
+    static Enum value(const EnumName<Enum> (&table)[Size], const QString &name, Enum defaultValue)
+    {
+        const int length = name.length();
+        for (const EnumName<Enum> &entry : table) {
+            if (entry.length == length && name == QLatin1String(entry.name, entry.length)) {
+                return entry.value;
+            }
+        }
+
+        return defaultValue;
+    }
+
+    /**
+     * @brief Returns the name of value. If the value does not exist in table, returns defaultName.
+     * @param table
+     * @param value
+     * @param defaultName
+     * @return QLatin1String
+     */
+    template<typename Enum, int Size>
+    static QLatin1String name(const EnumName<Enum> (&table)[Size], Enum value, QLatin1String defaultName = QLatin1String(""))
+    {
+        for (const EnumName<Enum> &entry : table) {
+            if (entry.value == value) {
+                return QLatin1String(entry.name, entry.length);
+            }
+        }
+
+        return defaultName;
+    }
+};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 // Qt
+#include <QJsonObject>
 #include <QVariantMap>
 #include <QObject>
 
@@ -180,6 +181,28 @@ public:
      */
     Q_INVOKABLE QString declineCodeNextSteps(QString declineCode = "", bool omitSensitive = true) const;
 
+    /**
+     * @brief Returns true If the reason of the decline should not be shown to the customer, e.g for stolen_card. For these decline codes,
+     * declineCodeDescription() and declineCodeNextSteps() return the generic texts unless omitSensitive is false.
+     * @param declineCode If it is empty, the decline code of this instance is used.
+     * @return bool
+     */
+    Q_INVOKABLE bool declineCodeSensitive(QString declineCode = "") const;
+
+    /**
+     * @brief Returns true If the same payment can be attempted again without any changes from the customer, e.g for try_again_later and
+     * processing_error. If the decline code is unknown, returns false.
+     * @param declineCode If it is empty, the decline code of this instance is used.
+     * @return bool
+     */
+    Q_INVOKABLE bool declineCodeRetryable(QString declineCode = "") const;
+
+    /**
+     * @brief The translated decline code texts are cached for each locale the first time they are used. Call this after a new QTranslator is installed
+     * for the current locale so that the texts are translated again.
+     */
+    static void clearDeclineCodeTranslations();
+
     /**
      * @brief Converts the string to the associated ErrorType.
      * @param typeString
@@ -204,6 +227,14 @@ public:
      */
     void set(QVariantMap errorResponse, int httpCode = -1, int networkErrorCode = -1);
 
+    /**
+     * @brief Same as the QVariantMap overload, but reads the fields directly from the JSON object.
+     * @param errorResponse
+     * @param httpCode
+     * @param networkErrorCode
+     */
+    void set(QJsonObject errorResponse, int httpCode = -1, int networkErrorCode = -1);
+
     /**
      * @brief Resets the properties to the default.
      */
@@ -0,0 +1,441 @@
+#pragma once
+// std
+#include <functional>
+#include <type_traits>
+// Qt
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QVariantMap>
+#include <QDateTime>
+#include <QVector>
+#include <QHash>
+
+namespace QStripe
+{
+
+/**
+ * @brief FieldSchema describes the fields of one of the structs in ModelData.h. The schema is built once, and the same definition is used to read the struct
+ * from JSON, to write it back as JSON or as form data and to compare two structs, e.g
+ *
+ *     static const FieldSchema<TokenData> schema = FieldSchema<TokenData>()
+ *         .add(Token::FIELD_ID, &TokenData::tokenID)
+ *         .addEnum(Token::FIELD_TYPE, &TokenData::type, &Token::typeName, &Token::typeEnum, Token::TypeUnknown);
+ *
+ * All of the keys, including the prefixed ones, are created when the schema is built so writing a struct does not build any key strings except for the
+ * entries of the map fields in form data.
+ */
+template<typename Data>
+class FieldSchema
+{
+public:
+    struct Field {
+        QString key;
+        // The map fields are written as `key[entry]` in form data. This is the `key[` part.
+        QString flattenedPrefix;
+        bool isMap;
+        // If true, the field is not written when it is empty even If omitEmpty is false, e.g the ID of a customer that is not created yet.
+        bool alwaysOmitEmpty;
+
+        std::function<QVariant(const Data &)> value;
+        std::function<void(Data &, const QJsonValue &)> read;
+        std::function<bool(const Data &)> isEmpty;
+        std::function<bool(const Data &, const Data &)> equals;
+    };
+
+    /**
+     * @brief Adds a field that is stored in member. The supported types are QString, int, bool, QVariantMap and QDateTime. The date is written as seconds
+     * since epoch.
+     * @param key
+     * @param member
+     * @return FieldSchema &
+     */
+    template<typename T>
+    FieldSchema &add(const QString &key, T Data::*member)
+    {
+        Field field = createField(key);
+        field.isMap = std::is_same<T, QVariantMap>::value;
+        field.value = [member](const Data &data) {
+            return toVariant(data.*member);
+        };
+        field.read = [member](Data &data, const QJsonValue &value) {
+            readValue(value, data.*member);
+        };
+        field.isEmpty = [member](const Data &data) {
+            return emptyValue(data.*member);
+        };
+        field.equals = [member](const Data &first, const Data &second) {
+            return first.*member == second.*member;
+        };
+
+        return append(field);
+    }
+
+    /**
+     * @brief Adds an enum field that is written with its API name. The field is empty when its value is emptyValue.
+     * @param key
+     * @param member
+     * @param name
+     * @param value
+     * @param emptyValue
+     * @return FieldSchema &
+     */
+    template<typename Enum>
+    FieldSchema &addEnum(const QString &key, Enum Data::*member, QString (*name)(Enum), Enum (*value)(const QString &), Enum emptyValue)
+    {
+        addEnum(key, member, name, value);
+        m_Fields.last().isEmpty = [member, emptyValue](const Data &data) {
+            return data.*member == emptyValue;
+        };
+
+        return *this;
+    }
+
+    /**
+     * @brief Adds an enum field that is never empty, e.g the zip check of an address which is always written as `unknown` If it is not checked. The
+     * JSON value is read as a QString before it is passed to value(), so reading the field allocates the string even though the lookup does not.
+     * @param key
+     * @param member
+     * @param name
+     * @param value
+     * @return FieldSchema &
+     */
+    template<typename Enum>
+    FieldSchema &addEnum(const QString &key, Enum Data::*member, QString (*name)(Enum), Enum (*value)(const QString &))
+    {
+        Field field = createField(key);
+        field.value = [member, name](const Data &data) {
+            return QVariant(name(data.*member));
+        };
+        field.read = [member, value](Data &data, const QJsonValue &json) {
+            data.*member = value(json.toString());
+        };
+        field.isEmpty = [](const Data &) {
+            return false;
+        };
+        field.equals = [member](const Data &first, const Data &second) {
+            return first.*member == second.*member;
+        };
+
+        return append(field);
+    }
+
+    /**
+     * @brief Adds the fields of inner to this schema. The fields are written to the same object, e.g the `address_` fields of a card. The keys are used as
+     * they are in inner, so inner should be created with the prefix.
+     * @param member
+     * @param inner
+     * @return FieldSchema &
+     */
+    template<typename Inner>
+    FieldSchema &addEmbedded(Inner Data::*member, const FieldSchema<Inner> &inner)
+    {
+        for (const typename FieldSchema<Inner>::Field &innerField : inner.fields()) {
+            Field field = createField(innerField.key);
+            field.flattenedPrefix = innerField.flattenedPrefix;
+            field.isMap = innerField.isMap;
+            field.alwaysOmitEmpty = innerField.alwaysOmitEmpty;
+
+            field.value = [member, innerField](const Data &data) {
+                return innerField.value(data.*member);
+            };
+            field.read = [member, innerField](Data &data, const QJsonValue &value) {
+                innerField.read(data.*member, value);
+            };
+            field.isEmpty = [member, innerField](const Data &data) {
+                return innerField.isEmpty(data.*member);
+            };
+            field.equals = [member, innerField](const Data &first, const Data &second) {
+                return innerField.equals(first.*member, second.*member);
+            };
+
+            append(field);
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief Adds a field that is written as a nested object with the fields of inner, e.g the `shipping` of a customer. The field is empty when all of the
+     * fields of inner are empty. Use setEmptyCheck() to change this.
+     * @param key
+     * @param member
+     * @param inner
+     * @return FieldSchema &
+     */
+    template<typename Inner>
+    FieldSchema &addNested(const QString &key, Inner Data::*member, const FieldSchema<Inner> &inner)
+    {
+        Field field = createField(key);
+        field.value = [member, inner](const Data &data) {
+            return QVariant(inner.variantMap(data.*member));
+        };
+        field.read = [member, inner](Data &data, const QJsonValue &value) {
+            data.*member = Inner();
+            inner.read(data.*member, value.toObject());
+        };
+        field.isEmpty = [member, inner](const Data &data) {
+            return inner.isEmpty(data.*member);
+        };
+        field.equals = [member, inner](const Data &first, const Data &second) {
+            return inner.equals(first.*member, second.*member);
+        };
+
+        return append(field);
+    }
+
+    /**
+     * @brief Makes the last added field omitted when it is empty, regardless of omitEmpty.
+     * @return FieldSchema &
+     */
+    FieldSchema &alwaysOmitEmpty()
+    {
+        m_Fields.last().alwaysOmitEmpty = true;
+        return *this;
+    }
+
+    /**
+     * @brief Replaces the empty check of the last added field.
+     * @param isEmpty
+     * @return FieldSchema &
+     */
+    FieldSchema &setEmptyCheck(std::function<bool(const Data &)> isEmpty)
+    {
+        m_Fields.last().isEmpty = std::move(isEmpty);
+        return *this;
+    }
+
+    /**
+     * @brief Reads the fields in object into data. The keys that are not in the schema are ignored.
+     * @param data
+     * @param object
+     */
+    void read(Data &data, const QJsonObject &object) const
+    {
+        for (auto it = object.constBegin(); it != object.constEnd(); it++) {
+            const int index = m_FieldIndexes.value(it.key(), -1);
+            if (index > -1) {
+                m_Fields.at(index).read(data, it.value());
+            }
+        }
+    }
+
+    /**
+     * @brief Writes the fields of data to object. If omitEmpty is true, the empty fields are not written.
+     * @param object
+     * @param data
+     * @param omitEmpty
+     */
+    void writeJson(QJsonObject &object, const Data &data, bool omitEmpty = false) const
+    {
+        for (const Field &field : m_Fields) {
+            if (omitted(field, data, omitEmpty) == false) {
+                object.insert(field.key, QJsonValue::fromVariant(field.value(data)));
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the fields of data as a JSON object.
+     * @param data
+     * @param omitEmpty
+     * @return QJsonObject
+     */
+    QJsonObject json(const Data &data, bool omitEmpty = false) const
+    {
+        QJsonObject object;
+        writeJson(object, data, omitEmpty);
+        return object;
+    }
+
+    /**
+     * @brief Returns the fields of data as a variant map. The map fields are nested maps.
+     * @param data
+     * @param omitEmpty
+     * @return QVariantMap
+     */
+    QVariantMap variantMap(const Data &data, bool omitEmpty = false) const
+    {
+        QVariantMap map;
+        for (const Field &field : m_Fields) {
+            if (omitted(field, data, omitEmpty) == false) {
+                map.insert(field.key, field.value(data));
+            }
+        }
+
+        return map;
+    }
+
+    /**
+     * @brief Returns the fields of data as form data. This is the same as variantMap(), except that the entries of the map fields are written as
+     * `key[entry]`, e.g `metadata[order_id]`. Stripe does not accept nested values in these fields, so the entries with a map or list value are skipped.
+     * @param data
+     * @param omitEmpty
+     * @return QVariantMap
+     */
+    QVariantMap formData(const Data &data, bool omitEmpty = false) const
+    {
+        QVariantMap map;
+        for (const Field &field : m_Fields) {
+            if (omitted(field, data, omitEmpty)) {
+                continue;
+            }
+
+            if (field.isMap) {
+                const QVariantMap entries = field.value(data).toMap();
+                for (auto it = entries.constBegin(); it != entries.constEnd(); it++) {
+                    const QVariant::Type type = it.value().type();
+                    if (type != QVariant::Map && type != QVariant::List) {
+                        map.insert(field.flattenedPrefix + it.key() + QLatin1Char(']'), it.value());
+                    }
+                }
+            }
+            else {
+                map.insert(field.key, field.value(data));
+            }
+        }
+
+        return map;
+    }
+
+    /**
+     * @brief Returns true If all of the fields of first and second are equal.
+     * @param first
+     * @param second
+     * @return bool
+     */
+    bool equals(const Data &first, const Data &second) const
+    {
+        for (const Field &field : m_Fields) {
+            if (field.equals(first, second) == false) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Returns true If all of the fields of data are empty.
+     * @param data
+     * @return bool
+     */
+    bool isEmpty(const Data &data) const
+    {
+        for (const Field &field : m_Fields) {
+            if (field.isEmpty(data) == false) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const QVector<Field> &fields() const
+    {
+        return m_Fields;
+    }
+
+private:
+    QVector<Field> m_Fields;
+    QHash<QString, int> m_FieldIndexes;
+
+private:
+    static Field createField(const QString &key)
+    {
+        Field field;
+        field.key = key;
+        field.flattenedPrefix = key + QLatin1Char('[');
+        field.isMap = false;
+        field.alwaysOmitEmpty = false;
+        return field;
+    }
+
+    FieldSchema &append(const Field &field)
+    {
+        m_FieldIndexes.insert(field.key, m_Fields.size());
+        m_Fields.append(field);
+        return *this;
+    }
+
+    static bool omitted(const Field &field, const Data &data, bool omitEmpty)
+    {
+        return (omitEmpty || field.alwaysOmitEmpty) && field.isEmpty(data);
+    }
+
+    static QVariant toVariant(const QString &value)
+    {
+        return value;
+    }
+
+    static QVariant toVariant(int value)
+    {
+        return value;
+    }
+
+    static QVariant toVariant(bool value)
+    {
+        return value;
+    }
+
+    static QVariant toVariant(const QVariantMap &value)
+    {
+        return value;
+    }
+
+    static QVariant toVariant(const QDateTime &value)
+    {
+        return value.toSecsSinceEpoch();
+    }
+
+    static void readValue(const QJsonValue &json, QString &value)
+    {
+        value = json.toString();
+    }
+
+    static void readValue(const QJsonValue &json, int &value)
+    {
+        value = json.toInt();
+    }
+
+    static void readValue(const QJsonValue &json, bool &value)
+    {
+        value = json.toBool();
+    }
+
+    static void readValue(const QJsonValue &json, QVariantMap &value)
+    {
+        value = json.toObject().toVariantMap();
+    }
+
+    static void readValue(const QJsonValue &json, QDateTime &value)
+    {
+        value = QDateTime::fromSecsSinceEpoch(static_cast<qint64>(json.toDouble()));
+    }
+
+    static bool emptyValue(const QString &value)
+    {
+        return value.isEmpty();
+    }
+
+    static bool emptyValue(int value)
+    {
+        return value <= 0;
+    }
+
+    static bool emptyValue(bool value)
+    {
+        return value == false;
+    }
+
+    static bool emptyValue(const QVariantMap &value)
+    {
+        return value.isEmpty();
+    }
+
+    static bool emptyValue(const QDateTime &value)
+    {
+        return value.isValid() == false;
+    }
+};
+
+}
@@ -0,0 +1,220 @@
+#pragma once
+// Qt
+#include <QJsonArray>
+#include <QDateTime>
+#include <QPointer>
+#include <QObject>
+#include <QVector>
+// QStripe
+#include "NetworkUtils.h"
+#include "Error.h"
+
+namespace QStripe
+{
+
+/**
+ * @brief ListIterator enumerates the customers, or the cards of a customer, page by page. It follows the `has_more` and `starting_after` cursors of the
+ * Stripe list endpoints and emits each page as soon as it is requested and available. While a page is being processed, the next page is already being
+ * fetched. Only the current page is kept in memory: The objects of a page are children of the iterator and they are deleted when the next page is emitted.
+ * If you want to keep an object, change its parent.
+ */
+class ListIterator : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(ObjectType objectType READ objectType WRITE setObjectType NOTIFY objectTypeChanged)
+    Q_PROPERTY(QString customerID READ customerID WRITE setCustomerID NOTIFY customerIDChanged)
+    Q_PROPERTY(int limit READ limit WRITE setLimit NOTIFY limitChanged)
+    Q_PROPERTY(QDateTime createdAfter READ createdAfter WRITE setCreatedAfter NOTIFY createdAfterChanged)
+    Q_PROPERTY(QDateTime createdBefore READ createdBefore WRITE setCreatedBefore NOTIFY createdBeforeChanged)
+
+    Q_PROPERTY(bool hasMore READ hasMore NOTIFY hasMoreChanged)
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+
+public:
+    enum ObjectType {
+        ObjectCustomer = 0, // Lists the customers. Each page contains Customer instances.
+        ObjectCard // Lists the cards of the customer with customerID. Each page contains Card instances.
+    };
+    Q_ENUM(ObjectType)
+
+public:
+    explicit ListIterator(QObject *parent = nullptr);
+
+    /**
+     * @brief Returns the type of the listed objects. The default value is ObjectCustomer.
+     * @return ObjectType
+     */
+    ObjectType objectType() const;
+
+    /**
+     * @brief Sets the object type. This has no effect on a running iteration until start() is called again.
+     * @param type
+     */
+    void setObjectType(ObjectType type);
+
+    /**
+     * @brief Returns the ID of the customer whose cards are listed. This is only used when objectType is ObjectCard. The default value is empty string.
+     * @return QString
+     */
+    QString customerID() const;
+
+    /**
+     * @brief Set the customer ID.
+     * @param id
+     */
+    void setCustomerID(const QString &id);
+
+    /**
+     * @brief Returns the number of objects requested per page. The default value is 10.
+     * @return int
+     */
+    int limit() const;
+
+    /**
+     * @brief Sets the page size. Stripe accepts a limit between 1 and 100, other values are ignored.
+     * @param limit
+     */
+    void setLimit(int limit);
+
+    /**
+     * @brief If valid, only the objects that are created at or after this date are listed. The default value is an invalid date.
+     * @return QDateTime
+     */
+    QDateTime createdAfter() const;
+
+    /**
+     * @brief Set createdAfter.
+     * @param date
+     */
+    void setCreatedAfter(const QDateTime &date);
+
+    /**
+     * @brief If valid, only the objects that are created at or before this date are listed. The default value is an invalid date.
+     * @return QDateTime
+     */
+    QDateTime createdBefore() const;
+
+    /**
+     * @brief Set createdBefore.
+     * @param date
+     */
+    void setCreatedBefore(const QDateTime &date);
+
+    /**
+     * @brief Returns true If there are more pages after the last emitted page. The default value is false.
+     * @return bool
+     */
+    bool hasMore() const;
+
+    /**
+     * @brief Returns true between start() and the emission of the last page, or until an error occurs.
+     * @return bool
+     */
+    bool running() const;
+
+    /**
+     * @brief Starts a new iteration from the first page. The objects of the previous page are deleted and a running iteration is discarded.
+     * `pageReceived()` is emitted when the first page arrives. If the secret key is not set, or the customerID is empty when listing cards, this method
+     * will return false.
+     * @return bool
+     */
+    Q_INVOKABLE bool start();
+
+    /**
+     * @brief Requests the next page. If the page is already prefetched, `pageReceived()` is emitted before this method returns. Otherwise it is emitted
+     * when the page arrives. If there are no more pages or a page is already requested, this method will return false.
+     * @return bool
+     */
+    Q_INVOKABLE bool next();
+
+    /**
+     * @brief Stops the iteration. The replies of the running requests are ignored. The objects of the current page are not deleted.
+     */
+    Q_INVOKABLE void cancel();
+
+    /**
+     * @brief Returns the last ocurred error.
+     * @return const Error *
+     */
+    const Error *lastError() const;
+
+signals:
+    void objectTypeChanged();
+    void customerIDChanged();
+    void limitChanged();
+    void createdAfterChanged();
+    void createdBeforeChanged();
+    void hasMoreChanged();
+    void runningChanged();
+
+    /**
+     * @brief Emitted for each page. objects contains Customer or Card instances depending on objectType. Their parent is this iterator and they are
+     * deleted when the next page is emitted or the iterator is restarted.
+     * @param objects
+     */
+    void pageReceived(const QVariantList &objects);
+
+    /**
+     * @brief Emitted after the last page is emitted.
+     */
+    void finished();
+
+    /**
+     * @brief Emitted when a page request fails. The iteration is stopped. Calling start() begins from the first page again.
+     * @param error
+     */
+    void errorOccurred(Error *error);
+
+private:
+    ObjectType m_ObjectType;
+    QString m_CustomerID;
+    int m_Limit;
+    QDateTime m_CreatedAfter,
+              m_CreatedBefore;
+
+    NetworkUtils m_NetworkUtils;
+    Error m_Error;
+
+    // Increased on each start() and cancel() so that the replies of an old iteration are ignored.
+    unsigned int m_Generation;
+    // ID of the last object of the last received page, used as the `starting_after` cursor.
+    QString m_Cursor;
+    // The raw objects of the next page. They are converted to model objects when the page is emitted.
+    QJsonArray m_PrefetchedPage;
+    QVector<QPointer<QObject>> m_CurrentPage;
+
+    bool m_HasMore,
+         m_IsRunning,
+         m_IsPrefetchReady,
+         m_IsPageRequested,
+         m_ServerHasMore;
+
+private:
+    /**
+     * @brief Sends the request for the page after m_Cursor.
+     */
+    void fetchPage();
+
+    /**
+     * @brief Converts the prefetched page to model objects, deletes the current page, starts prefetching the following page and emits pageReceived().
+     */
+    void emitPage();
+
+    /**
+     * @brief Deletes the objects of the current page that are still owned by this iterator. deleteLater() is used since next() can be called from a
+     * slot connected to one of the objects, or while QML still refers to them.
+     */
+    void clearCurrentPage();
+
+    /**
+     * @brief Returns the query parameters for the next page request.
+     * @return QVariantMap
+     */
+    QVariantMap queryParams() const;
+
+    void setHasMore(bool hasMore);
+    void setRunning(bool running);
+};
+
+}
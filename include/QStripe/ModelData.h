@@ -0,0 +1,224 @@
+#pragma once
+// Qt
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVariantMap>
+#include <QDateTime>
+#include <QVector>
+// QStripe
+#include "FieldSchema.h"
+#include "Address.h"
+#include "Token.h"
+#include "Card.h"
+
+namespace QStripe
+{
+
+/*
+ * The structs in this file are plain, copyable values that hold the same fields as their QObject counterparts. They are meant for processing a large number
+ * of objects, e.g thousands of customers in a reconciliation job, where a QObject with its own signals, Error and NetworkUtils per object is too expensive.
+ * All of the members are implicitly shared Qt types, so copying a struct does not copy the strings. Use the `fromData()` methods of the models to create a
+ * QObject only when it is needed, e.g to show it in a QML view.
+ *
+ * The fields of each struct are described once in its `schema()`, which is used for parsing, serialization and equality. To add a Stripe field, add the
+ * member and register it in the schema.
+ */
+
+struct AddressData {
+    AddressData();
+
+    /**
+     * @brief Reads the address fields from object. See Address::fromJson().
+     * @param object
+     * @param prefix
+     * @return AddressData
+     */
+    static AddressData fromJson(const QJsonObject &object, const QString &prefix = "");
+
+    /**
+     * @brief Writes the address fields to object with the given prefix.
+     * @param object
+     * @param prefix
+     */
+    void writeJson(QJsonObject &object, const QString &prefix = "") const;
+
+    /**
+     * @brief Returns the schema of the address fields with the given prefix, e.g `address_` for a card. The schemas for no prefix and for the card prefix
+     * are created the first time this is called, and the other prefixes are created once when they are first used. The returned reference stays valid.
+     * @param prefix
+     * @return const FieldSchema<AddressData> &
+     */
+    static const FieldSchema<AddressData> &schema(const QString &prefix = "");
+
+    bool operator==(const AddressData &other) const;
+    bool operator!=(const AddressData &other) const;
+
+    QString country,
+            state,
+            city,
+            lineOne,
+            lineTwo,
+            postalCode;
+    Address::ZipCheck zipCheck;
+
+private:
+    /**
+     * @brief Builds the schema of the address fields with the given prefix.
+     * @param prefix
+     * @return FieldSchema<AddressData>
+     */
+    static FieldSchema<AddressData> createSchema(const QString &prefix);
+};
+
+struct ShippingInformationData {
+    /**
+     * @brief Reads the shipping information from object. See ShippingInformation::fromJson().
+     * @param object
+     * @return ShippingInformationData
+     */
+    static ShippingInformationData fromJson(const QJsonObject &object);
+
+    /**
+     * @brief Returns the JSON representation, in the same format as ShippingInformation::json().
+     * @return QJsonObject
+     */
+    QJsonObject json() const;
+
+    /**
+     * @brief Returns the schema of the shipping information fields.
+     * @return const FieldSchema<ShippingInformationData> &
+     */
+    static const FieldSchema<ShippingInformationData> &schema();
+
+    bool operator==(const ShippingInformationData &other) const;
+    bool operator!=(const ShippingInformationData &other) const;
+
+    QString name,
+            phone;
+    AddressData address;
+};
+
+struct TokenData {
+    TokenData();
+
+    /**
+     * @brief Reads the token from object. See Token::fromJson().
+     * @param object
+     * @return TokenData
+     */
+    static TokenData fromJson(const QJsonObject &object);
+
+    /**
+     * @brief Returns the JSON representation, in the same format as Token::json().
+     * @return QJsonObject
+     */
+    QJsonObject json() const;
+
+    /**
+     * @brief Returns the schema of the token fields.
+     * @return const FieldSchema<TokenData> &
+     */
+    static const FieldSchema<TokenData> &schema();
+
+    bool operator==(const TokenData &other) const;
+    bool operator!=(const TokenData &other) const;
+
+    QString tokenID;
+    QDateTime created;
+    Token::Type type;
+    bool liveMode,
+         used;
+    QVariantMap bankAccount;
+};
+
+struct CardData {
+    CardData();
+
+    /**
+     * @brief Reads the card from object. See Card::fromJson().
+     * @param object
+     * @return CardData
+     */
+    static CardData fromJson(const QJsonObject &object);
+
+    /**
+     * @brief Reads each of the objects in array. This can be used with the `data` field of a list response.
+     * @param array
+     * @return QVector<CardData>
+     */
+    static QVector<CardData> fromJson(const QJsonArray &array);
+
+    /**
+     * @brief Returns the JSON representation, in the same format as the Stripe API. The address fields have the `address_` prefix.
+     * @return QJsonObject
+     */
+    QJsonObject json() const;
+
+    /**
+     * @brief Returns the schema of the card fields.
+     * @return const FieldSchema<CardData> &
+     */
+    static const FieldSchema<CardData> &schema();
+
+    bool operator==(const CardData &other) const;
+    bool operator!=(const CardData &other) const;
+
+    QString cardID;
+    Card::CardBrand brand;
+    QString country,
+            currency;
+    Card::CVCCheck cvcCheck;
+    int expirationMonth,
+        expirationYear;
+    QString fingerprint;
+    Card::FundingType funding;
+    QString name,
+            lastFourDigits;
+    Card::TokenizationMethod tokenizationMethod;
+    QVariantMap metadata;
+    AddressData address;
+};
+
+struct CustomerData {
+    CustomerData();
+
+    /**
+     * @brief Reads the customer from object. See Customer::fromJson().
+     * @param object
+     * @return CustomerData
+     */
+    static CustomerData fromJson(const QJsonObject &object);
+
+    /**
+     * @brief Reads each of the objects in array. This can be used with the `data` field of a list response.
+     * @param array
+     * @return QVector<CustomerData>
+     */
+    static QVector<CustomerData> fromJson(const QJsonArray &array);
+
+    /**
+     * @brief Returns the JSON representation, in the same format as the Stripe API.
+     * @return QJsonObject
+     */
+    QJsonObject json() const;
+
+    /**
+     * @brief Returns the schema of the customer fields.
+     * @return const FieldSchema<CustomerData> &
+     */
+    static const FieldSchema<CustomerData> &schema();
+
+    bool operator==(const CustomerData &other) const;
+    bool operator!=(const CustomerData &other) const;
+
+    QString customerID,
+            defaultSource,
+            email,
+            description,
+            currency;
+    QVariantMap metadata;
+    ShippingInformationData shipping;
+    bool deleted;
+};
+
+}
@@ -0,0 +1,529 @@
+#pragma once
+// std
+#include <functional>
+// Qt
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QSharedPointer>
+#include <QWeakPointer>
+#include <QVector>
+#include <QSet>
+#include <QHash>
+#include <QQueue>
+#include <QPointer>
+#include <QPair>
+#include <QTimer>
+#include <QElapsedTimer>
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif // QT_NO_SSL
+
+namespace QStripe
+{
+
+struct Response;
+
+/**
+ * @brief NetworkTransport is the process-wide connection pool that all of the NetworkUtils instances send their requests through. It is reference counted:
+ * The first NetworkUtils that asks for it creates it, and it is destroyed when the last NetworkUtils releases it. Sharing the transport means that the
+ * keep-alive connections to Stripe, the DNS results and the TLS sessions are reused by every model object instead of each object opening its own.
+ */
+class NetworkTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        PriorityInteractive = 0, // Requests a user is waiting for, e.g creating a card token at checkout.
+        PriorityNormal, // The default priority.
+        PriorityBulk, // Background work, e.g fetching or listing many objects.
+        PriorityCount
+    };
+    Q_ENUM(Priority)
+
+    // A callback that waits for the response of a shared request. The callback is not called If its context is destroyed.
+    using Waiter = QPair<QPointer<QObject>, std::function<void(const Response &)>>;
+
+public:
+    ~NetworkTransport();
+
+    /**
+     * @brief Returns the shared transport. If there's no live transport, a new one is created.
+     * @return QSharedPointer<NetworkTransport>
+     */
+    static QSharedPointer<NetworkTransport> instance();
+
+    /**
+     * @brief Returns the number of QNetworkAccessManager instances in the pool. Each manager keeps its own set of connections per host, so the maximum
+     * number of parallel connections to Stripe is poolSize() times Qt's per host connection limit. The default value is 1.
+     * @return int
+     */
+    static int poolSize();
+
+    /**
+     * @brief Sets the pool size. The size cannot be smaller than 1. Growing the pool takes effect immediately. When the pool is shrunk, the extra managers
+     * are not used for new requests but they are kept alive until the transport is destroyed so that the running requests are not aborted.
+     * @param size
+     */
+    static void setPoolSize(int size);
+
+    /**
+     * @brief Returns true If HTTP/2 is allowed for all of the requests. When HTTP/2 is allowed, the concurrent requests to Stripe are multiplexed over one
+     * connection instead of being limited by the per host connection limit of HTTP/1.1. The default value is false.
+     * @return bool
+     */
+    static bool http2Enabled();
+
+    /**
+     * @brief Allows or disallows HTTP/2 for all of the requests. NetworkUtils::setHttp2Enabled() can be used to enable it for a single NetworkUtils.
+     * @param enabled
+     */
+    static void setHttp2Enabled(bool enabled);
+
+    /**
+     * @brief Returns the maximum number of attempts for a request, including the first one. The requests that fail with 429, 500, 502, 503, 504 or with a
+     * connection error are sent again until this many attempts are made. 1 disables the retries. The default value is 3.
+     * @return int
+     */
+    static int retryMaxAttempts();
+
+    /**
+     * @brief Sets the maximum number of attempts. The value cannot be smaller than 1.
+     * @param attempts
+     */
+    static void setRetryMaxAttempts(int attempts);
+
+    /**
+     * @brief Returns the base delay of the exponential backoff in milliseconds. The delay before the nth retry is a random value between 0 and
+     * min(retryMaxDelay(), retryBaseDelay() * 2^(n - 1)). The default value is 250.
+     * @return int
+     */
+    static int retryBaseDelay();
+
+    /**
+     * @brief Sets the base delay. The value cannot be smaller than 0.
+     * @param msecs
+     */
+    static void setRetryBaseDelay(int msecs);
+
+    /**
+     * @brief Returns the cap of the backoff delay in milliseconds. The default value is 8000.
+     * @return int
+     */
+    static int retryMaxDelay();
+
+    /**
+     * @brief Sets the cap of the backoff delay. The value cannot be smaller than 0.
+     * @param msecs
+     */
+    static void setRetryMaxDelay(int msecs);
+
+    /**
+     * @brief Returns the total time in milliseconds a request can take including all of its retries. If the next retry would start after the deadline,
+     * the last response is returned instead. The default value is 30000.
+     * @return int
+     */
+    static int retryDeadline();
+
+    /**
+     * @brief Sets the retry deadline. The value cannot be smaller than 0.
+     * @param msecs
+     */
+    static void setRetryDeadline(int msecs);
+
+    /**
+     * @brief Increases the retry counter.
+     */
+    void countRetry();
+
+    /**
+     * @brief Returns the number of requests that were sent again because of a retryable failure.
+     * @return int
+     */
+    int retryCount() const;
+
+    /**
+     * @brief Returns the maximum number of read (GET) requests that are sent per second. 0 means there is no limit. The default value is 0.
+     * @return double
+     */
+    static double readRate();
+
+    /**
+     * @brief Sets the read rate. Stripe allows 100 read requests per second in live mode and 25 in test mode. The value cannot be negative.
+     * @param requestsPerSecond
+     */
+    static void setReadRate(double requestsPerSecond);
+
+    /**
+     * @brief Returns the maximum number of write (POST, PUT and DELETE) requests that are sent per second. 0 means there is no limit. The default value
+     * is 0.
+     * @return double
+     */
+    static double writeRate();
+
+    /**
+     * @brief Sets the write rate. The value cannot be negative.
+     * @param requestsPerSecond
+     */
+    static void setWriteRate(double requestsPerSecond);
+
+    /**
+     * @brief Returns the time in milliseconds after which a queued request is sent before the requests of the higher priority lanes, so that the bulk
+     * requests are not starved by a steady stream of interactive ones. This only applies when readRate() or writeRate() is set, since the requests are
+     * not queued otherwise. The default value is 2000.
+     * @return int
+     */
+    static int starvationThreshold();
+
+    /**
+     * @brief Sets the starvation threshold. The value cannot be negative.
+     * @param msecs
+     */
+    static void setStarvationThreshold(int msecs);
+
+    /**
+     * @brief Runs start when the rate limiter allows a request of the given kind. Each kind has a token bucket that refills at its rate and holds up to
+     * one second of requests, so short bursts are sent immediately. The requests that exceed the rate are queued, not rejected. Each priority has its own
+     * queue: A queued request starts before all of the requests in the lower priority lanes, and in the order it is submitted within its lane. A request
+     * that waited longer than starvationThreshold() starts first regardless of its lane. If the owner is destroyed while its request is queued, the
+     * request is dropped without using a token.
+     * The lanes are only used when the kind has a rate. When its rate is 0, which is the default, and nothing is queued, start is run immediately: The
+     * lanes, the starvation threshold and the queue wait metrics do not apply, and the priority only reaches Qt through QNetworkRequest::priority().
+     * @param owner
+     * @param write
+     * @param priority
+     * @param start
+     */
+    void submit(QObject *owner, bool write, Priority priority, std::function<void()> &&start);
+
+    /**
+     * @brief Records the time from the creation of a request until its final response for the lane of the request.
+     * @param priority
+     * @param msecs
+     */
+    void reportLatency(Priority priority, qint64 msecs);
+
+    /**
+     * @brief Returns the average time in milliseconds from the creation of a request until its final response, including the queue time and the retries,
+     * for the given lane.
+     * @param priority
+     * @return int
+     */
+    int averageLatency(Priority priority) const;
+
+    /**
+     * @brief Returns the average time in milliseconds that the requests of the given lane waited in the rate limiter queue. The requests that are started
+     * immediately because there is no rate limit count as 0.
+     * @param priority
+     * @return int
+     */
+    int averageQueueWaitTime(Priority priority) const;
+
+    /**
+     * @brief Adapts the rate limiter to the response of a request. A 429 halves the current rate of the bucket, and the other responses increase it
+     * step by step back to the configured rate.
+     * @param write
+     * @param httpStatus
+     */
+    void reportResponse(bool write, int httpStatus);
+
+    /**
+     * @brief Returns the number of requests that are waiting in the rate limiter queues.
+     * @return int
+     */
+    int queuedRequestCount() const;
+
+    /**
+     * @brief Returns the estimated time in milliseconds that a new request would wait in the rate limiter.
+     * @return int
+     */
+    int queueWaitTime() const;
+
+    /**
+     * @brief Returns the maximum number of finished idempotent requests whose responses are kept. When there are more, the oldest ones are removed.
+     * The default value is 100.
+     * @return int
+     */
+    static int idempotencyTableSize();
+
+    /**
+     * @brief Sets the idempotency table size. The value cannot be smaller than 1.
+     * @param size
+     */
+    static void setIdempotencyTableSize(int size);
+
+    /**
+     * @brief Looks up the idempotency key. If a request with the key finished before, the callback is called with its response from the event loop. If a
+     * request with the key is running, the callback is called when it finishes. In both cases no request should be sent, and true is returned. Otherwise
+     * the key is registered as running and false is returned.
+     * @param key
+     * @param context If context is destroyed before the response is ready, the callback is not called.
+     * @param callback
+     * @return bool
+     */
+    bool joinIdempotent(const QString &key, QObject *context, const std::function<void(const Response &)> &callback);
+
+    /**
+     * @brief Records the response of the request with the key and passes it to the waiting callbacks. Only the responses that Stripe would replay for the
+     * same key are recorded: A 5xx, 409, 429 or network failure frees the key so that it can be sent again.
+     * @param key
+     * @param response
+     */
+    void finishIdempotent(const QString &key, const Response &response);
+
+    /**
+     * @brief Frees a running key whose request was dropped before it finished. The waiting callbacks get a cancelled response, except the ones that
+     * belong to context since it is being destroyed.
+     * @param key
+     * @param context
+     */
+    void abandonIdempotent(const QString &key, QObject *context);
+
+    /**
+     * @brief Returns the number of duplicate submissions that were answered without sending a request.
+     * @return int
+     */
+    int idempotentReplayCount() const;
+
+    /**
+     * @brief Returns true If the identical GET requests that are sent while one of them is in flight share its response. The requests are identical If
+     * they have the same URL and the same headers, e.g the same secret key. The default value is true.
+     * @return bool
+     */
+    static bool getDeduplicationEnabled();
+
+    /**
+     * @brief Enables or disables the deduplication of the GET requests.
+     * @param enabled
+     */
+    static void setGetDeduplicationEnabled(bool enabled);
+
+    /**
+     * @brief Returns the key that identifies the GET request for deduplication.
+     * @param request
+     * @return QString
+     */
+    static QString getDeduplicationKey(const QNetworkRequest &request);
+
+    /**
+     * @brief Looks up a GET request with the same key that is in flight. If there's one, the callback is called with its response when it finishes and
+     * true is returned, so no request should be sent. Otherwise the key is registered as in flight and false is returned.
+     * @param key
+     * @param context If context is destroyed before the response is ready, the callback is not called.
+     * @param callback
+     * @return bool
+     */
+    bool joinGet(const QString &key, QObject *context, const std::function<void(const Response &)> &callback);
+
+    /**
+     * @brief Passes the final response of the GET request with the key to the waiting callbacks, and frees the key.
+     * @param key
+     * @param response
+     */
+    void finishGet(const QString &key, const Response &response);
+
+    /**
+     * @brief Called when the GET request with the key is dropped before it finished, because its sender is destroyed. The callbacks that belong to context
+     * are removed. If another NetworkUtils instance is still waiting for the response, its first callback is removed and returned, and the key stays in
+     * flight: The returned waiter should send the request again, and its response is passed to the rest of the waiters. Otherwise the key is freed and
+     * an empty waiter is returned.
+     * @param key
+     * @param context
+     * @return Waiter
+     */
+    Waiter abandonGet(const QString &key, QObject *context);
+
+    /**
+     * @brief Returns the number of GET requests that were answered with the response of an identical request instead of being sent.
+     * @return int
+     */
+    int deduplicatedGetCount() const;
+
+    /**
+     * @brief Returns false If an HTTP/2 request to the host failed before and the host is switched to HTTP/1.1.
+     * @param host
+     * @return bool
+     */
+    bool http2Allowed(const QString &host) const;
+
+    /**
+     * @brief Switches the host to HTTP/1.1 for the rest of the lifetime of the transport.
+     * @param host
+     */
+    void fallbackToHttp1(const QString &host);
+
+    /**
+     * @brief Increases the reply counter for the protocol that was used for the reply.
+     * @param http2Used
+     */
+    void countReply(bool http2Used);
+
+    /**
+     * @brief Returns the number of replies that were received over HTTP/2.
+     * @return int
+     */
+    int http2ReplyCount() const;
+
+    /**
+     * @brief Returns the number of replies that were received over HTTP/1.1.
+     * @return int
+     */
+    int http1ReplyCount() const;
+
+    /**
+     * @brief Returns the number of requests that failed the HTTP/2 negotiation and switched their host to HTTP/1.1. The request itself is only sent again If
+     * the retry policy allows it.
+     * @return int
+     */
+    int http2FallbackCount() const;
+
+    /**
+     * @brief Returns the manager that should be used for the next request. The managers are used in a round-robin fashion.
+     * @return QNetworkAccessManager *
+     */
+    QNetworkAccessManager *nextManager();
+
+    /**
+     * @brief Applies the shared transport settings (e.g the shared TLS session) to the request. This should be called before the request is sent.
+     * @param request
+     */
+    void prepare(QNetworkRequest &request) const;
+
+    /**
+     * @brief Starts tracking the reply so that the TLS session it negotiates can be resumed by the other managers in the pool.
+     * @param reply
+     */
+    void track(QNetworkReply *reply);
+
+private:
+    struct Job {
+        QPointer<QObject> owner;
+        std::function<void()> start;
+        qint64 enqueuedAt;
+        Priority priority;
+    };
+
+    struct LaneMetrics {
+        qint64 totalQueueWaitTime = 0,
+               totalLatency = 0;
+        int dequeuedCount = 0,
+            finishedCount = 0;
+    };
+
+    struct TokenBucket {
+        // Negative until the first request so that the bucket starts full.
+        double tokens = -1;
+        qint64 updatedAt = 0;
+        // The current rate is the configured rate times this factor. It is lowered when Stripe throttles the requests.
+        double factor = 1;
+        // One queue per priority.
+        QQueue<Job> lanes[PriorityCount];
+
+        bool isEmpty() const
+        {
+            return lanes[PriorityInteractive].isEmpty() && lanes[PriorityNormal].isEmpty() && lanes[PriorityBulk].isEmpty();
+        }
+
+        int size() const
+        {
+            return lanes[PriorityInteractive].size() + lanes[PriorityNormal].size() + lanes[PriorityBulk].size();
+        }
+    };
+
+    using Waiters = QVector<Waiter>;
+
+    struct IdempotentEntry {
+        bool finished = false;
+        QSharedPointer<Response> response;
+        Waiters waiting;
+    };
+
+    static QWeakPointer<NetworkTransport> m_Instance;
+    static int m_PoolSize;
+    static bool m_IsHttp2Enabled;
+    static int m_RetryMaxAttempts,
+           m_RetryBaseDelay,
+           m_RetryMaxDelay,
+           m_RetryDeadline,
+           m_IdempotencyTableSize;
+    static double m_ReadRate,
+           m_WriteRate;
+    static int m_StarvationThreshold;
+    static bool m_IsGetDeduplicationEnabled;
+
+    QVector<QNetworkAccessManager *> m_Managers;
+    int m_NextManager;
+
+    QSet<QString> m_Http1Hosts;
+    int m_Http2ReplyCount,
+        m_Http1ReplyCount,
+        m_Http2FallbackCount,
+        m_RetryCount,
+        m_IdempotentReplayCount,
+        m_DeduplicatedGetCount;
+
+    TokenBucket m_ReadBucket,
+                m_WriteBucket;
+    QElapsedTimer m_Clock;
+    QTimer m_DrainTimer;
+    LaneMetrics m_LaneMetrics[PriorityCount];
+
+    QHash<QString, IdempotentEntry> m_IdempotentEntries;
+    // The finished keys, the oldest one is at the head.
+    QQueue<QString> m_FinishedIdempotentKeys;
+    // The waiting callbacks of the GET requests that are in flight.
+    QHash<QString, Waiters> m_InFlightGets;
+#ifndef QT_NO_SSL
+    QSslConfiguration m_SslConfiguration;
+#endif // QT_NO_SSL
+
+private:
+    explicit NetworkTransport(QObject *parent = nullptr);
+
+    /**
+     * @brief Creates the managers until the pool has poolSize() managers.
+     */
+    void growPool();
+
+    /**
+     * @brief Returns the current rate of the bucket in requests per second. 0 means there is no limit.
+     * @param bucket
+     * @param write
+     * @return double
+     */
+    double currentRate(const TokenBucket &bucket, bool write) const;
+
+    /**
+     * @brief Adds the tokens that accumulated since the last refill.
+     * @param bucket
+     * @param rate
+     * @param now
+     */
+    void refill(TokenBucket &bucket, double rate, qint64 now) const;
+
+    /**
+     * @brief Starts the queued requests that have tokens, and schedules m_DrainTimer for the next token If requests are still waiting.
+     */
+    void drain();
+
+    /**
+     * @brief Starts the queued requests of the bucket while it has tokens. Returns the time in milliseconds until the next token If requests are still
+     * waiting, or -1.
+     * @param bucket
+     * @param write
+     * @param now
+     * @return qint64
+     */
+    qint64 drainBucket(TokenBucket &bucket, bool write, qint64 now);
+
+    /**
+     * @brief Returns the lane whose head should start next, or -1 If the bucket is empty. A head that waited longer than m_StarvationThreshold is
+     * picked first, otherwise the highest priority lane wins.
+     * @param bucket
+     * @param now
+     * @return int
+     */
+    int nextLane(const TokenBucket &bucket, qint64 now) const;
+};
+
+}
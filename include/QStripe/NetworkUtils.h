@@ -3,27 +3,133 @@
 #include <functional>
 // Qt
 #include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QSharedPointer>
+#include <QElapsedTimer>
 #include <QNetworkReply>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QHash>
+// QStripe
+#include "NetworkTransport.h"
 
 namespace QStripe
 {
 
 struct Response {
-    Response(QString _data, unsigned int _httpCode, QNetworkReply::NetworkError error)
-        : data(_data)
+    Response(QByteArray _body, unsigned int _httpCode, QNetworkReply::NetworkError error, bool _http2Used = false)
+        : body(_body)
         , httpStatus(_httpCode)
         , networkError(error)
+        , http2Used(_http2Used)
+        , parsedBody()
     {
 
     }
 
-    QString data;
+    /**
+     * @brief Returns the body decoded as UTF-8. The body is only decoded when this is called, so prefer passing body to Utils::toVariantMap(). This
+     * replaces the `data` member of version 1.x.
+     * @return QString
+     */
+    QString data() const
+    {
+        return QString::fromUtf8(body);
+    }
+
+    /**
+     * @brief Returns the body parsed as a JSON object. The body is parsed the first time this is called, and the result is shared by the copies of the
+     * response that are made after that. The callbacks of a deduplicated GET request receive the same response, so they parse it once. If the body is not a
+     * JSON object, returns an empty object.
+     * @return QJsonObject
+     */
+    QJsonObject json() const
+    {
+        // Allocated here so that the responses that are never parsed, e.g the ones that are passed to Utils::toVariantMap(), do not pay for it.
+        if (parsedBody.isNull()) {
+            parsedBody.reset(new ParsedBody());
+            parsedBody->object = QJsonDocument::fromJson(body).object();
+        }
+
+        return parsedBody->object;
+    }
+
+    // The raw body of the reply. It is implicitly shared, so copying a Response does not copy the body.
+    QByteArray body;
     unsigned int httpStatus;
     QNetworkReply::NetworkError networkError;
+    // True If the reply was received over HTTP/2.
+    bool http2Used;
+
+private:
+    struct ParsedBody {
+        QJsonObject object;
+    };
+
+    mutable QSharedPointer<ParsedBody> parsedBody;
 };
 
 using RequestCallback = std::function<void(const Response &)>;
 
+/**
+ * @brief PendingRequest holds the state of an in-flight request. It is stored in NetworkUtils until the reply for the request finishes.
+ */
+struct PendingRequest {
+    PendingRequest()
+        : requestID(0)
+        , operation(QNetworkAccessManager::UnknownOperation)
+        , request()
+        , body()
+        , callback()
+        , elapsed()
+        , retryCount(0)
+        , maxAttempts(1)
+        , deadline(0)
+        , priority(NetworkTransport::PriorityNormal)
+        , owner()
+        , deduplicationKey()
+    {
+
+    }
+
+    PendingRequest(unsigned int _requestID, QNetworkAccessManager::Operation _operation, const QNetworkRequest &_request, const QByteArray &_body,
+                   RequestCallback &&_callback, QObject *_owner)
+        : requestID(_requestID)
+        , operation(_operation)
+        , request(_request)
+        , body(_body)
+        , callback(std::move(_callback))
+        , elapsed()
+        , retryCount(0)
+        , maxAttempts(1)
+        , deadline(0)
+        , priority(NetworkTransport::PriorityNormal)
+        , owner(_owner)
+        , deduplicationKey()
+    {
+        elapsed.start();
+    }
+
+    unsigned int requestID;
+    // The operation, the request and the body are kept so that the request can be sent again.
+    QNetworkAccessManager::Operation operation;
+    QNetworkRequest request;
+    QByteArray body;
+    RequestCallback callback;
+    // Started when the request is first sent.
+    QElapsedTimer elapsed;
+    int retryCount;
+    // The retry limits that were in effect when the request was created.
+    int maxAttempts,
+        deadline;
+    NetworkTransport::Priority priority;
+    // The object that sent the request, this is the parent of the NetworkUtils instance.
+    QPointer<QObject> owner;
+    // Set for the GET requests whose response is shared with the identical requests. See NetworkTransport::joinGet().
+    QString deduplicationKey;
+};
+
 class NetworkUtils : public QObject
 {
     Q_OBJECT
@@ -49,13 +155,23 @@ public:
 
     /**
      * @brief Sends a get request. When the request is finished, the callback is called. If the queryParams parameter is provided, the query parameters are
-     * appended to the request.
+     * appended to the request. If an identical request is in flight, no request is sent and the callback is called with its response. See
+     * NetworkTransport::getDeduplicationEnabled().
      * @param url
      * @param queryParams
      * @param callback
      */
     void sendGet(const QString &url, RequestCallback callback, const QVariantMap &queryParams = QVariantMap());
 
+    /**
+     * @brief Sends a get request with the given priority instead of priority(). This does not change the priority of the other requests.
+     * @param url
+     * @param callback
+     * @param queryParams
+     * @param priority
+     */
+    void sendGet(const QString &url, RequestCallback callback, const QVariantMap &queryParams, NetworkTransport::Priority priority);
+
     /**
      * @brief Sends a delete request. When the request is finished, the callback is called.
      * @param url
@@ -65,11 +181,32 @@ public:
 
     /**
      * @brief Sends a post request. When the request is finished, the callback is called. Stripe expects `application/x-www-form-urlencoded`.
+     * Every post request has an `Idempotency-Key` header that stays the same when the request is retried, so a retry never creates a duplicate object.
+     * If idempotencyKey is empty, a new key is generated. If a request with the same idempotencyKey is running or finished recently, no request is
+     * sent and the callback is called with the response of that request.
+     * @param url
+     * @param data
+     * @param callback
+     * @param idempotencyKey
+     */
+    void sendPost(const QString &url, const QVariantMap &data, RequestCallback callback, const QString &idempotencyKey = "");
+
+    /**
+     * @brief Sends a post request with the given priority instead of priority(). This does not change the priority of the other requests.
      * @param url
      * @param data
      * @param callback
+     * @param idempotencyKey
+     * @param priority
      */
-    void sendPost(const QString &url, const QVariantMap &data, RequestCallback callback);
+    void sendPost(const QString &url, const QVariantMap &data, RequestCallback callback, const QString &idempotencyKey,
+                  NetworkTransport::Priority priority);
+
+    /**
+     * @brief Returns a new random idempotency key.
+     * @return QString
+     */
+    static QString generateIdempotencyKey();
 
     /**
      * @brief Sends a put request. When the request is finished, the callback is called.
@@ -85,6 +222,77 @@ public:
      */
     int getNextrequestID();
 
+    /**
+     * @brief Returns true If HTTP/2 is allowed for the requests of this instance. This is also true when HTTP/2 is enabled for all of the requests using
+     * NetworkTransport::setHttp2Enabled(). If the server does not support HTTP/2, Qt uses HTTP/1.1. If an HTTP/2 request fails at the protocol level,
+     * it is sent again with HTTP/1.1 and the host is not tried with HTTP/2 again.
+     * @return bool
+     */
+    bool http2Enabled() const;
+
+    /**
+     * @brief Allows HTTP/2 for the requests of this instance. The default value is false.
+     * @param enabled
+     */
+    void setHttp2Enabled(bool enabled);
+
+    /**
+     * @brief Returns true If HTTP/2 is used directly without negotiating it first. This is needed for cleartext HTTP/2 (h2c) servers that do not
+     * support the HTTP/1.1 upgrade, e.g a local stand-in server.
+     * @return bool
+     */
+    bool http2Direct() const;
+
+    /**
+     * @brief Set the direct HTTP/2 mode. This has no effect If HTTP/2 is not enabled. The default value is false.
+     * @param direct
+     */
+    void setHttp2Direct(bool direct);
+
+    /**
+     * @brief Returns the priority of the requests that are sent without an explicit priority. The default value is NetworkTransport::PriorityNormal.
+     * @return NetworkTransport::Priority
+     */
+    NetworkTransport::Priority priority() const;
+
+    /**
+     * @brief Sets the priority for the next requests. The requests that are already sent keep their priority. The interactive requests are placed ahead
+     * of the others in the rate limiter queue and in the connection queue of Qt.
+     * @param priority
+     */
+    void setPriority(NetworkTransport::Priority priority);
+
+    /**
+     * @brief Returns the maximum number of attempts for the requests of this instance. If it is not set, NetworkTransport::retryMaxAttempts() is used.
+     * @return int
+     */
+    int maxAttempts() const;
+
+    /**
+     * @brief Sets the maximum number of attempts for the requests of this instance. A value smaller than 1 resets it to the transport default.
+     * @param attempts
+     */
+    void setMaxAttempts(int attempts);
+
+    /**
+     * @brief Returns the total time in milliseconds that a request of this instance can take with its retries. If it is not set,
+     * NetworkTransport::retryDeadline() is used.
+     * @return int
+     */
+    int retryDeadline() const;
+
+    /**
+     * @brief Sets the retry deadline for the requests of this instance. A value smaller than 1 resets it to the transport default.
+     * @param msecs
+     */
+    void setRetryDeadline(int msecs);
+
+    /**
+     * @brief Returns the number of requests that are sent and not finished yet. The requests that are waiting to be retried are included.
+     * @return int
+     */
+    int pendingRequestCount() const;
+
     /**
      * @brief When a header is set, it is used for all of the requests. If a header with the same headerName exists, it is overwritten.
      * @param headerName
@@ -101,24 +309,88 @@ public:
 private:
     static unsigned int m_RequestCount;
 
-    QNetworkAccessManager m_Network;
-    QList<RequestCallback> m_Callbacks;
+    QSharedPointer<NetworkTransport> m_Transport;
+    QHash<QNetworkReply *, PendingRequest> m_PendingRequests;
     QMap<QByteArray, QByteArray> m_Headers;
+    bool m_IsHttp2Enabled,
+         m_IsHttp2Direct;
+    int m_MaxAttempts,
+        m_RetryDeadline;
+    NetworkTransport::Priority m_Priority;
+    // The requests that are waiting for their retry timer, keyed by the request ID.
+    QHash<unsigned int, PendingRequest> m_ScheduledRetries;
+    // The requests that are waiting in the rate limiter, keyed by the request ID.
+    QHash<unsigned int, PendingRequest> m_QueuedRequests;
 
 private:
+    /**
+     * @brief Removes the pending request of the reply from the registry and calls its callback.
+     * @param reply
+     */
     void onRequestFinished(QNetworkReply *reply);
-    void onReceivedResponse(const Response &response, int threadIndex);
 
     /**
-     * @brief Returns the first nullptr thread index. If none found, returns -1
+     * @brief Queues the request in the rate limiter of the shared transport. It is sent with sendNow() when the limiter allows it.
+     * @param pending
+     */
+    void dispatch(PendingRequest &&pending);
+
+    /**
+     * @brief Sends the request using the shared transport and adds it to the registry. The reply is owned by this instance so that it is aborted If this
+     * instance is destroyed before the reply finishes. The managers are shared, so the replies cannot be collected from QNetworkAccessManager::finished.
+     * @param pending
+     */
+    void sendNow(PendingRequest &&pending);
+
+    /**
+     * @brief Creates a pending request for the given operation and dispatches it.
+     * @param operation
+     * @param request
+     * @param body
+     * @param callback
+     * @param priority
+     * @param deduplicationKey
+     */
+    void send(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &body, RequestCallback &&callback,
+              NetworkTransport::Priority priority, const QString &deduplicationKey = QString());
+
+    /**
+     * @brief Returns true If the reply failed at the protocol level while HTTP/2 was allowed, which means the host should be switched to HTTP/1.1. Connection
+     * resets are not counted since they also happen with HTTP/1.1.
+     * @param reply
+     * @param pending
+     * @return bool
+     */
+    bool shouldFallbackToHttp1(QNetworkReply *reply, const PendingRequest &pending) const;
+
+    /**
+     * @brief Returns the delay in milliseconds before the request should be sent again, or -1 If it should not be retried. A request is retried when it
+     * fails with 429, 5xx or a connection error, it has attempts left and the retry would start before its deadline. The requests that change data are
+     * only retried If Stripe did not process them, or If they have an Idempotency-Key header. The delay is a random value up to the capped exponential
+     * backoff (full jitter), or the value of the Retry-After header when the server sends one. A request that failed the HTTP/2 negotiation is retried
+     * right away with HTTP/1.1 under the same rules.
+     * @param reply
+     * @param pending
      * @return int
      */
-    int getAvailableIndex();
+    int retryDelay(QNetworkReply *reply, const PendingRequest &pending) const;
+
+    /**
+     * @brief Dispatches the request again after delay milliseconds. If this instance is destroyed before that, the request is dropped.
+     * @param pending
+     * @param delay
+     */
+    void scheduleRetry(PendingRequest &&pending, int delay);
 
-    void insertCallback(const int &threadIndex, RequestCallback &&callback);
+    /**
+     * @brief Frees the idempotency key and the deduplication key of a request that is dropped before it finishes. If another instance is waiting for the
+     * response of a dropped GET request, the request is sent again from that instance instead.
+     * @param pending
+     */
+    void abandonRequestKeys(const PendingRequest &pending);
 
     /**
-     * @brief If a token exists, sets the Authorization header of the HTTPRequest
+     * @brief If a token exists, sets the Authorization header of the HTTPRequest. The shared transport settings are also applied here.
      * @param request
      */
     void setHeaders(QNetworkRequest &request);
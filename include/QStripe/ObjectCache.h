@@ -0,0 +1,168 @@
+#pragma once
+// std
+#include <list>
+// Qt
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QHash>
+
+namespace QStripe
+{
+
+/**
+ * @brief ObjectCache is the process-wide cache for the fetched customers and cards. It stores the raw JSON of an object keyed by its ID, so a cached
+ * object goes through the same `fromJson()` path as a fetched one. The entries expire after timeToLive() milliseconds, and when there are more than
+ * maxEntries() entries or more than maxBytes() bytes, the least recently used entries are evicted. The cache is disabled by default. The entries are removed when
+ * Stripe::setSecretKey() or Stripe::setApiBaseUrl() changes the account, so the objects of one account are never returned for another.
+ */
+class ObjectCache
+{
+public:
+    /**
+     * @brief Returns true If the cache is used. The default value is false.
+     * @return bool
+     */
+    static bool enabled();
+
+    /**
+     * @brief Enables or disables the cache. When it is disabled, all of the entries are removed.
+     * @param enabled
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Returns the time in milliseconds after which an entry is considered stale. The default value is 60000.
+     * @return int
+     */
+    static int timeToLive();
+
+    /**
+     * @brief Sets the time to live. The value cannot be smaller than 1. The existing entries keep their expiry time.
+     * @param msecs
+     */
+    static void setTimeToLive(int msecs);
+
+    /**
+     * @brief Returns the maximum number of entries. The default value is 1000.
+     * @return int
+     */
+    static int maxEntries();
+
+    /**
+     * @brief Sets the maximum number of entries. The value cannot be smaller than 1. If there are more entries, the least recently used ones are evicted.
+     * @param count
+     */
+    static void setMaxEntries(int count);
+
+    /**
+     * @brief Returns the maximum total size of the JSON of the entries in bytes. 0 means there is no size limit. The default value is 0.
+     * @return int
+     */
+    static int maxBytes();
+
+    /**
+     * @brief Sets the maximum total size. If the entries are larger, the least recently used ones are evicted.
+     * @param bytes
+     */
+    static void setMaxBytes(int bytes);
+
+    /**
+     * @brief If there's a fresh entry with the given key, copies its data to data and returns true. A stale entry is removed and counted as a miss.
+     * @param key
+     * @param data
+     * @return bool
+     */
+    static bool find(const QString &key, QJsonObject &data);
+
+    /**
+     * @brief Inserts or replaces the entry with the given key. byteSize is the size of the JSON that data is parsed from.
+     * @param key
+     * @param data
+     * @param byteSize
+     * @param parentKey If not empty, the entry is removed when the entry with parentKey is removed with removeWithChildren().
+     */
+    static void insert(const QString &key, const QJsonObject &data, int byteSize, const QString &parentKey = "");
+
+    /**
+     * @brief Removes the entry with the given key.
+     * @param key
+     */
+    static void remove(const QString &key);
+
+    /**
+     * @brief Removes the entry with the given key and all of the entries whose parent key is key. e.g The cards of a deleted customer.
+     * @param key
+     */
+    static void removeWithChildren(const QString &key);
+
+    /**
+     * @brief Removes all of the entries. The counters are not reset.
+     */
+    static void clear();
+
+    /**
+     * @brief Returns the number of entries.
+     * @return int
+     */
+    static int count();
+
+    static int hitCount();
+    static int missCount();
+    static int evictionCount();
+
+    /**
+     * @brief Returns the key for the customer with the given ID.
+     * @param customerID
+     * @return QString
+     */
+    static QString customerKey(const QString &customerID);
+
+    /**
+     * @brief Returns the key for the card with the given ID. The customer is part of the key since a card can only be fetched through the customer that
+     * it belongs to.
+     * @param customerID
+     * @param cardID
+     * @return QString
+     */
+    static QString cardKey(const QString &customerID, const QString &cardID);
+
+private:
+    struct Entry {
+        QJsonObject data;
+        int byteSize;
+        qint64 expiresAt;
+        QString parentKey;
+        // Position of the key in m_Order.
+        std::list<QString>::iterator position;
+    };
+
+    static bool m_IsEnabled;
+    static int m_TimeToLive,
+           m_MaxEntries,
+           m_MaxBytes,
+           m_TotalBytes;
+    static int m_HitCount,
+           m_MissCount,
+           m_EvictionCount;
+
+    static QHash<QString, Entry> m_Entries;
+    // The most recently used key is at the front.
+    static std::list<QString> m_Order;
+    static QElapsedTimer m_Clock;
+
+private:
+    ObjectCache();
+
+    /**
+     * @brief Returns the current time of the monotonic clock in milliseconds.
+     * @return qint64
+     */
+    static qint64 now();
+
+    /**
+     * @brief Evicts the least recently used entries until the limits are satisfied.
+     */
+    static void evict();
+};
+
+}
@@ -7,6 +7,8 @@
 namespace QStripe
 {
 
+struct ShippingInformationData;
+
 class ShippingInformation : public QObject
 {
     Q_OBJECT
@@ -78,8 +80,8 @@ public:
     Q_INVOKABLE void set(ShippingInformation *other);
 
     /**
-     * @brief Resets every property to its default state. When the clearing is complete, `cleared()` signal will be emitted.
-     * The changes in the properties does NOT emit the related signals.
+     * @brief Resets every property to its default state. The changed signal of every property is emitted, even If the property was already empty. When
+     * the clearing is complete, `cleared()` signal will be emitted.
      */
     Q_INVOKABLE void clear();
 
@@ -91,6 +93,25 @@ public:
      */
     static ShippingInformation *fromJson(const QVariantMap &data);
 
+    /**
+     * @brief Same as the QVariantMap overload, but reads the fields directly from the JSON object in a single pass over its keys.
+     * @param object
+     * @return ShippingInformation
+     */
+    static ShippingInformation *fromJson(const QJsonObject &object);
+
+    /**
+     * @brief Returns the fields of this instance as a value.
+     * @return ShippingInformationData
+     */
+    ShippingInformationData data() const;
+
+    /**
+     * @brief Changes the fields of this instance to the ones in data.
+     * @param data
+     */
+    void setData(const ShippingInformationData &data);
+
     /**
      * @brief Returns an ShippingInformation instance from a json string.
      * Address instance.
@@ -3,6 +3,8 @@
 #include <QQmlListProperty>
 #include <QObject>
 #include <QVector>
+#include <QStringList>
+#include <QVariantList>
 // QStripe
 #include "NetworkUtils.h"
 #include "Customer.h"
@@ -18,6 +20,19 @@ class Stripe : public QObject
     Q_PROPERTY(QString publishableKey READ publishableKey WRITE setPublishableKey)
     Q_PROPERTY(QString secretKey READ secretKey WRITE setSecretKey)
     Q_PROPERTY(QString apiVersion READ apiVersion WRITE setApiVersion)
+    Q_PROPERTY(QString apiBaseUrl READ apiBaseUrl WRITE setApiBaseUrl)
+    Q_PROPERTY(int connectionPoolSize READ connectionPoolSize WRITE setConnectionPoolSize)
+    Q_PROPERTY(bool http2Enabled READ http2Enabled WRITE setHttp2Enabled)
+    Q_PROPERTY(int maxConcurrentRequests READ maxConcurrentRequests WRITE setMaxConcurrentRequests)
+    Q_PROPERTY(int maxRetryAttempts READ maxRetryAttempts WRITE setMaxRetryAttempts)
+    Q_PROPERTY(int retryDeadline READ retryDeadline WRITE setRetryDeadline)
+    Q_PROPERTY(double readRateLimit READ readRateLimit WRITE setReadRateLimit)
+    Q_PROPERTY(double writeRateLimit READ writeRateLimit WRITE setWriteRateLimit)
+
+    Q_PROPERTY(bool cacheEnabled READ cacheEnabled WRITE setCacheEnabled)
+    Q_PROPERTY(int cacheTimeToLive READ cacheTimeToLive WRITE setCacheTimeToLive)
+    Q_PROPERTY(int cacheMaxEntries READ cacheMaxEntries WRITE setCacheMaxEntries)
+    Q_PROPERTY(int cacheMaxBytes READ cacheMaxBytes WRITE setCacheMaxBytes)
 
     Q_PROPERTY(QQmlListProperty<QStripe::Customer> customers READ customers)
     Q_CLASSINFO("DefaultProperty", "customers")
@@ -45,6 +60,7 @@ public:
 
     /**
      * @brief Sets the current secret key. This change does not effect the currently running requests. But any request after this change will use this key.
+     * If the key changes, the cached objects are removed.
      * @param key
      */
     static void setSecretKey(const QString &key);
@@ -62,6 +78,206 @@ public:
      */
     static void setApiVersion(const QString &version);
 
+    /**
+     * @brief Returns the base URL that the endpoint URLs are created from. The default value is `https://api.stripe.com/v1`.
+     * @return QString
+     */
+    static QString apiBaseUrl();
+
+    /**
+     * @brief Sets the base URL. This is useful to send the requests to a local stand-in server in tests. This change does not effect the currently running
+     * requests. If the URL changes, the cached objects are removed.
+     * @param url
+     */
+    static void setApiBaseUrl(const QString &url);
+
+    /**
+     * @brief Returns true If HTTP/2 is allowed for all of the requests. The default value is false.
+     * @return bool
+     */
+    static bool http2Enabled();
+
+    /**
+     * @brief Allows HTTP/2 for all of the requests. When it is enabled, the concurrent requests to Stripe share one multiplexed connection instead of being
+     * limited to 6 connections per network manager. If HTTP/2 cannot be used, the requests fall back to HTTP/1.1.
+     * @param enabled
+     */
+    static void setHttp2Enabled(bool enabled);
+
+    /**
+     * @brief Returns the number of replies that were received over HTTP/2 since the shared connection pool was created.
+     * @return int
+     */
+    Q_INVOKABLE int http2ReplyCount() const;
+
+    /**
+     * @brief Returns the number of replies that were received over HTTP/1.1 since the shared connection pool was created.
+     * @return int
+     */
+    Q_INVOKABLE int http1ReplyCount() const;
+
+    /**
+     * @brief Returns the maximum number of attempts for all of the requests. The requests that fail with 429, 5xx or a connection error are sent again
+     * with an exponential backoff until this many attempts are made. The default value is 3.
+     * @return int
+     */
+    static int maxRetryAttempts();
+
+    /**
+     * @brief Sets the maximum number of attempts. 1 disables the retries.
+     * @param attempts
+     */
+    static void setMaxRetryAttempts(int attempts);
+
+    /**
+     * @brief Returns the total time in milliseconds that a request can take including its retries. The default value is 30000.
+     * @return int
+     */
+    static int retryDeadline();
+
+    /**
+     * @brief Sets the retry deadline.
+     * @param msecs
+     */
+    static void setRetryDeadline(int msecs);
+
+    /**
+     * @brief Returns the number of retried requests since the shared connection pool was created.
+     * @return int
+     */
+    Q_INVOKABLE int retryCount() const;
+
+    /**
+     * @brief Returns the maximum number of GET requests per second for all of the requests. The requests above the limit are queued. 0 means there is no
+     * limit. The default value is 0.
+     * @return double
+     */
+    static double readRateLimit();
+
+    /**
+     * @brief Sets the read rate limit. Stripe allows 100 read requests per second in live mode and 25 in test mode.
+     * @param requestsPerSecond
+     */
+    static void setReadRateLimit(double requestsPerSecond);
+
+    /**
+     * @brief Returns the maximum number of POST, PUT and DELETE requests per second for all of the requests. 0 means there is no limit. The default value is 0.
+     * @return double
+     */
+    static double writeRateLimit();
+
+    /**
+     * @brief Sets the write rate limit.
+     * @param requestsPerSecond
+     */
+    static void setWriteRateLimit(double requestsPerSecond);
+
+    /**
+     * @brief Returns the number of requests that are waiting for the rate limiter.
+     * @return int
+     */
+    Q_INVOKABLE int queuedRequestCount() const;
+
+    /**
+     * @brief Returns the estimated time in milliseconds that a new request would wait for the rate limiter.
+     * @return int
+     */
+    Q_INVOKABLE int queueWaitTime() const;
+
+    /**
+     * @brief Returns the average time in milliseconds from sending a request until its final response for the given priority lane. The token requests
+     * are interactive, fetchCustomers() and ListIterator requests are bulk, and the rest are normal.
+     * @param priority One of the NetworkTransport::Priority values.
+     * @return int
+     */
+    Q_INVOKABLE int averageLatency(int priority) const;
+
+    /**
+     * @brief Returns the number of network managers in the shared connection pool. All of the Stripe, Customer and Card instances share the same pool.
+     * The default value is 1.
+     * @return int
+     */
+    static int connectionPoolSize();
+
+    /**
+     * @brief Sets the size of the shared connection pool. Each manager in the pool can open up to 6 connections to Stripe, so increase this only If you
+     * need more parallel connections than that.
+     * @param size
+     */
+    static void setConnectionPoolSize(int size);
+
+    /**
+     * @brief Returns true If the fetched customers and cards are cached. When the cache is enabled, fetchCustomer(), fetchCustomers() and fetchCard()
+     * use the cached JSON of an object instead of sending a request. The cache is shared by all of the Stripe instances. The default value is false.
+     * @return bool
+     */
+    static bool cacheEnabled();
+
+    /**
+     * @brief Enables or disables the cache. Disabling the cache removes all of the cached objects.
+     * @param enabled
+     */
+    static void setCacheEnabled(bool enabled);
+
+    /**
+     * @brief Returns the time in milliseconds that a cached object is used for. The default value is 60000.
+     * @return int
+     */
+    static int cacheTimeToLive();
+
+    /**
+     * @brief Sets the time to live of the cached objects.
+     * @param msecs
+     */
+    static void setCacheTimeToLive(int msecs);
+
+    /**
+     * @brief Returns the maximum number of cached objects. When it is exceeded, the least recently used objects are evicted. The default value is 1000.
+     * @return int
+     */
+    static int cacheMaxEntries();
+
+    /**
+     * @brief Sets the maximum number of cached objects.
+     * @param count
+     */
+    static void setCacheMaxEntries(int count);
+
+    /**
+     * @brief Returns the maximum total JSON size of the cached objects in bytes. 0 means there is no size limit. The default value is 0.
+     * @return int
+     */
+    static int cacheMaxBytes();
+
+    /**
+     * @brief Sets the maximum total size of the cached objects.
+     * @param bytes
+     */
+    static void setCacheMaxBytes(int bytes);
+
+    /**
+     * @brief Returns the number of fetches that were served from the cache.
+     * @return int
+     */
+    Q_INVOKABLE int cacheHitCount() const;
+
+    /**
+     * @brief Returns the number of fetches that were not in the cache, or found a stale object.
+     * @return int
+     */
+    Q_INVOKABLE int cacheMissCount() const;
+
+    /**
+     * @brief Returns the number of objects that were evicted because the cache was full.
+     * @return int
+     */
+    Q_INVOKABLE int cacheEvictionCount() const;
+
+    /**
+     * @brief Removes all of the cached objects.
+     */
+    Q_INVOKABLE void clearCache();
+
     /**
      * @brief Returns the list of customer currently attached to this instance.
      * @return QQmlListProperty<Customer>
@@ -99,6 +315,34 @@ public:
      */
     Q_INVOKABLE bool fetchCustomer(const QString &customerID);
 
+    /**
+     * @brief Returns the maximum number of requests that fetchCustomers() keeps in flight at the same time. The default value is 6.
+     * @return int
+     */
+    int maxConcurrentRequests() const;
+
+    /**
+     * @brief Sets the maximum number of in-flight requests for fetchCustomers(). The value cannot be smaller than 1. If a batch is running, the new limit
+     * is used for the requests that are not sent yet.
+     * @param count
+     */
+    void setMaxConcurrentRequests(int count);
+
+    /**
+     * @brief Fetches all of the customers with the given IDs. At most maxConcurrentRequests() requests are in flight at the same time, and
+     * `customersFetchProgress()` is emitted after each one of them finishes. When all of them are finished, `customersFetched()` signal is emitted once.
+     * Empty and duplicate IDs are ignored. If a batch is already running or there are no IDs to fetch, this method will return false.
+     * @param customerIDs
+     * @return bool
+     */
+    Q_INVOKABLE bool fetchCustomers(const QStringList &customerIDs);
+
+    /**
+     * @brief Returns true If a fetchCustomers() batch is running.
+     * @return bool
+     */
+    Q_INVOKABLE bool fetchingCustomers() const;
+
     /**
      * @brief Fetches the card with the given ID. If the customer exists and it is sucesfully fetched, `cardFetched()` signal will be emitted.
      * If the cardID length is 0, this method will return false.
@@ -123,6 +367,21 @@ signals:
      */
     void cardFetched(Card *card);
 
+    /**
+     * @brief Emitted each time a request of a fetchCustomers() batch finishes.
+     * @param finishedCount
+     * @param totalCount
+     */
+    void customersFetchProgress(int finishedCount, int totalCount);
+
+    /**
+     * @brief Emitted when all of the requests of a fetchCustomers() batch are finished. customers contains the fetched Customer instances, and errors
+     * maps each failed customer ID to its Error instance. The parent of the customers and the errors is initially this instance of Stripe.
+     * @param customers
+     * @param errors
+     */
+    void customersFetched(const QVariantList &customers, const QVariantMap &errors);
+
     /**
      * @brief Emitted when a request to Stripe fails.
      * @param error
@@ -132,13 +391,42 @@ signals:
 private:
     static QString m_PublishableKey,
            m_SecretKey,
-           m_APIVersion;
+           m_APIVersion,
+           m_APIBaseUrl;
+
+    /**
+     * @brief CustomerBatch keeps the state of a running fetchCustomers() call.
+     */
+    struct CustomerBatch {
+        QStringList customerIDs;
+        int nextIndex = 0,
+            inFlightCount = 0,
+            finishedCount = 0;
+        QVariantList customers;
+        QVariantMap errors;
+    };
 
     QVector<Customer *> m_Customers;
     NetworkUtils m_NetworkUtils;
     Error m_Error;
+    int m_MaxConcurrentRequests;
+    CustomerBatch m_CustomerBatch;
 
 private:
+    /**
+     * @brief Sends the requests of the current batch until the in-flight limit is reached or there are no more IDs left.
+     */
+    void fetchNextCustomers();
+
+    /**
+     * @brief Records the result of a batch request. Emits the progress, and the completion signal If it was the last request of the batch.
+     * @param customerID
+     * @param data
+     * @param httpStatus
+     * @param networkError
+     */
+    void onBatchCustomerFetched(const QString &customerID, const QJsonObject &data, unsigned int httpStatus, QNetworkReply::NetworkError networkError);
+
     /**
      * @brief This is connected to the apiVersionChanged() signal. When the API version changes, the header will also change.
      */
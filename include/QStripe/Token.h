@@ -1,5 +1,6 @@
 #pragma once
 // Qt
+#include <QJsonObject>
 #include <QVariantMap>
 #include <QDateTime>
 #include <QObject>
@@ -7,6 +8,8 @@
 namespace QStripe
 {
 
+struct TokenData;
+
 /**
  * @brief Token is a read-only class and it can only be created using `QStripe::Card::createToken()`. The token will always be attached to a Card so it does
  * not have the `card()` property.
@@ -113,6 +116,26 @@ public:
      */
     Q_INVOKABLE static Token *fromJson(const QVariantMap &data);
 
+    /**
+     * @brief Same as the QVariantMap overload, but reads the fields directly from the JSON object in a single pass over its keys.
+     * @param object
+     * @return Token *
+     */
+    static Token *fromJson(const QJsonObject &object);
+
+    /**
+     * @brief Returns a token instance with the fields in data. The parent of the token instance is not set.
+     * @param data
+     * @return Token *
+     */
+    static Token *fromData(const TokenData &data);
+
+    /**
+     * @brief Returns the fields of this instance as a value.
+     * @return TokenData
+     */
+    TokenData data() const;
+
     /**
      * @brief Parses the json string and returns a corresponding Token object. Internally, it calls `Token::fromJson()`. This function is invokable from QML.
      * @param data
@@ -145,6 +168,12 @@ public:
      */
     Q_INVOKABLE void set(const Token *other);
 
+    /**
+     * @brief Changes the fields that exist in object, e.g a token that is returned from the API. The other fields are not changed.
+     * @param object
+     */
+    void applyJson(const QJsonObject &object);
+
 signals:
     /**
      * @brief Emitted after the clear() method is called.
@@ -1,5 +1,6 @@
 #pragma once
 // Qt
+#include <QJsonObject>
 #include <QVariantMap>
 
 namespace QStripe
@@ -23,6 +24,56 @@ public:
      * @return QVariantMap
      */
     static QVariantMap toVariantMap(const QString &data);
+
+    /**
+     * @brief Converts the given UTF-8 encoded JSON to variant map. Unlike the QString overload, this parses the bytes directly without transcoding them.
+     * @param data
+     * @return QVariantMap
+     */
+    static QVariantMap toVariantMap(const QByteArray &data);
+
+    /**
+     * @brief Parses the given UTF-8 encoded JSON. Use this with the `fromJson(const QJsonObject &)` overloads of the models to skip the QVariantMap
+     * conversion. If data is not a JSON object, an empty object is returned.
+     * @param data
+     * @return QJsonObject
+     */
+    static QJsonObject toJsonObject(const QByteArray &data);
+
+    /**
+     * @brief Encodes the given data as an `application/x-www-form-urlencoded` body. Nested maps are encoded with Stripe's bracketed keys, e.g
+     * `metadata[key]=value`, and lists are encoded as `expand[]=value`. If an item of a list is a map, its index is used instead, e.g
+     * `items[0][plan]=value`. The other values are converted with QVariant::toString().
+     * @param data
+     * @return QByteArray
+     */
+    static QByteArray toFormData(const QVariantMap &data);
+
+    /**
+     * @brief Returns the entries of current that do not exist in previous or have a different value. The keys that are removed from previous are returned
+     * with an empty string, which is how Stripe removes a metadata key.
+     * @param current
+     * @param previous
+     * @return QVariantMap
+     */
+    static QVariantMap changedEntries(const QVariantMap &current, const QVariantMap &previous);
+
+private:
+    /**
+     * @brief Appends the field with the given already encoded key to body. If value is a map or a list, a field is appended for each of its items.
+     * @param body
+     * @param key
+     * @param value
+     */
+    static void appendFormField(QByteArray &body, const QByteArray &key, const QVariant &value);
+
+    /**
+     * @brief Percent encodes data and appends it to body. Spaces are encoded as `+`.
+     * @param body
+     * @param data
+     * @param isKey If true, the brackets are not encoded so that the nested keys stay readable.
+     */
+    static void appendFormEncoded(QByteArray &body, const QByteArray &data, bool isKey);
 };
 
 }
@@ -6,7 +6,11 @@
     QT += network
 }
 
-VER_MAJ = 1
+!contains(QT, concurrent) {
+    QT += concurrent
+}
+
+VER_MAJ = 2
 VER_MIN = 0
 VER_PAT = 0
 VERSION = $$sprintf("%1.%2.%3", $$VER_MAJ, $$VER_MIN, $$VER_PAT)
@@ -30,10 +34,17 @@ else {
 HEADERS += \
     $$PWD/include/QStripe/Token.h \
     $$PWD/include/QStripe/Card.h \
+    $$PWD/include/QStripe/CardValidator.h \
     $$PWD/include/QStripe/Customer.h \
     $$PWD/include/QStripe/Utils.h \
     $$PWD/include/QStripe/Stripe.h \
     $$PWD/include/QStripe/NetworkUtils.h \
+    $$PWD/include/QStripe/NetworkTransport.h \
+    $$PWD/include/QStripe/ListIterator.h \
+    $$PWD/include/QStripe/ObjectCache.h \
+    $$PWD/include/QStripe/ModelData.h \
+    $$PWD/include/QStripe/FieldSchema.h \
+    $$PWD/include/QStripe/EnumTable.h \
     $$PWD/include/QStripe/Address.h \
     $$PWD/include/QStripe/ShippingInformation.h \
     $$PWD/include/QStripe/PaymentSource.h \
@@ -43,10 +54,15 @@ HEADERS += \
 SOURCES += \
     $$PWD/src/Token.cpp \
     $$PWD/src/Card.cpp \
+    $$PWD/src/CardValidator.cpp \
     $$PWD/src/Customer.cpp \
     $$PWD/src/Utils.cpp \
     $$PWD/src/Stripe.cpp \
     $$PWD/src/NetworkUtils.cpp \
+    $$PWD/src/NetworkTransport.cpp \
+    $$PWD/src/ListIterator.cpp \
+    $$PWD/src/ObjectCache.cpp \
+    $$PWD/src/ModelData.cpp \
     $$PWD/src/Address.cpp \
     $$PWD/src/ShippingInformation.cpp \
     $$PWD/src/PaymentSource.cpp \
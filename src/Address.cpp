@@ -1,10 +1,20 @@
 #include "QStripe/Address.h"
 // QStripe
+#include "QStripe/EnumTable.h"
+#include "QStripe/ModelData.h"
 #include "QStripe/Utils.h"
 
 namespace QStripe
 {
 
+static constexpr EnumName<Address::ZipCheck> ZIP_CHECKS[] = {
+    {Address::ZipCheckPass, "pass"},
+    {Address::ZipCheckFail, "fail"},
+    {Address::ZipCheckUnchecked, "unchecked"},
+    {Address::ZipCheckUnavailable, "unavailable"},
+    {Address::ZipCheckUnknown, "unknown"}
+};
+
 const QString Address::FIELD_COUNTRY = "country";
 const QString Address::FIELD_CITY = "city";
 const QString Address::FIELD_LINE_1 = "line1";
@@ -149,17 +159,7 @@ void Address::setZipCheck(const ZipCheck &check)
 
 QVariantMap Address::json(const QString &prefix) const
 {
-    QVariantMap data;
-    data[prefix + FIELD_COUNTRY] = country();
-    data[prefix + FIELD_CITY] = city();
-    data[prefix + FIELD_STATE] = state();
-
-    data[prefix + FIELD_LINE_1] = lineOne();
-    data[prefix + FIELD_LINE_2] = lineTwo();
-    data[prefix + FIELD_POSTAL_CODE] = postalCode();
-    data[prefix + FIELD_ZIP_CHECK] = zipCheckName(m_ZipCheck);
-
-    return data;
+    return AddressData::schema(prefix).variantMap(data());
 }
 
 QString Address::jsonString(const QString &prefix) const
@@ -238,6 +238,50 @@ Address *Address::fromJson(const QVariantMap &data, const QString &prefix)
     return address;
 }
 
+Address *Address::fromJson(const QJsonObject &object, const QString &prefix)
+{
+    Address *address = new Address();
+    address->setData(AddressData::fromJson(object, prefix));
+    return address;
+}
+
+AddressData Address::data() const
+{
+    AddressData data;
+    data.country = m_Country;
+    data.state = m_State;
+    data.city = m_City;
+
+    data.lineOne = m_LineOne;
+    data.lineTwo = m_LineTwo;
+    data.postalCode = m_PostalCode;
+    data.zipCheck = m_ZipCheck;
+
+    return data;
+}
+
+void Address::setData(const AddressData &data)
+{
+    setCountry(data.country);
+    setState(data.state);
+    setCity(data.city);
+
+    setLineOne(data.lineOne);
+    setLineTwo(data.lineTwo);
+    setPostalCode(data.postalCode);
+    setZipCheck(data.zipCheck);
+}
+
+bool Address::applyJson(const QJsonObject &object, const QString &prefix)
+{
+    const AddressData before = data();
+    AddressData address = before;
+    AddressData::schema(prefix).read(address, object);
+    setData(address);
+
+    return address != before;
+}
+
 Address *Address::fromString(const QString &dataStr, const QString &prefix)
 {
     return fromJson(Utils::toVariantMap(dataStr), prefix);
@@ -245,40 +289,12 @@ Address *Address::fromString(const QString &dataStr, const QString &prefix)
 
 Address::ZipCheck Address::zipCheckType(const QString &name)
 {
-    ZipCheck check = ZipCheck::ZipCheckUnknown;
-    if (name == "pass") {
-        check = ZipCheck::ZipCheckPass;
-    }
-    else if (name == "fail") {
-        check = ZipCheck::ZipCheckFail;
-    }
-    else if (name == "unchecked") {
-        check = ZipCheck::ZipCheckUnchecked;
-    }
-    else if (name == "unavailable") {
-        check = ZipCheck::ZipCheckUnavailable;
-    }
-
-    return check;
+    return EnumTable::value(ZIP_CHECKS, name, ZipCheck::ZipCheckUnknown);
 }
 
 QString Address::zipCheckName(ZipCheck check)
 {
-    QString name = "unknown";
-    if (check == ZipCheck::ZipCheckPass) {
-        name = "pass";
-    }
-    else if (check == ZipCheck::ZipCheckFail) {
-        name = "fail";
-    }
-    else if (check == ZipCheck::ZipCheckUnchecked) {
-        name = "unchecked";
-    }
-    else if (check == ZipCheck::ZipCheckUnavailable) {
-        name = "unavailable";
-    }
-
-    return name;
+    return EnumTable::name(ZIP_CHECKS, check, QLatin1String("unknown"));
 }
 
 }
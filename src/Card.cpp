@@ -2,6 +2,9 @@
 // Qt
 #include <QDate>
 // QStripe
+#include "QStripe/EnumTable.h"
+#include "QStripe/ModelData.h"
+#include "QStripe/ObjectCache.h"
 #include "QStripe/Stripe.h"
 #include "QStripe/Utils.h"
 #include "QStripe/Token.h"
@@ -9,6 +12,155 @@
 namespace QStripe
 {
 
+static constexpr EnumName<Card::CardBrand> CARD_BRANDS[] = {
+    {Card::AmericanExpress, "American Express"},
+    {Card::Discover, "Discover"},
+    {Card::JCB, "JCB"},
+    {Card::DinersClub, "Diners Club"},
+    {Card::Visa, "Visa"},
+    {Card::MasterCard, "MasterCard"},
+    {Card::Unknown, "Unknown"},
+    {Card::UnionPay, "UnionPay"},
+    {Card::Maestro, "Maestro"},
+    {Card::Mir, "Mir"}
+};
+
+static constexpr EnumName<Card::FundingType> FUNDING_TYPES[] = {
+    {Card::FundingCredit, "credit"},
+    {Card::FundingDebit, "debit"},
+    {Card::FundingPrePaid, "prepaid"},
+    {Card::FundingUnknown, "unknown"}
+};
+
+static constexpr EnumName<Card::CVCCheck> CVC_CHECKS[] = {
+    {Card::CVCCheckPass, "pass"},
+    {Card::CVCCheckFail, "fail"},
+    {Card::CVCCheckUnavailable, "unavailable"},
+    {Card::CVCCheckUnchecked, "unchecked"},
+    {Card::CVCCheckUnknown, "unknown"}
+};
+
+static constexpr EnumName<Card::TokenizationMethod> TOKENIZATION_METHODS[] = {
+    {Card::ApplePay, "apple_pay"},
+    {Card::GooglePay, "android_pay"},
+    {Card::TokenizationUnknown, "unknown"}
+};
+
+struct IINRange {
+    // The range is compared with this many leading digits of the card number.
+    int digits;
+    int first;
+    int last;
+    Card::CardBrand brand;
+};
+
+/*
+ * Issuer identification number ranges. They are sorted by the number of digits in descending order, so the first matching range is the most specific one,
+ * e.g 6759 is Maestro even though 67 is MasterCard.
+ * Based on http://en.wikipedia.org/wiki/Bank_card_number#Issuer_identification_number_.28IIN.29
+ */
+static constexpr IINRange IIN_RANGES[] = {
+    {6, 622126, 622925, Card::Discover},
+
+    {4, 2200, 2204, Card::Mir},
+    {4, 2221, 2229, Card::MasterCard},
+    {4, 2720, 2720, Card::MasterCard},
+    {4, 5018, 5018, Card::Maestro},
+    {4, 5020, 5020, Card::Maestro},
+    {4, 5038, 5038, Card::Maestro},
+    {4, 6304, 6304, Card::Maestro},
+    {4, 6759, 6759, Card::Maestro},
+    {4, 6761, 6763, Card::Maestro},
+
+    {3, 223, 229, Card::MasterCard},
+    {3, 270, 271, Card::MasterCard},
+    {3, 300, 305, Card::DinersClub},
+    {3, 309, 309, Card::DinersClub},
+
+    {2, 23, 26, Card::MasterCard},
+    {2, 34, 34, Card::AmericanExpress},
+    {2, 35, 35, Card::JCB},
+    {2, 36, 36, Card::DinersClub},
+    {2, 37, 37, Card::AmericanExpress},
+    {2, 38, 39, Card::DinersClub},
+    {2, 50, 55, Card::MasterCard},
+    {2, 56, 58, Card::Maestro},
+    {2, 60, 60, Card::Discover},
+    {2, 62, 62, Card::UnionPay},
+    {2, 64, 65, Card::Discover},
+    {2, 67, 67, Card::MasterCard},
+    {2, 81, 81, Card::UnionPay},
+
+    {1, 4, 4, Card::Visa}
+};
+
+static constexpr int IIN_RANGE_COUNT = sizeof(IIN_RANGES) / sizeof(IIN_RANGES[0]);
+static constexpr int IIN_MAX_DIGITS = 6;
+
+static constexpr bool isSortedByDigits(int index)
+{
+    return index + 1 >= IIN_RANGE_COUNT || (IIN_RANGES[index].digits >= IIN_RANGES[index + 1].digits && isSortedByDigits(index + 1));
+}
+
+static_assert(isSortedByDigits(0), "IIN_RANGES must be sorted by the number of digits in descending order.");
+
+/**
+ * @brief Returns a mask where the bits from first to last are set.
+ * @param first
+ * @param last
+ * @return quint32
+ */
+static constexpr quint32 lengthRange(int first, int last)
+{
+    return first > last ? 0 : ((1u << first) | lengthRange(first + 1, last));
+}
+
+/**
+ * @brief Returns a mask where every step'th bit is set, starting from first and ending at last.
+ * @param first
+ * @param last
+ * @param step
+ * @return quint32
+ */
+static constexpr quint32 groupEnds(int first, int last, int step)
+{
+    return first > last ? 0 : ((1u << first) | groupEnds(first + step, last, step));
+}
+
+struct BrandInfo {
+    Card::CardBrand brand;
+    // Bit n is set If n is a valid card number length.
+    quint32 lengths;
+    int cvcLength;
+    // Bit n is set If a space is inserted after the nth digit when the card number is formatted.
+    quint32 groupEnds;
+};
+
+// This is indexed by CardBrand.
+static constexpr BrandInfo BRAND_INFOS[] = {
+    // 4-6-5
+    {Card::AmericanExpress, lengthRange(15, 15), 4, groupEnds(4, 10, 6)},
+    {Card::Discover, lengthRange(16, 19), 3, groupEnds(4, 16, 4)},
+    {Card::JCB, lengthRange(16, 19), 3, groupEnds(4, 16, 4)},
+    // 4-6-4
+    {Card::DinersClub, lengthRange(14, 19), 3, groupEnds(4, 10, 6)},
+    {Card::Visa, lengthRange(16, 16) | lengthRange(19, 19), 3, groupEnds(4, 16, 4)},
+    {Card::MasterCard, lengthRange(16, 16), 3, groupEnds(4, 16, 4)},
+    // This is the standard one.
+    {Card::Unknown, lengthRange(16, 16), 3, groupEnds(4, 16, 4)},
+    {Card::UnionPay, lengthRange(16, 19), 3, groupEnds(4, 16, 4)},
+    {Card::Maestro, lengthRange(12, 19), 3, groupEnds(4, 16, 4)},
+    {Card::Mir, lengthRange(16, 19), 3, groupEnds(4, 16, 4)}
+};
+
+static constexpr bool isIndexedByBrand(int index)
+{
+    return index >= static_cast<int>(sizeof(BRAND_INFOS) / sizeof(BRAND_INFOS[0])) ||
+           (BRAND_INFOS[index].brand == index && isIndexedByBrand(index + 1));
+}
+
+static_assert(isIndexedByBrand(0) && sizeof(BRAND_INFOS) / sizeof(BRAND_INFOS[0]) == Card::Mir + 1, "BRAND_INFOS must have an entry for each CardBrand.");
+
 const QString Card::FIELD_ID = "id";
 const QString Card::FIELD_OBJECT = "object";
 const QString Card::FIELD_ADDRESS_PREFIX = "address_";
@@ -31,6 +183,20 @@ const QString Card::FIELD_METADATA = "metadata";
 
 const QString Card::FIELD_CUSTOMER = "customer";
 
+// The token and card update endpoints use `address_zip` instead of `address_postal_code`, and do not accept the zip check.
+static const FieldSchema<AddressData> &tokenAddressSchema()
+{
+    static const FieldSchema<AddressData> addressSchema = FieldSchema<AddressData>()
+            .add(Card::FIELD_ADDRESS_PREFIX + Address::FIELD_COUNTRY, &AddressData::country)
+            .add(Card::FIELD_ADDRESS_PREFIX + Address::FIELD_CITY, &AddressData::city)
+            .add(Card::FIELD_ADDRESS_PREFIX + Address::FIELD_STATE, &AddressData::state)
+            .add(Card::FIELD_ADDRESS_PREFIX + Address::FIELD_LINE_1, &AddressData::lineOne)
+            .add(Card::FIELD_ADDRESS_PREFIX + Address::FIELD_LINE_2, &AddressData::lineTwo)
+            .add(Card::FIELD_ADDRESS_PREFIX + "zip", &AddressData::postalCode);
+
+    return addressSchema;
+}
+
 Card::Card(QObject *parent)
     : QObject(parent)
     , m_CardID("")
@@ -48,9 +214,17 @@ Card::Card(QObject *parent)
     , m_TokenizationMethod(TokenizationMethod::TokenizationUnknown)
     , m_MetaData()
     , m_CardNumber("")
+    , m_LuhnSum(0)
+    , m_ShiftedLuhnSum(0)
+    , m_CardNumberDigitCount(0)
+    , m_CardNumberNonDigitCount(0)
+    , m_BrandPrefix(0)
+    , m_BrandPrefixDigitCount(0)
+    , m_IsBrandPrefixClosed(false)
+    , m_FormattedCardNumber("")
     , m_CVC("")
     , m_Token(new Token(this))
-    , m_NetworkUtils()
+    , m_NetworkUtils(this)
     , m_Error()
     , m_CustomerID("")
     , m_IsValidCardLenght(false)
@@ -59,8 +233,13 @@ Card::Card(QObject *parent)
     , m_IsValidExpirationMonth(false)
     , m_IsValidExpirationYear(false)
     , m_IsValidCVC(false)
+    , m_UpdateDepth(0)
+    , m_PendingSignals()
+    , m_DirtyFields(DirtyNone)
+    , m_SyncedMetadata()
+    , m_SyncedAddress(tokenAddressSchema().variantMap(m_Address.data()))
 {
-    connect(this, &Card::cardNumberChanged, this, &Card::updateCardBrand);
+
 }
 
 QString Card::cardID() const
@@ -83,7 +262,7 @@ void Card::setAddress(Address *addr)
     const bool changed = m_Address != (*addr);
     if (changed) {
         m_Address.set(addr);
-        emit addressChanged();
+        notify(&Card::addressChanged);
     }
 }
 
@@ -102,7 +281,7 @@ void Card::setBrand(const CardBrand &cardBrand)
     const bool changed = m_Brand != cardBrand;
     if (changed) {
         m_Brand = cardBrand;
-        emit brandChanged();
+        notify(&Card::brandChanged);
     }
 }
 
@@ -116,7 +295,7 @@ void Card::setCountry(const QString &country)
     const bool changed = m_Country != country;
     if (changed) {
         m_Country = country;
-        emit countryChanged();
+        notify(&Card::countryChanged);
     }
 }
 
@@ -130,7 +309,7 @@ void Card::setCurrency(const QString &currency)
     const bool changed = m_Currency != currency;
     if (changed) {
         m_Currency = currency;
-        emit currencyChanged();
+        notify(&Card::currencyChanged);
     }
 }
 
@@ -151,7 +330,8 @@ void Card::setExpirationMonth(int month)
         m_ExpirationMonth = month;
         setValidCard(validCard());
         setValidExpirationMonth(validExpirationMonth());
-        emit expirationMonthChanged();
+        markDirty(DirtyExpirationMonth);
+        notify(&Card::expirationMonthChanged);
     }
 }
 
@@ -167,7 +347,8 @@ void Card::setExpirationYear(int year)
         m_ExpirationYear = year;
         setValidCard(validCard());
         setValidExpirationYear(validExpirationYear());
-        emit expirationYearChanged();
+        markDirty(DirtyExpirationYear);
+        notify(&Card::expirationYearChanged);
     }
 }
 
@@ -181,7 +362,7 @@ void Card::setFingerprint(const QString &fingerprint)
     const bool changed = m_Fingerprint != fingerprint;
     if (changed) {
         m_Fingerprint = fingerprint;
-        emit fingerprintChanged();
+        notify(&Card::fingerprintChanged);
     }
 }
 
@@ -195,7 +376,7 @@ void Card::setFunding(const FundingType &type)
     const bool changed = m_FundingType != type;
     if (changed) {
         m_FundingType = type;
-        emit fundingChanged();
+        notify(&Card::fundingChanged);
     }
 }
 
@@ -209,7 +390,8 @@ void Card::setName(const QString &name)
     const bool changed = m_Name != name;
     if (changed) {
         m_Name = name;
-        emit nameChanged();
+        markDirty(DirtyName);
+        notify(&Card::nameChanged);
     }
 }
 
@@ -223,7 +405,7 @@ void Card::setLastFourDigits(const QString &lastDigits)
     const bool changed = m_LastFourDigits != lastDigits;
     if (changed) {
         m_LastFourDigits = lastDigits;
-        emit lastFourDigitsChanged();
+        notify(&Card::lastFourDigitsChanged);
     }
 }
 
@@ -237,7 +419,7 @@ void Card::setTokenizationMethod(const TokenizationMethod &method)
     const bool changed = m_TokenizationMethod != method;
     if (changed) {
         m_TokenizationMethod = method;
-        emit tokenizationMethodChanged();
+        notify(&Card::tokenizationMethodChanged);
     }
 }
 
@@ -251,7 +433,8 @@ void Card::setMetaData(const QVariantMap &data)
     const bool changed = m_MetaData != data;
     if (changed) {
         m_MetaData = data;
-        emit metaDataChanged();
+        markDirty(DirtyMetadata);
+        notify(&Card::metaDataChanged);
     }
 }
 
@@ -260,15 +443,31 @@ QString Card::cardNumber() const
     return m_CardNumber;
 }
 
+QString Card::formattedCardNumber() const
+{
+    return m_FormattedCardNumber;
+}
+
 void Card::setCardNumber(const QString &number)
 {
     const bool changed = m_CardNumber != number;
     if (changed) {
+        const QString previousNumber = m_CardNumber;
+        const bool wasValidCardNumber = m_IsValidCardNumber;
+        const CardBrand previousBrand = m_Brand;
         m_CardNumber = number;
+        updateCardNumberState(previousNumber);
+        // Called directly instead of through cardNumberChanged() so that the brand is updated before the rest of a batched update.
+        updateCardBrand();
         setValidCardNumber(validCardNumber());
-        setValidCard(validCard());
+        // The rest of validCard() depends on the brand, the CVC and the expiration date. So it only needs to be checked again If the validity of the number
+        // or the brand changed, which avoids reading the current date for every typed digit.
+        if (m_IsValidCardNumber != wasValidCardNumber || m_Brand != previousBrand) {
+            setValidCard(validCard());
+        }
+
         setValidCardNumberLenght(validCardLenght());
-        emit cardNumberChanged();
+        notify(&Card::cardNumberChanged);
     }
 }
 
@@ -284,87 +483,14 @@ void Card::setCvc(const QString &cvcNumber)
         m_CVC = cvcNumber;
         setValidCard(validCard());
         setValidCVC(validCVC());
-        emit cvcChanged();
+        notify(&Card::cvcChanged);
     }
 }
 
 QVariantMap Card::json(bool omitEmpty) const
 {
-    QVariantMap data;
-
-    if ((omitEmpty && m_CardID.length() > 0) || !omitEmpty) {
-        data[FIELD_ID] = cardID();
-    }
-
-    if ((omitEmpty && m_Brand != CardBrand::Unknown) || !omitEmpty) {
-        data[FIELD_BRAND] = cardBrandName(brand());
-    }
-
-    if ((omitEmpty && m_Country.length() > 0) || !omitEmpty) {
-        data[FIELD_COUNTRY] = m_Country;
-    }
-
-    if ((omitEmpty && m_Currency.length() > 0) || !omitEmpty) {
-        data[FIELD_CURRENCY] = m_Currency;
-    }
-
-    if ((omitEmpty && m_CVCCheck != CVCCheckUnknown) || !omitEmpty) {
-        data[FIELD_CVC_CHECK] = cvcCheckName(cvcCheck());
-    }
-
-    if ((omitEmpty && m_ExpirationMonth > 0) || !omitEmpty) {
-        data[FIELD_EXP_MONTH] = m_ExpirationMonth;
-    }
-
-    if ((omitEmpty && m_ExpirationYear > 0) || !omitEmpty) {
-        data[FIELD_EXP_YEAR] = m_ExpirationYear;
-    }
-
-    if ((omitEmpty && m_Fingerprint.length() > 0) || !omitEmpty) {
-        data[FIELD_FINGERPRINT] = m_Fingerprint;
-    }
-
-    if ((omitEmpty && m_FundingType != FundingUnknown) || !omitEmpty) {
-        data[FIELD_FUNDING] = fundingTypeString(funding());
-    }
-
-    if ((omitEmpty && m_Name.length() > 0) || !omitEmpty) {
-        data[FIELD_NAME] = m_Name;
-    }
-
-    if ((omitEmpty && m_LastFourDigits.length() > 0) || !omitEmpty) {
-        data[FIELD_LAST4] = m_LastFourDigits;
-    }
-
-    if ((omitEmpty && m_TokenizationMethod != TokenizationUnknown) || !omitEmpty) {
-        data[FIELD_TOKENIZATION_METHOD] = tokenizationMethodName(tokenizationMethod());
-    }
-
-    if ((omitEmpty && m_MetaData.size() > 0) || !omitEmpty) {
-        for (auto it = m_MetaData.constBegin(); it != m_MetaData.constEnd(); it++) {
-            const QString key = FIELD_METADATA + "[" + it.key() + "]";
-            const QVariant &value = it.value();
-
-            if (value.type() == QVariant::String) {
-                data[key] = value.toString();
-            }
-            else if (value.type() == QVariant::Int) {
-                data[key] = value.toInt();
-            }
-            else if (value.type() == QVariant::Int) {
-                data[key] = value.toInt();
-            }
-        }
-    }
-
-    const QVariantMap addressData = m_Address.json(FIELD_ADDRESS_PREFIX);
-    for (auto it = addressData.constBegin(); it != addressData.constEnd(); it++) {
-        if ((omitEmpty && it.value().toString().length() > 0) || !omitEmpty) {
-            data[it.key()] = it.value().toString();
-        }
-    }
-
-    return data;
+    // The metadata is written as `metadata[key]`, and the address fields have the `address_` prefix.
+    return CardData::schema().formData(data(), omitEmpty);
 }
 
 QString Card::jsonString(bool omitEmpty) const
@@ -373,43 +499,28 @@ QString Card::jsonString(bool omitEmpty) const
 }
 
 Card::CardBrand Card::possibleCardBrand() const
+{
+    return cardBrandForPrefix(m_BrandPrefix, m_BrandPrefixDigitCount);
+}
+
+Card::CardBrand Card::cardBrandForPrefix(int prefix, int digitCount)
 {
     CardBrand cardType = CardBrand::Unknown;
-    QString number = m_CardNumber;
-    number.remove("\\s|-");
-    if (number.length() < 4) {
+    if (digitCount < 4 || digitCount > IIN_MAX_DIGITS) {
         return cardType;
     }
 
-    auto hasPrefix = [&number](const QVector<QString> &prefix) {
-        bool has = false;
-        for (const QString &str : prefix) {
-            if (number.startsWith(str)) {
-                has = true;
-                break;
-            }
-        }
-
-        return has;
-    };
-
-    if (hasPrefix(prefixes(CardBrand::AmericanExpress))) {
-        cardType = CardBrand::AmericanExpress;
+    // leadingDigits[n] is the number that is formed by the first n digits, e.g leadingDigits[2] is 37 for an American Express card.
+    int leadingDigits[IIN_MAX_DIGITS + 1] = {0};
+    for (int count = digitCount, value = prefix; count > 0; count--, value /= 10) {
+        leadingDigits[count] = value;
     }
-    else if (hasPrefix(prefixes(CardBrand::Discover))) {
-        cardType = CardBrand::Discover;
-    }
-    else if (hasPrefix(prefixes(CardBrand::JCB))) {
-        cardType = CardBrand::JCB;
-    }
-    else if (hasPrefix(prefixes(CardBrand::DinersClub))) {
-        cardType = CardBrand::DinersClub;
-    }
-    else if (hasPrefix(prefixes(CardBrand::Visa))) {
-        cardType = CardBrand::Visa;
-    }
-    else if (hasPrefix(prefixes(CardBrand::MasterCard))) {
-        cardType = CardBrand::MasterCard;
+
+    for (const IINRange &range : IIN_RANGES) {
+        if (range.digits <= digitCount && leadingDigits[range.digits] >= range.first && leadingDigits[range.digits] <= range.last) {
+            cardType = range.brand;
+            break;
+        }
     }
 
     return cardType;
@@ -422,35 +533,18 @@ QStripe::Token *Card::token()
 
 bool Card::validCardLenght() const
 {
-    return maxCardNumberLenght(brand()) == m_CardNumber.length();
+    return validCardNumberLength(brand(), m_CardNumber.length());
 }
 
-bool Card::validCardNumber() const
+bool Card::validCardNumberLength(CardBrand brand, int length)
 {
-    bool isOdd = true;
-    int sum = 0;
-
-    for (int index = m_CardNumber.length() - 1; index >= 0; index--) {
-        const QChar digit = m_CardNumber.at(index);
-        if (!digit.isDigit()) {
-            return false;
-        }
-
-        int digitInteger = digit.digitValue();
-        isOdd = !isOdd;
-
-        if (isOdd) {
-            digitInteger *= 2;
-        }
-
-        if (digitInteger > 9) {
-            digitInteger -= 9;
-        }
-
-        sum += digitInteger;
-    }
+    return length >= 0 && length < 32 && (BRAND_INFOS[brand].lengths & (1u << length)) != 0;
+}
 
-    return (sum % 10 == 0) && validCardLenght();
+bool Card::validCardNumber() const
+{
+    // The Luhn sum is updated in setCardNumber().
+    return m_CardNumberNonDigitCount == 0 && (m_LuhnSum % 10 == 0) && validCardLenght();
 }
 
 bool Card::validExpirationMonth() const
@@ -462,7 +556,7 @@ bool Card::validExpirationYear() const
 {
     // Normilize the year first. Year can be a two digit or 4 digit number.
     const QDate today = QDate::currentDate();
-    int year = normilizedYear(m_ExpirationYear);
+    const int year = normilizedYear(m_ExpirationYear, today);
 
     bool isValid = true;
 
@@ -478,13 +572,12 @@ bool Card::validExpirationYear() const
 
 bool Card::validExpirationDate() const
 {
-    bool isValid = validExpirationMonth() && validExpirationYear();
+    const QDate today = QDate::currentDate();
+    const int year = normilizedYear(m_ExpirationYear, today);
+    bool isValid = validExpirationMonth() && year != 0 && year >= today.year();
     // If the expiration year and month is valid, check If the month is in the past and return false If it is.
-    if (isValid) {
-        const QDate today = QDate::currentDate();
-        if (today.year() == normilizedYear(m_ExpirationYear)) {
-            isValid = m_ExpirationMonth >= today.month();
-        }
+    if (isValid && today.year() == year) {
+        isValid = m_ExpirationMonth >= today.month();
     }
 
     return isValid;
@@ -516,12 +609,13 @@ void Card::setCustomerID(const QString &id)
     const bool changed = m_CustomerID != id;
     if (changed) {
         m_CustomerID = id;
-        emit customerIDChanged();
+        notify(&Card::customerIDChanged);
     }
 }
 
 void Card::set(Card *other)
 {
+    beginUpdate();
     setCardID(other->cardID());
     setCardNumber(other->cardNumber());
     setCvc(other->cvc());
@@ -543,9 +637,10 @@ void Card::set(Card *other)
     setTokenizationMethod(other->tokenizationMethod());
 
     setBrand(other->brand());
+    endUpdate();
 }
 
-bool Card::createToken()
+bool Card::createToken(const QString &idempotencyKey)
 {
     if (Stripe::publishableKey().length() == 0) {
         qDebug() << "[ERROR] publishableKey is not set in the Stripe instance. Cannot send the request.";
@@ -563,11 +658,9 @@ bool Card::createToken()
     }
 
     auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+        const QJsonObject data = Utils::toJsonObject(response.body);
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
-            Token *token = Token::fromJson(data);
-            m_Token->set(token);
-            token->deleteLater();
+            m_Token->applyJson(data);
             emit tokenCreated();
         }
         else {
@@ -583,7 +676,8 @@ bool Card::createToken()
     }
 
     QVariantMap data = jsonForTokenCreation();
-    m_NetworkUtils.sendPost(Token::getURL(), data, callback);
+    // A user is usually waiting for the token, so it goes ahead of the background requests.
+    m_NetworkUtils.sendPost(Token::getURL(), data, callback, idempotencyKey, NetworkTransport::PriorityInteractive);
     return true;
 }
 
@@ -600,16 +694,13 @@ void Card::fetchToken(const QString &tokenID)
     }
 
     auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+        const QJsonObject data = response.json();
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
-            Token *token = Token::fromJson(data);
-            Card *card = Card::fromJson(data["card"].toMap());
-
-            this->set(card);
-            m_Token->set(token);
-
-            token->deleteLater();
-            card->deleteLater();
+            applyJson(data["card"].toObject());
+            m_Token->applyJson(data);
+            // The API never returns the number and the CVC, and they are not kept once the card is stored.
+            setCardNumber("");
+            setCvc("");
             emit tokenFetched();
         }
         else {
@@ -627,7 +718,7 @@ void Card::fetchToken(const QString &tokenID)
     m_NetworkUtils.sendGet(Token::getURL(tokenID), callback);
 }
 
-bool Card::create(QString customerID)
+bool Card::create(QString customerID, const QString &idempotencyKey)
 {
     if (Stripe::secretKey().length() == 0) {
         qDebug() << "[ERROR] secretKey is not set in the Stripe instance. Cannot send the request.";
@@ -651,11 +742,12 @@ bool Card::create(QString customerID)
     }
 
     auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+        const QJsonObject data = Utils::toJsonObject(response.body);
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
-            Card *card = Card::fromJson(data);
-            set(card);
-            card->deleteLater();
+            applyJson(data);
+            // The API never returns the number and the CVC, and they are not kept once the card is stored.
+            setCardNumber("");
+            setCvc("");
             emit created();
         }
         else {
@@ -672,7 +764,7 @@ bool Card::create(QString customerID)
 
     QVariantMap data;
     data["source"] = m_Token->tokenID();
-    m_NetworkUtils.sendPost(getURL(customerID), data, callback);
+    m_NetworkUtils.sendPost(getURL(customerID), data, callback, idempotencyKey);
     return true;
 }
 
@@ -695,9 +787,11 @@ bool Card::deleteCard(QString customerID)
         return false;
     }
 
-    auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+    const QString cardID = m_CardID;
+    auto callback = [this, cardID, customerID](const Response & response) {
+        const QJsonObject data = Utils::toJsonObject(response.body);
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
+            ObjectCache::remove(ObjectCache::cardKey(customerID, cardID));
             emit deleted();
         }
         else {
@@ -716,207 +810,171 @@ bool Card::deleteCard(QString customerID)
     return true;
 }
 
-void Card::clear()
+bool Card::update(QString customerID, const QString &idempotencyKey)
 {
-    m_CardID = "";
-    emit cardIDChanged();
-
-    m_Address.clear();
-    emit addressChanged();
+    if (Stripe::secretKey().length() == 0) {
+        qDebug() << "[ERROR] secretKey is not set in the Stripe instance. Cannot send the request.";
+        return false;
+    }
 
-    m_Brand = CardBrand::Unknown;
-    emit brandChanged();
+    if (m_CardID.length() == 0) {
+        return false;
+    }
 
-    m_Country = "";
-    emit countryChanged();
+    if (customerID.length() == 0) {
+        customerID = getCustomerID();
+    }
 
-    m_Currency = "";
-    emit currencyChanged();
+    if (customerID.length() == 0) {
+        return false;
+    }
 
-    m_CVCCheck = CVCCheck::CVCCheckUnknown;
-    emit cvcCheckChanged();
+    const QVariantMap data = updateData();
+    if (data.isEmpty()) {
+        qDebug() << "[INFO] None of the card fields have changed. Skipping the update.";
+        return false;
+    }
 
-    m_ExpirationMonth = 0;
-    emit expirationMonthChanged();
+    const QString cardID = m_CardID;
+    auto callback = [this, cardID, customerID](const Response & response) {
+        const QJsonObject data = Utils::toJsonObject(response.body);
+        if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
+            // Refresh the cached card so that the next fetch does not return the old values.
+            ObjectCache::insert(ObjectCache::cardKey(customerID, cardID), data, response.body.size(), ObjectCache::customerKey(customerID));
+            applyJson(data);
+            emit updated();
+        }
+        else {
+            qDebug() << "[ERROR] Error occurred while updating the card.";
+            m_Error.set(data, response.httpStatus, response.networkError);
+            emit errorOccurred(&m_Error);
+        }
+    };
 
-    m_ExpirationYear = 0;
-    emit expirationYearChanged();
+    m_NetworkUtils.setHeader("Authorization", "Bearer " + Stripe::secretKey());
+    if (Stripe::apiVersion().length() > 0) {
+        m_NetworkUtils.setHeader("Stripe-Version", Stripe::apiVersion());
+    }
 
-    m_Fingerprint = "";
-    emit fingerprintChanged();
+    m_NetworkUtils.sendPost(getURL(customerID, m_CardID), data, callback, idempotencyKey);
+    return true;
+}
 
-    m_FundingType = FundingType::FundingUnknown;
-    emit fundingChanged();
+bool Card::isDirty() const
+{
+    return updateData().size() > 0;
+}
 
-    m_Name = "";
-    emit nameChanged();
+void Card::clear()
+{
+    beginUpdate();
+    setCardID("");
+    if (m_Address.data() != AddressData()) {
+        m_Address.clear();
+        notify(&Card::addressChanged);
+    }
 
-    m_LastFourDigits = "";
-    emit lastFourDigitsChanged();
+    setBrand(CardBrand::Unknown);
+    setCountry("");
+    setCurrency("");
 
-    m_TokenizationMethod = TokenizationMethod::TokenizationUnknown;
-    emit tokenizationMethodChanged();
+    setCVCCheck(CVCCheck::CVCCheckUnknown);
+    setExpirationMonth(0);
+    setExpirationYear(0);
 
-    m_MetaData.clear();
-    emit metaDataChanged();
+    setFingerprint("");
+    setFunding(FundingType::FundingUnknown);
+    setName("");
 
-    m_CardNumber = "";
-    emit cardNumberChanged();
+    setLastFourDigits("");
+    setTokenizationMethod(TokenizationMethod::TokenizationUnknown);
+    setMetaData(QVariantMap());
 
-    m_CVC = "";
-    emit cvcChanged();
+    setCardNumber("");
+    setCvc("");
 
     m_Token->clear();
     m_Error.clear();
 
-    m_CustomerID = "";
-    emit customerIDChanged();
+    setCustomerID("");
+    markSynced();
+    endUpdate();
 
     emit cleared();
 }
 
-const Error *Card::lastError() const
+void Card::beginUpdate()
 {
-    return &m_Error;
+    m_UpdateDepth++;
 }
 
-QString Card::cardBrandName(CardBrand brand)
+void Card::endUpdate()
 {
-    QString name;
-    if (brand == CardBrand::AmericanExpress) {
-        name = "American Express";
-    }
-    else if (brand == CardBrand::Discover) {
-        name = "Discover";
-    }
-    else if (brand == CardBrand::JCB) {
-        name = "JCB";
-    }
-    else if (brand == CardBrand::DinersClub) {
-        name = "Diners Club";
-    }
-    else if (brand == CardBrand::Visa) {
-        name = "Visa";
-    }
-    else if (brand == CardBrand::MasterCard) {
-        name = "MasterCard";
-    }
-    else if (brand == CardBrand::Unknown) {
-        name = "Unknown";
+    if (m_UpdateDepth == 0) {
+        qDebug() << "[WARNING] endUpdate() is called without a matching beginUpdate().";
+        return;
     }
 
-    return name;
+    m_UpdateDepth--;
+    if (m_UpdateDepth == 0) {
+        const QVector<ChangedSignal> pendingSignals = m_PendingSignals;
+        m_PendingSignals.clear();
+        for (ChangedSignal changedSignal : pendingSignals) {
+            (this->*changedSignal)();
+        }
+    }
 }
 
-Card::CardBrand Card::cardBrandType(const QString &name)
+void Card::notify(ChangedSignal changedSignal)
 {
-    CardBrand brand;
-    if (name == "American Express") {
-        brand = CardBrand::AmericanExpress;
-    }
-    else if (name == "Discover") {
-        brand = CardBrand::Discover;
-    }
-    else if (name == "JCB") {
-        brand = CardBrand::JCB;
-    }
-    else if (name == "Diners Club") {
-        brand = CardBrand::DinersClub;
-    }
-    else if (name == "Visa") {
-        brand = CardBrand::Visa;
-    }
-    else if (name == "MasterCard") {
-        brand = CardBrand::MasterCard;
+    if (m_UpdateDepth > 0) {
+        if (m_PendingSignals.contains(changedSignal) == false) {
+            m_PendingSignals.append(changedSignal);
+        }
     }
     else {
-        brand = CardBrand::Unknown;
+        (this->*changedSignal)();
     }
+}
+
+const Error *Card::lastError() const
+{
+    return &m_Error;
+}
 
-    return brand;
+QString Card::cardBrandName(CardBrand brand)
+{
+    return EnumTable::name(CARD_BRANDS, brand);
 }
 
-QString Card::fundingTypeString(FundingType type)
+Card::CardBrand Card::cardBrandType(const QString &name)
 {
-    QString name;
-    if (type == FundingType::FundingCredit) {
-        name = "credit";
-    }
-    else if (type == FundingType::FundingDebit) {
-        name = "debit";
-    }
-    else if (type == FundingType::FundingPrePaid) {
-        name = "prepaid";
-    }
-    else if (type == FundingType::FundingUnknown) {
-        name = "unknown";
-    }
+    return EnumTable::value(CARD_BRANDS, name, CardBrand::Unknown);
+}
 
-    return name;
+QString Card::fundingTypeString(FundingType type)
+{
+    return EnumTable::name(FUNDING_TYPES, type);
 }
 
 Card::FundingType Card::fundingType(const QString &name)
 {
-    FundingType type;
-    if (name == "credit") {
-        type = FundingType::FundingCredit;
-    }
-    else if (name == "debit") {
-        type = FundingType::FundingDebit;
-    }
-    else if (name == "prepaid") {
-        type = FundingType::FundingPrePaid;
-    }
-    else {
-        type = FundingType::FundingUnknown;
-    }
-
-    return type;
+    return EnumTable::value(FUNDING_TYPES, name, FundingType::FundingUnknown);
 }
 
 Card::CVCCheck Card::cvcCheckType(const QString &name)
 {
-    CVCCheck type = CVCCheck::CVCCheckUnknown;
-    if (name == "pass") {
-        type = CVCCheck::CVCCheckPass;
-    }
-    else if (name == "fail") {
-        type = CVCCheck::CVCCheckFail;
-    }
-    else if (name == "unavailable") {
-        type = CVCCheck::CVCCheckUnavailable;
-    }
-    else if (name == "unchecked") {
-        type = CVCCheck::CVCCheckUnchecked;
-    }
-
-    return type;
+    return EnumTable::value(CVC_CHECKS, name, CVCCheck::CVCCheckUnknown);
 }
 
 Card::TokenizationMethod Card::tokenizationMethodType(const QString &name)
 {
-    TokenizationMethod method = TokenizationUnknown;
-    if (name == "apple_pay") {
-        method = ApplePay;
-    }
-    else if (name == "android_pay") {
-        method = GooglePay;
-    }
-
-    return method;
+    return EnumTable::value(TOKENIZATION_METHODS, name, TokenizationUnknown);
 }
 
 QString Card::tokenizationMethodName(TokenizationMethod method)
 {
-    QString name = "unknown";
-    if (method == ApplePay) {
-        name = "apple_pay";
-    }
-    else if (method == GooglePay) {
-        name = "android_pay";
-    }
-
-    return name;
+    return EnumTable::name(TOKENIZATION_METHODS, method, QLatin1String("unknown"));
 }
 
 Card *Card::fromJson(const QVariantMap &data)
@@ -979,115 +1037,118 @@ Card *Card::fromJson(const QVariantMap &data)
     card->setAddress(addr);
     addr->deleteLater();
 
+    card->markSynced();
     return card;
 }
 
-Card *Card::fromString(const QString &dataStr)
+Card *Card::fromJson(const QJsonObject &object)
 {
-    return fromJson(Utils::toVariantMap(dataStr));
+    return fromData(CardData::fromJson(object));
 }
 
-QString Card::getURL(const QString &customerID, const QString &cardID)
+Card *Card::fromData(const CardData &data)
 {
-    QString url = "https://api.stripe.com/v1/customers/" + customerID + "/sources";
-    if (cardID.length() > 0) {
-        url += "/" + cardID;
-    }
+    Card *card = new Card();
+    card->applyData(data);
+    card->markSynced();
 
-    return url;
+    return card;
 }
 
-QString Card::cvcCheckName(CVCCheck type)
+CardData Card::data() const
 {
-    QString name = "unknown";
-    if (type == CVCCheck::CVCCheckPass) {
-        name = "pass";
-    }
-    else if (type == CVCCheck::CVCCheckFail) {
-        name = "fail";
-    }
-    else if (type == CVCCheck::CVCCheckUnavailable) {
-        name = "unavailable";
-    }
-    else if (type == CVCCheck::CVCCheckUnchecked) {
-        name = "unchecked";
-    }
+    CardData data;
+    data.cardID = m_CardID;
+    data.brand = m_Brand;
+    data.country = m_Country;
+
+    data.currency = m_Currency;
+    data.cvcCheck = m_CVCCheck;
+    data.expirationMonth = m_ExpirationMonth;
+
+    data.expirationYear = m_ExpirationYear;
+    data.fingerprint = m_Fingerprint;
+    data.funding = m_FundingType;
+
+    data.name = m_Name;
+    data.lastFourDigits = m_LastFourDigits;
+    data.tokenizationMethod = m_TokenizationMethod;
 
-    return name;
+    data.metadata = m_MetaData;
+    data.address = m_Address.data();
+
+    return data;
 }
 
-void Card::setCardID(const QString &id)
+void Card::applyData(const CardData &data)
 {
-    const bool changed = m_CardID != id;
-    if (changed) {
-        m_CardID = id;
-        emit cardIDChanged();
+    setCardID(data.cardID);
+    setBrand(data.brand);
+    setCountry(data.country);
+
+    setCurrency(data.currency);
+    setCVCCheck(data.cvcCheck);
+    setExpirationMonth(data.expirationMonth);
+
+    setExpirationYear(data.expirationYear);
+    setFingerprint(data.fingerprint);
+    setFunding(data.funding);
+
+    setName(data.name);
+    setLastFourDigits(data.lastFourDigits);
+    setTokenizationMethod(data.tokenizationMethod);
+
+    setMetaData(data.metadata);
+    if (data.address != m_Address.data()) {
+        m_Address.setData(data.address);
+        notify(&Card::addressChanged);
     }
 }
 
-QVector<QString> Card::prefixes(CardBrand brand) const
+void Card::applyJson(const QJsonObject &object)
 {
-    QVector<QString> numberPrefixes;
+    // The fields that are not in object, including the card number and the CVC, keep their current value.
+    CardData card = data();
+    CardData::schema().read(card, object);
 
-    if (brand == CardBrand::AmericanExpress) {
-        numberPrefixes = QVector<QString> {"34", "37"};
-    }
-    else if (brand == CardBrand::Discover) {
-        numberPrefixes = QVector<QString> {"60", "62", "64", "65"};
-    }
-    else if (brand == CardBrand::JCB) {
-        numberPrefixes = QVector<QString> {"35"};
-    }
-    else if (brand == CardBrand::DinersClub) {
-        numberPrefixes = QVector<QString> {
-            "300", "301", "302", "303", "304",
-            "305", "309", "36", "38", "39"
-        };
-    }
-    else if (brand == CardBrand::Visa) {
-        numberPrefixes = QVector<QString> {"4"};
-    }
-    else if (brand == CardBrand::MasterCard) {
-        numberPrefixes = QVector<QString> {
-            "2221", "2222", "2223", "2224",
-            "2225", "2226", "2227", "2228",
-            "2229", "223", "224", "225",
-            "226", "227", "228", "229",
-            "23", "24", "25", "26",
-            "270", "271", "2720", "50",
-            "51", "52", "53", "54",
-            "55", "67"
-        };
-    }
-
-    return numberPrefixes;
+    beginUpdate();
+    applyData(card);
+    markSynced();
+    endUpdate();
 }
 
-int Card::maxCardNumberLenght(CardBrand brand) const
+Card *Card::fromString(const QString &dataStr)
 {
-    // This is the standard one.
-    int length = 16;
+    return fromJson(Utils::toVariantMap(dataStr));
+}
 
-    if (brand == CardBrand::AmericanExpress) {
-        length = 15;
-    }
-    else if (brand == CardBrand::DinersClub) {
-        length = 14;
+QString Card::getURL(const QString &customerID, const QString &cardID)
+{
+    QString url = Stripe::apiBaseUrl() + "/customers/" + customerID + "/sources";
+    if (cardID.length() > 0) {
+        url += "/" + cardID;
     }
 
-    return length;
+    return url;
 }
 
-int Card::maxCVCLenght(CardBrand brand) const
+QString Card::cvcCheckName(CVCCheck type)
 {
-    // This is the standard one.
-    int length = 3;
+    return EnumTable::name(CVC_CHECKS, type, QLatin1String("unknown"));
+}
 
-    if (brand == CardBrand::AmericanExpress) {
-        length = 4;
+void Card::setCardID(const QString &id)
+{
+    const bool changed = m_CardID != id;
+    if (changed) {
+        m_CardID = id;
+        notify(&Card::cardIDChanged);
     }
+}
 
-    return length;
+int Card::maxCVCLenght(CardBrand brand) const
+{
+    return BRAND_INFOS[brand].cvcLength;
 }
 
 void Card::setCVCCheck(CVCCheck check)
@@ -1095,7 +1156,7 @@ void Card::setCVCCheck(CVCCheck check)
     const bool changed = m_CVCCheck != check;
     if (changed) {
         m_CVCCheck = check;
-        emit cvcCheckChanged();
+        notify(&Card::cvcCheckChanged);
     }
 }
 
@@ -1104,7 +1165,7 @@ void Card::setValidCard(bool valid)
     const bool changed = m_IsValidCard != valid;
     if (changed) {
         m_IsValidCard = valid;
-        emit validCardChanged();
+        notify(&Card::validCardChanged);
     }
 }
 
@@ -1120,7 +1181,7 @@ void Card::setValidCardNumber(bool valid)
             setLastFourDigits("");
         }
 
-        emit validCardNumberChanged();
+        notify(&Card::validCardNumberChanged);
     }
 }
 
@@ -1129,7 +1190,7 @@ void Card::setValidCardNumberLenght(bool valid)
     const bool changed = m_IsValidCardLenght != valid;
     if (changed) {
         m_IsValidCardLenght = valid;
-        emit validCardLenghtChanged();
+        notify(&Card::validCardLenghtChanged);
     }
 }
 
@@ -1138,7 +1199,7 @@ void Card::setValidExpirationMonth(bool valid)
     const bool changed = m_IsValidExpirationMonth != valid;
     if (changed) {
         m_IsValidExpirationMonth = valid;
-        emit validExpirationMonthChanged();
+        notify(&Card::validExpirationMonthChanged);
     }
 }
 
@@ -1147,7 +1208,7 @@ void Card::setValidExpirationYear(bool valid)
     const bool changed = m_IsValidExpirationYear != valid;
     if (changed) {
         m_IsValidExpirationYear = valid;
-        emit validExpirationYearChanged();
+        notify(&Card::validExpirationYearChanged);
     }
 }
 
@@ -1155,8 +1216,8 @@ void Card::setValidCVC(bool valid)
 {
     const bool changed = m_IsValidCVC != valid;
     if (changed) {
-        m_IsValidCardLenght = valid;
-        emit validCVCChanged();
+        m_IsValidCVC = valid;
+        notify(&Card::validCVCChanged);
     }
 }
 
@@ -1167,38 +1228,65 @@ void Card::updateCardBrand()
 
 QVariantMap Card::jsonForTokenCreation() const
 {
-    QVariantMap data;
+    // The card fields are nested under `card`. NetworkUtils encodes them as `card[field]`.
+    QVariantMap card = tokenAddressSchema().variantMap(m_Address.data());
+    card[FIELD_EXP_MONTH] = m_ExpirationMonth;
+    card[FIELD_EXP_YEAR] = m_ExpirationYear;
 
-    auto wrap = [](const QString & key) {
-        return "card[" + key + "]";
-    };
+    card[FIELD_NAME] = m_Name;
+    card["cvc"] = m_CVC;
+    card["number"] = m_CardNumber;
 
+    QVariantMap data;
     data[FIELD_CURRENCY] = m_Currency;
-    data[wrap(FIELD_EXP_MONTH)] = m_ExpirationMonth;
-    data[wrap(FIELD_EXP_YEAR)] = m_ExpirationYear;
+    data["card"] = card;
+    return data;
+}
 
-    data[wrap(FIELD_NAME)] = m_Name;
-    data[wrap("cvc")] = m_CVC;
-    data[wrap("number")] = m_CardNumber;
+QVariantMap Card::updateData() const
+{
+    QVariantMap data;
+    if (m_DirtyFields & DirtyName) {
+        data[FIELD_NAME] = m_Name;
+    }
 
-    const QVariantMap addressData = m_Address.json(FIELD_ADDRESS_PREFIX);
-    for (auto it = addressData.constBegin(); it != addressData.constEnd(); it++) {
-        const QString value = it.value().toString();
-        data[wrap(it.key())] = value;
+    if (m_DirtyFields & DirtyExpirationMonth) {
+        data[FIELD_EXP_MONTH] = m_ExpirationMonth;
     }
 
-    if (data.contains(wrap(FIELD_ADDRESS_PREFIX + Address::FIELD_POSTAL_CODE))) {
-        data[wrap(FIELD_ADDRESS_PREFIX + "zip")] = data[wrap(FIELD_ADDRESS_PREFIX + Address::FIELD_POSTAL_CODE)];
-        data.remove(wrap(FIELD_ADDRESS_PREFIX + Address::FIELD_POSTAL_CODE));
+    if (m_DirtyFields & DirtyExpirationYear) {
+        data[FIELD_EXP_YEAR] = m_ExpirationYear;
     }
 
-    if (data.contains(wrap(FIELD_ADDRESS_PREFIX + Address::FIELD_ZIP_CHECK))) {
-        data.remove(wrap(FIELD_ADDRESS_PREFIX + Address::FIELD_ZIP_CHECK));
+    if (m_DirtyFields & DirtyMetadata) {
+        const QVariantMap metadata = Utils::changedEntries(m_MetaData, m_SyncedMetadata);
+        if (metadata.size() > 0) {
+            data[FIELD_METADATA] = metadata;
+        }
+    }
+
+    const QVariantMap address = tokenAddressSchema().variantMap(m_Address.data());
+    for (auto it = address.constBegin(); it != address.constEnd(); it++) {
+        if (m_SyncedAddress.value(it.key()) != it.value()) {
+            data[it.key()] = it.value();
+        }
     }
 
     return data;
 }
 
+void Card::markDirty(DirtyField field)
+{
+    m_DirtyFields |= field;
+}
+
+void Card::markSynced()
+{
+    m_DirtyFields = DirtyNone;
+    m_SyncedMetadata = m_MetaData;
+    m_SyncedAddress = tokenAddressSchema().variantMap(m_Address.data());
+}
+
 QString Card::getCustomerID() const
 {
     QString id = "";
@@ -1218,17 +1306,114 @@ QString Card::getCustomerID() const
     return id;
 }
 
-int Card::normilizedYear(int year) const
+int Card::normilizedYear(int year, const QDate &today) const
 {
+    // The missing digits are taken from the current year, e.g 25 is 2025 and 5 is 2025.
     if (year < 100 && year >= 0) {
-        const QDate today = QDate::currentDate();
-        const QString yearStr = QString::number(year);
-        const QString currentYearStr = QString::number(today.year());
-        const QString yearPrefix = currentYearStr.left(currentYearStr.length() - yearStr.length());
-        year = QString(yearPrefix + yearStr).toInt();
+        const int base = year < 10 ? 10 : 100;
+        year = today.year() / base * base + year;
     }
 
     return year;
 }
 
+void Card::updateCardNumberState(const QString &previousNumber)
+{
+    // A text field changes the card number one character at a time, so only that character is processed.
+    bool isUpdated = false;
+    if (m_CardNumber.length() == previousNumber.length() + 1 && m_CardNumber.startsWith(previousNumber)) {
+        appendCardNumberCharacter(m_CardNumber.at(m_CardNumber.length() - 1));
+        isUpdated = true;
+    }
+    else if (m_CardNumber.length() + 1 == previousNumber.length() && previousNumber.startsWith(m_CardNumber)) {
+        isUpdated = removeCardNumberCharacter(previousNumber.at(previousNumber.length() - 1));
+    }
+
+    if (isUpdated == false) {
+        resetCardNumberState();
+    }
+}
+
+void Card::appendCardNumberCharacter(QChar character)
+{
+    if (character.isDigit() == false) {
+        m_CardNumberNonDigitCount++;
+        // possibleCardBrand() skips the spaces and dashes, but stops at the other characters.
+        if (character != ' ' && character != '-') {
+            m_IsBrandPrefixClosed = true;
+        }
+
+        return;
+    }
+
+    // m_LuhnSum is the sum If the appended digit is the last one, and m_ShiftedLuhnSum is the sum If another digit is appended after it.
+    const int digit = character.digitValue();
+    const int luhnSum = m_LuhnSum;
+    m_LuhnSum = m_ShiftedLuhnSum + digit;
+    m_ShiftedLuhnSum = luhnSum + doubledLuhnDigit(digit);
+
+    if (m_IsBrandPrefixClosed == false && m_BrandPrefixDigitCount < IIN_MAX_DIGITS) {
+        m_BrandPrefix = m_BrandPrefix * 10 + digit;
+        m_BrandPrefixDigitCount++;
+    }
+
+    // The brand is known from the 4th digit on, before the groups of the brands differ.
+    const CardBrand cardBrand = cardBrandForPrefix(m_BrandPrefix, m_BrandPrefixDigitCount);
+    if (m_CardNumberDigitCount < 32 && (BRAND_INFOS[cardBrand].groupEnds & (1u << m_CardNumberDigitCount)) != 0) {
+        m_FormattedCardNumber.append(' ');
+    }
+
+    m_FormattedCardNumber.append(character);
+    m_CardNumberDigitCount++;
+}
+
+bool Card::removeCardNumberCharacter(QChar character)
+{
+    if (character.isDigit() == false) {
+        m_CardNumberNonDigitCount--;
+        // If the character was ending the brand prefix, the digits after it have to be read again.
+        return character == ' ' || character == '-';
+    }
+
+    const int digit = character.digitValue();
+    const int shiftedLuhnSum = m_ShiftedLuhnSum;
+    m_ShiftedLuhnSum = m_LuhnSum - digit;
+    m_LuhnSum = shiftedLuhnSum - doubledLuhnDigit(digit);
+
+    // The digit is a part of the brand prefix only If all of the digits before it are.
+    if (m_BrandPrefixDigitCount == m_CardNumberDigitCount) {
+        m_BrandPrefix /= 10;
+        m_BrandPrefixDigitCount--;
+    }
+
+    m_CardNumberDigitCount--;
+    m_FormattedCardNumber.chop(1);
+    if (m_FormattedCardNumber.endsWith(' ')) {
+        m_FormattedCardNumber.chop(1);
+    }
+
+    return true;
+}
+
+void Card::resetCardNumberState()
+{
+    m_LuhnSum = 0;
+    m_ShiftedLuhnSum = 0;
+    m_CardNumberDigitCount = 0;
+    m_CardNumberNonDigitCount = 0;
+    m_BrandPrefix = 0;
+    m_BrandPrefixDigitCount = 0;
+    m_IsBrandPrefixClosed = false;
+    m_FormattedCardNumber.clear();
+
+    for (const QChar &character : m_CardNumber) {
+        appendCardNumberCharacter(character);
+    }
+}
+
+int Card::doubledLuhnDigit(int digit)
+{
+    return digit > 4 ? digit * 2 - 9 : digit * 2;
+}
+
 }
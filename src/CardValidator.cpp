@@ -0,0 +1,129 @@
+#include "QStripe/CardValidator.h"
+// Qt
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace QStripe
+{
+
+// The number of rows that are validated in a single task.
+static const int CHUNK_SIZE = 4096;
+// Card::cardBrandForPrefix() uses at most this many digits.
+static const int BRAND_PREFIX_DIGITS = 6;
+
+CardValidator::Row::Row()
+    : number()
+    , expirationMonth(0)
+    , expirationYear(0)
+{
+
+}
+
+CardValidator::Row::Row(const QByteArray &_number, int _expirationMonth, int _expirationYear)
+    : number(_number)
+    , expirationMonth(_expirationMonth)
+    , expirationYear(_expirationYear)
+{
+
+}
+
+bool CardValidator::validLuhn(const char *digits, int length)
+{
+    if (length <= 0) {
+        return false;
+    }
+
+    // The loop has no branches so that the compiler can vectorize it. Every second digit from the right is doubled, and If the result is larger than 9,
+    // 9 is subtracted from it.
+    const int parity = length & 1;
+    int sum = 0;
+    int invalid = 0;
+    for (int index = 0; index < length; index++) {
+        const int digit = static_cast<unsigned char>(digits[index]) - '0';
+        invalid |= static_cast<unsigned>(digit) > 9;
+
+        const int isDoubled = (index & 1) == parity;
+        sum += digit + isDoubled * (digit - 9 * (digit > 4));
+    }
+
+    return invalid == 0 && sum % 10 == 0;
+}
+
+bool CardValidator::validCardNumber(const QByteArray &number)
+{
+    const int length = number.size();
+    const int digitCount = qMin(length, BRAND_PREFIX_DIGITS);
+    int prefix = 0;
+    for (int index = 0; index < digitCount; index++) {
+        prefix = prefix * 10 + (number.at(index) - '0');
+    }
+
+    // The non-digit characters are rejected by the Luhn check.
+    const Card::CardBrand brand = Card::cardBrandForPrefix(prefix, digitCount);
+    return Card::validCardNumberLength(brand, length) && validLuhn(number.constData(), length);
+}
+
+bool CardValidator::validRow(const Row &row, const QDate &today)
+{
+    if (row.expirationMonth < 1 || row.expirationMonth > 12) {
+        return false;
+    }
+
+    // Same as Card::normilizedYear(). The missing digits are taken from the current year, e.g 25 is 2025.
+    int year = row.expirationYear;
+    if (year < 100 && year >= 0) {
+        const int base = year < 10 ? 10 : 100;
+        year = today.year() / base * base + year;
+    }
+
+    bool isValid = year >= today.year();
+    if (isValid && year == today.year()) {
+        isValid = row.expirationMonth >= today.month();
+    }
+
+    return isValid && validCardNumber(row.number);
+}
+
+QBitArray CardValidator::validate(const QVector<Row> &rows)
+{
+    const QDate today = QDate::currentDate();
+    return validateInParallel(rows.size(), [&rows, &today](int index) {
+        return validRow(rows.at(index), today);
+    });
+}
+
+QBitArray CardValidator::validateCardNumbers(const QVector<QByteArray> &numbers)
+{
+    return validateInParallel(numbers.size(), [&numbers](int index) {
+        return validCardNumber(numbers.at(index));
+    });
+}
+
+template<typename Check>
+QBitArray CardValidator::validateInParallel(int count, Check check)
+{
+    QVector<int> chunks;
+    for (int start = 0; start < count; start += CHUNK_SIZE) {
+        chunks.append(start);
+    }
+
+    // The bits of a QBitArray cannot be set from multiple threads, so each of the tasks writes to its own bytes first.
+    QVector<char> results(count, 0);
+    char *resultData = results.data();
+    QtConcurrent::blockingMap(chunks, [resultData, count, &check](const int &start) {
+        const int end = qMin(start + CHUNK_SIZE, count);
+        for (int index = start; index < end; index++) {
+            resultData[index] = check(index) ? 1 : 0;
+        }
+    });
+
+    QBitArray bits(count);
+    for (int index = 0; index < count; index++) {
+        if (resultData[index]) {
+            bits.setBit(index);
+        }
+    }
+
+    return bits;
+}
+
+}
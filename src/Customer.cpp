@@ -2,6 +2,8 @@
 // Qt
 #include <QUrlQuery>
 // QStripe
+#include "QStripe/ModelData.h"
+#include "QStripe/ObjectCache.h"
 #include "QStripe/Stripe.h"
 #include "QStripe/Utils.h"
 
@@ -32,10 +34,36 @@ Customer::Customer(QObject *parent)
     , m_Metadata()
     , m_ShippingInformation()
     , m_IsDeleted(false)
-    , m_NetworkUtils()
+    , m_NetworkUtils(this)
     , m_Error()
     , m_Cards()
-{
+    , m_UpdateDepth(0)
+    , m_PendingSignals()
+    , m_DirtyFields(DirtyNone)
+    , m_SyncedMetadata()
+    , m_SyncedShipping(m_ShippingInformation.json())
+    , m_AutoSaveTimer()
+    , m_IsAutoSave(false)
+    , m_IsUpdateInFlight(false)
+    , m_IsUpdateQueued(false)
+{
+    m_AutoSaveTimer.setSingleShot(true);
+    m_AutoSaveTimer.setInterval(500);
+    connect(&m_AutoSaveTimer, &QTimer::timeout, this, &Customer::autoSaveTimeout);
+
+    // The shipping information can also be changed through shippingInformation().
+    connect(&m_ShippingInformation, &ShippingInformation::nameChanged, this, &Customer::scheduleAutoSave);
+    connect(&m_ShippingInformation, &ShippingInformation::phoneChanged, this, &Customer::scheduleAutoSave);
+    connect(&m_ShippingInformation, &ShippingInformation::addressChanged, this, &Customer::scheduleAutoSave);
+    // ShippingInformation::addressChanged() is only emitted when the address is replaced, not when one of its fields is edited.
+    const Address *address = m_ShippingInformation.address();
+    connect(address, &Address::countryChanged, this, &Customer::scheduleAutoSave);
+    connect(address, &Address::stateChanged, this, &Customer::scheduleAutoSave);
+    connect(address, &Address::cityChanged, this, &Customer::scheduleAutoSave);
+    connect(address, &Address::lineOneChanged, this, &Customer::scheduleAutoSave);
+    connect(address, &Address::lineTwoChanged, this, &Customer::scheduleAutoSave);
+    connect(address, &Address::postalCodeChanged, this, &Customer::scheduleAutoSave);
+    connect(address, &Address::zipCheckChanged, this, &Customer::scheduleAutoSave);
 }
 
 QString Customer::customerID() const
@@ -53,7 +81,8 @@ void Customer::setDefaultSource(const QString &source)
     const bool changed = m_DefaultSource != source;
     if (changed) {
         m_DefaultSource = source;
-        emit defaultSourceChanged();
+        markDirty(DirtyDefaultSource);
+        notify(&Customer::defaultSourceChanged);
     }
 }
 
@@ -67,7 +96,8 @@ void Customer::setEmail(const QString &email)
     const bool changed = m_Email != email;
     if (changed) {
         m_Email = email;
-        emit emailChanged();
+        markDirty(DirtyEmail);
+        notify(&Customer::emailChanged);
     }
 }
 
@@ -81,7 +111,8 @@ void Customer::setDescription(const QString &description)
     const bool changed = m_Description != description;
     if (changed) {
         m_Description = description;
-        emit descriptionChanged();
+        markDirty(DirtyDescription);
+        notify(&Customer::descriptionChanged);
     }
 }
 
@@ -95,7 +126,7 @@ void Customer::setCurrency(const QString &currency)
     const bool changed = m_Currency != currency;
     if (changed) {
         m_Currency = currency;
-        emit currencyChanged();
+        notify(&Customer::currencyChanged);
     }
 }
 
@@ -109,7 +140,8 @@ void Customer::setMetadata(const QVariantMap &metadata)
     const bool changed = m_Metadata != metadata;
     if (changed) {
         m_Metadata = metadata;
-        emit metadataChanged();
+        markDirty(DirtyMetadata);
+        notify(&Customer::metadataChanged);
     }
 }
 
@@ -128,6 +160,41 @@ bool Customer::deleted() const
     return m_IsDeleted;
 }
 
+bool Customer::autoSave() const
+{
+    return m_IsAutoSave;
+}
+
+void Customer::setAutoSave(bool enabled)
+{
+    const bool changed = m_IsAutoSave != enabled;
+    if (changed) {
+        m_IsAutoSave = enabled;
+        if (m_IsAutoSave) {
+            scheduleAutoSave();
+        }
+        else {
+            m_AutoSaveTimer.stop();
+        }
+
+        emit autoSaveChanged();
+    }
+}
+
+int Customer::autoSaveInterval() const
+{
+    return m_AutoSaveTimer.interval();
+}
+
+void Customer::setAutoSaveInterval(int interval)
+{
+    const bool changed = m_AutoSaveTimer.interval() != interval;
+    if (changed) {
+        m_AutoSaveTimer.setInterval(interval);
+        emit autoSaveIntervalChanged();
+    }
+}
+
 void Customer::setShippingInformation(ShippingInformation *shippingInformation)
 {
     // TODO: Check for content equality instead of memory location.
@@ -136,57 +203,14 @@ void Customer::setShippingInformation(ShippingInformation *shippingInformation)
                          (*m_ShippingInformation.address()) != (*shippingInformation->address());
     if (changed) {
         m_ShippingInformation.set(shippingInformation);
-        emit shippingInformationChanged();
+        notify(&Customer::shippingInformationChanged);
     }
 }
 
 QVariantMap Customer::json(bool omitEmpty) const
 {
-    QVariantMap data;
-
-    if (customerID().length() > 0) {
-        data[FIELD_ID] = customerID();
-    }
-
-    if ((omitEmpty && m_Currency.length() > 0) || omitEmpty == false) {
-        data[FIELD_CURRENCY] = m_Currency;
-    }
-
-    if ((omitEmpty && m_DefaultSource.length() > 0) || omitEmpty == false) {
-        data[FIELD_DEFAULT_SOURCE] = m_DefaultSource;
-    }
-
-    if ((omitEmpty && m_ShippingInformation.phone().length() > 0 && m_ShippingInformation.name().length() > 0) || omitEmpty == false) {
-        data[FIELD_SHIPPING] = m_ShippingInformation.json();
-    }
-
-    if ((omitEmpty && m_Email.length() > 0) || omitEmpty == false) {
-        data[FIELD_EMAIL] = m_Email;
-    }
-
-    if ((omitEmpty && m_Description.length() > 0) || omitEmpty == false) {
-        data[FIELD_DESCRIPTION] = m_Description;
-    }
-
-    for (auto it = m_Metadata.constBegin(); it != m_Metadata.constEnd(); it++) {
-        const QString key = FIELD_METADATA + "[" + it.key() + "]";
-        const QVariant &value = it.value();
-
-        if (value.type() == QVariant::String) {
-            data[key] = value.toString();
-        }
-        else if (value.type() == QVariant::Int) {
-            data[key] = value.toInt();
-        }
-        else if (value.type() == QVariant::Int) {
-            data[key] = value.toInt();
-        }
-        else if (value.type() == QVariant::Map) {
-            qWarning() << "Do not put Map in metadata.";
-        }
-    }
-
-    return data;
+    // The metadata is written as `metadata[key]`.
+    return CustomerData::schema().formData(data(), omitEmpty);
 }
 
 QString Customer::jsonString(bool omitEmpty) const
@@ -232,9 +256,71 @@ Customer *Customer::fromJson(const QVariantMap &data)
         customer->setDeleted(data[FIELD_DELETED].toBool());
     }
 
+    customer->markSynced();
     return customer;
 }
 
+Customer *Customer::fromJson(const QJsonObject &object)
+{
+    return fromData(CustomerData::fromJson(object));
+}
+
+Customer *Customer::fromData(const CustomerData &data)
+{
+    Customer *customer = new Customer();
+    customer->applyData(data);
+    customer->markSynced();
+
+    return customer;
+}
+
+CustomerData Customer::data() const
+{
+    CustomerData data;
+    data.customerID = m_CustomerID;
+    data.defaultSource = m_DefaultSource;
+    data.email = m_Email;
+
+    data.description = m_Description;
+    data.currency = m_Currency;
+    data.metadata = m_Metadata;
+
+    data.shipping = m_ShippingInformation.data();
+    data.deleted = m_IsDeleted;
+
+    return data;
+}
+
+void Customer::applyData(const CustomerData &data)
+{
+    setCustomerID(data.customerID);
+    setDefaultSource(data.defaultSource);
+    setEmail(data.email);
+
+    setDescription(data.description);
+    setCurrency(data.currency);
+    setMetadata(data.metadata);
+
+    if (data.shipping != m_ShippingInformation.data()) {
+        m_ShippingInformation.setData(data.shipping);
+        notify(&Customer::shippingInformationChanged);
+    }
+
+    setDeleted(data.deleted);
+}
+
+void Customer::applyJson(const QJsonObject &object)
+{
+    // The fields that are not in object keep their current value. The shipping information is replaced as a whole, a null value removes it.
+    CustomerData customer = data();
+    CustomerData::schema().read(customer, object);
+
+    beginUpdate();
+    applyData(customer);
+    markSynced();
+    endUpdate();
+}
+
 Customer *Customer::fromString(const QString &dataStr)
 {
     return fromJson(Utils::toVariantMap(dataStr));
@@ -243,6 +329,7 @@ Customer *Customer::fromString(const QString &dataStr)
 void Customer::set(Customer *other)
 {
     if (other) {
+        beginUpdate();
         setCustomerID(other->customerID());
         setDefaultSource(other->defaultSource());
         setEmail(other->email());
@@ -252,10 +339,11 @@ void Customer::set(Customer *other)
         setMetadata(other->metadata());
 
         setShippingInformation(other->shippingInformation());
+        endUpdate();
     }
 }
 
-bool Customer::create()
+bool Customer::create(const QString &idempotencyKey)
 {
     if (Stripe::secretKey().length() == 0) {
         qDebug() << "[ERROR] secretKey is not set in the Stripe instance. Cannot send the request.";
@@ -268,11 +356,9 @@ bool Customer::create()
     }
 
     auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+        const QJsonObject data = Utils::toJsonObject(response.body);
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
-            Customer *customer = fromJson(data);
-            set(customer);
-            customer->deleteLater();
+            applyJson(data);
             emit created();
         }
         else {
@@ -287,18 +373,11 @@ bool Customer::create()
         m_NetworkUtils.setHeader("Stripe-Version", Stripe::apiVersion());
     }
 
-    QVariantMap data = json();
-    // currency and default_source should be removed.
-    data.remove(FIELD_CURRENCY);
-    if (m_DefaultSource.length() == 0) {
-        data.remove(FIELD_DEFAULT_SOURCE);
-    }
-
-    m_NetworkUtils.sendPost(getURL(), data, callback);
+    m_NetworkUtils.sendPost(getURL(), requestData(), callback, idempotencyKey);
     return true;
 }
 
-bool Customer::update()
+bool Customer::update(const QString &idempotencyKey)
 {
     if (Stripe::secretKey().length() == 0) {
         qDebug() << "[ERROR] secretKey is not set in the Stripe instance. Cannot send the request.";
@@ -309,18 +388,61 @@ bool Customer::update()
         return false;
     }
 
-    auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+    if (m_IsUpdateInFlight) {
+        // The changes are sent when the current update finishes, so the updates cannot complete out of order.
+        m_IsUpdateQueued = true;
+        return true;
+    }
+
+    const QVariantMap data = updateData();
+    if (data.isEmpty()) {
+        qDebug() << "[INFO] None of the customer fields have changed. Skipping the update.";
+        return false;
+    }
+
+    // The fields are marked as synced when they are sent, so that only the changes that are made during the flight are sent with the next update. If the
+    // update fails, the sent fields are marked again.
+    const int sentFields = m_DirtyFields;
+    const QVariantMap previousMetadata = m_SyncedMetadata;
+    const QVariantMap previousShipping = m_SyncedShipping;
+    markSynced();
+    m_AutoSaveTimer.stop();
+    m_IsUpdateInFlight = true;
+
+    auto callback = [this, sentFields, previousMetadata, previousShipping](const Response & response) {
+        m_IsUpdateInFlight = false;
+        const QJsonObject data = Utils::toJsonObject(response.body);
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
-            Customer *customer = fromJson(data);
-            set(customer);
-            customer->deleteLater();
+            // Refresh the cached customer so that the next fetch does not return the old values.
+            ObjectCache::insert(ObjectCache::customerKey(m_CustomerID), data, response.body.size());
+            // The changes that are made during the flight would be overwritten by the response. They are applied with the response of the next update.
+            if (isDirty() == false) {
+                applyJson(data);
+            }
+
             emit updated();
         }
         else {
+            m_DirtyFields |= sentFields;
+            m_SyncedMetadata = previousMetadata;
+            m_SyncedShipping = previousShipping;
+
             qDebug() << "[ERROR] Error occurred while updating the customer.";
             m_Error.set(data, response.httpStatus, response.networkError);
             emit errorOccurred(&m_Error);
+
+            // The restored changes are saved again after the interval. A request that Stripe rejected would fail the same way, so it waits for the next edit.
+            const bool rejected = response.httpStatus >= 400 && response.httpStatus < 500 &&
+                                  response.httpStatus != NetworkUtils::HttpStatusCodes::HTTP_409 &&
+                                  response.httpStatus != NetworkUtils::HttpStatusCodes::HTTP_429;
+            if (rejected == false) {
+                scheduleAutoSave();
+            }
+        }
+
+        if (m_IsUpdateQueued) {
+            m_IsUpdateQueued = false;
+            update();
         }
     };
 
@@ -329,18 +451,15 @@ bool Customer::update()
         m_NetworkUtils.setHeader("Stripe-Version", Stripe::apiVersion());
     }
 
-    QVariantMap data = json();
-    // currency and default_source should be removed.
-    data.remove(FIELD_CURRENCY);
-    data.remove(FIELD_ID);
-    if (m_DefaultSource.length() == 0) {
-        data.remove(FIELD_DEFAULT_SOURCE);
-    }
-
-    m_NetworkUtils.sendPost(getURL(m_CustomerID), data, callback);
+    m_NetworkUtils.sendPost(getURL(m_CustomerID), data, callback, idempotencyKey);
     return true;
 }
 
+bool Customer::isDirty() const
+{
+    return updateData().size() > 0;
+}
+
 bool Customer::deleteCustomer()
 {
     if (Stripe::secretKey().length() == 0) {
@@ -353,8 +472,10 @@ bool Customer::deleteCustomer()
     }
 
     auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+        const QJsonObject data = Utils::toJsonObject(response.body);
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
+            // The cards of the customer are deleted with it.
+            ObjectCache::removeWithChildren(ObjectCache::customerKey(m_CustomerID));
             m_CustomerID = "";
             emit customerDeleted();
         }
@@ -376,28 +497,57 @@ bool Customer::deleteCustomer()
 
 void Customer::clear()
 {
-    m_CustomerID.clear();
-    emit customerIDChanged();
+    beginUpdate();
+    setCustomerID("");
+    setDefaultSource("");
+    setEmail("");
 
-    m_DefaultSource.clear();
-    emit defaultSourceChanged();
+    setDescription("");
+    setCurrency("");
+    setMetadata(QVariantMap());
 
-    m_Email.clear();
-    emit emailChanged();
+    if (m_ShippingInformation.data() != ShippingInformationData()) {
+        m_ShippingInformation.clear();
+        notify(&Customer::shippingInformationChanged);
+    }
 
-    m_Description.clear();
-    emit descriptionChanged();
+    markSynced();
+    endUpdate();
+    emit cleared();
+}
 
-    m_Currency.clear();
-    emit currencyChanged();
+void Customer::beginUpdate()
+{
+    m_UpdateDepth++;
+}
 
-    m_Metadata.clear();
-    emit metadataChanged();
+void Customer::endUpdate()
+{
+    if (m_UpdateDepth == 0) {
+        qDebug() << "[WARNING] endUpdate() is called without a matching beginUpdate().";
+        return;
+    }
 
-    m_ShippingInformation.clear();
-    emit shippingInformationChanged();
+    m_UpdateDepth--;
+    if (m_UpdateDepth == 0) {
+        const QVector<ChangedSignal> pendingSignals = m_PendingSignals;
+        m_PendingSignals.clear();
+        for (ChangedSignal changedSignal : pendingSignals) {
+            (this->*changedSignal)();
+        }
+    }
+}
 
-    emit cleared();
+void Customer::notify(ChangedSignal changedSignal)
+{
+    if (m_UpdateDepth > 0) {
+        if (m_PendingSignals.contains(changedSignal) == false) {
+            m_PendingSignals.append(changedSignal);
+        }
+    }
+    else {
+        (this->*changedSignal)();
+    }
 }
 
 QQmlListProperty<Card> Customer::cards()
@@ -432,7 +582,7 @@ Error *Customer::lastError()
 
 QString Customer::getURL(const QString &customerID)
 {
-    return "https://api.stripe.com/v1/customers" + (customerID.length() > 0 ? "/" + customerID : "");
+    return Stripe::apiBaseUrl() + "/customers" + (customerID.length() > 0 ? "/" + customerID : "");
 }
 
 void Customer::setCustomerID(const QString &id)
@@ -440,7 +590,7 @@ void Customer::setCustomerID(const QString &id)
     const bool changed = m_CustomerID != id;
     if (changed) {
         m_CustomerID = id;
-        emit customerIDChanged();
+        notify(&Customer::customerIDChanged);
     }
 }
 
@@ -469,4 +619,90 @@ void Customer::clearCards(QQmlListProperty<Card> *list)
     reinterpret_cast<Customer *>(list->data)->clearCards();
 }
 
+QVariantMap Customer::requestData() const
+{
+    QVariantMap data = json();
+    // currency and default_source should be removed.
+    data.remove(FIELD_CURRENCY);
+    if (m_DefaultSource.length() == 0) {
+        data.remove(FIELD_DEFAULT_SOURCE);
+    }
+
+    data[FIELD_SHIPPING] = shippingRequestData();
+    return data;
+}
+
+QVariant Customer::shippingRequestData() const
+{
+    // The shipping information is sent as nested fields. Stripe requires a name for it, so an empty value is sent to clear it instead.
+    if (m_ShippingInformation.name().length() == 0) {
+        return QString("");
+    }
+
+    QVariantMap shipping = m_ShippingInformation.json();
+    QVariantMap address = shipping[ShippingInformation::FIELD_ADDRESS].toMap();
+    address.remove(Address::FIELD_ZIP_CHECK);
+    shipping[ShippingInformation::FIELD_ADDRESS] = address;
+    return shipping;
+}
+
+QVariantMap Customer::updateData() const
+{
+    QVariantMap data;
+    // An empty default source cannot be sent, see requestData().
+    if ((m_DirtyFields & DirtyDefaultSource) && m_DefaultSource.length() > 0) {
+        data[FIELD_DEFAULT_SOURCE] = m_DefaultSource;
+    }
+
+    if (m_DirtyFields & DirtyEmail) {
+        data[FIELD_EMAIL] = m_Email;
+    }
+
+    if (m_DirtyFields & DirtyDescription) {
+        data[FIELD_DESCRIPTION] = m_Description;
+    }
+
+    if (m_DirtyFields & DirtyMetadata) {
+        const QVariantMap metadata = Utils::changedEntries(m_Metadata, m_SyncedMetadata);
+        if (metadata.size() > 0) {
+            data[FIELD_METADATA] = metadata;
+        }
+    }
+
+    if (m_ShippingInformation.json() != m_SyncedShipping) {
+        data[FIELD_SHIPPING] = shippingRequestData();
+    }
+
+    return data;
+}
+
+void Customer::markDirty(DirtyField field)
+{
+    m_DirtyFields |= field;
+    scheduleAutoSave();
+}
+
+void Customer::markSynced()
+{
+    m_DirtyFields = DirtyNone;
+    m_SyncedMetadata = m_Metadata;
+    m_SyncedShipping = m_ShippingInformation.json();
+}
+
+void Customer::scheduleAutoSave()
+{
+    if (m_IsAutoSave) {
+        // Restarting the timer merges the changes that are made in quick succession.
+        m_AutoSaveTimer.start();
+    }
+}
+
+void Customer::autoSaveTimeout()
+{
+    // The timer is also started while a response is applied, so there may not be any changes left.
+    if (m_CustomerID.length() > 0 && isDirty()) {
+        update();
+    }
+}
+
 }
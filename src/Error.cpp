@@ -1,13 +1,462 @@
 #include "QStripe/Error.h"
 // QStripe
+#include "QStripe/EnumTable.h"
 #include "QStripe/NetworkUtils.h"
 // Qt
-#include <QDebug>
+#include <QCoreApplication>
 #include <QNetworkReply>
+#include <QMutexLocker>
+#include <QLocale>
+#include <QDebug>
+#include <QHash>
 
 namespace QStripe
 {
 
+static constexpr EnumName<Error::ErrorType> ERROR_TYPES[] = {
+    {Error::ErrorApiConnection, "api_connection_error"},
+    {Error::ErrorApi, "api_error"},
+    {Error::ErrorAuthentication, "authentication_error"},
+    {Error::ErrorCard, "card_error"},
+    {Error::ErrorIdempotency, "idempotency_error"},
+    {Error::ErrorInvalidRequest, "invalid_request_error"},
+    {Error::ErrorRateLimit, "rate_limit_error"}
+};
+
+static constexpr EnumName<Error::ErrorCode> ERROR_CODES[] = {
+    {Error::CodeInvalidNumber, "invalid_number"},
+    {Error::CodeInvalidExpiryMonth, "invalid_expiry_month"},
+    {Error::CodeInvalidExpiryYear, "invalid_expiry_year"},
+    {Error::CodeInvalidCVC, "invalid_cvc"},
+    {Error::CodeInvalidSwipeData, "invalid_swipe_data"},
+    {Error::CodeIncorrectNumber, "incorrect_number"},
+    {Error::CodeExpiredCard, "expired_card"},
+    {Error::CodeIncorrectCVC, "incorrect_cvc"},
+    {Error::CodeIncorrectZip, "incorrect_zip"},
+    {Error::CodeCardDeclined, "card_declined"},
+    {Error::CodeMissing, "missing"},
+    {Error::CodeProcessingError, "processing_error"}
+};
+
+struct DeclineCodeInfo {
+    const char *code;
+    // The customer facing texts.
+    const char *description;
+    const char *nextSteps;
+    // The actual texts for the sensitive decline codes. If they are nullptr, the customer facing texts are used.
+    const char *sensitiveDescription;
+    const char *sensitiveNextSteps;
+    bool isSensitive;
+    // True If the same payment can be attempted again without any changes from the customer.
+    bool isRetryable;
+};
+
+// The decline codes from here: https://stripe.com/docs/declines/codes
+static const DeclineCodeInfo DECLINE_CODES[] = {
+    {
+        "approve_with_id",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment cannot be authorized."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment should be attempted again. If it still cannot be processed, the customer needs to contact their card issuer."),
+        nullptr,
+        nullptr,
+        false, true
+    },
+    {
+        "call_issuer",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "card_not_supported",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card does not support this type of purchase."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer to make sure their card can be used to make this type of purchase."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "card_velocity_exceeded",
+        QT_TRANSLATE_NOOP("QStripe::Error", "You have exceeded the balance or credit limit available on your card."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "currency_not_supported",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card does not support the specified currency."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs check with the issuer that the card can be used for the type of currency specified."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "do_not_honor",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "do_not_try_again",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "duplicate_transaction",
+        QT_TRANSLATE_NOOP("QStripe::Error", "A transaction with identical amount and credit card information was submitted very recently."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "Check to see if a recent payment already exists."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "expired_card",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has expired."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should use another card."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "fraudulent",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment has been declined as Stripe suspects it is fraudulent."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "generic_decline",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "incorrect_number",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card number is incorrect."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should try again using the correct card number."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "incorrect_cvc",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The CVC number is incorrect."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should try again using the correct CVC."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "incorrect_pin",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The PIN entered is incorrect."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should try again using the correct PIN."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "incorrect_zip",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The ZIP/postal code is incorrect."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should try again using the correct billing ZIP/postal code."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "insufficient_funds",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has insufficient funds to complete the purchase."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should use an alternative payment method."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "invalid_account",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card, or account the card is connected to, is invalid."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer to check that the card is working correctly."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "invalid_amount",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment amount is invalid, or exceeds the amount that is allowed."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "If the amount appears to be correct, the customer needs to check with their card issuer that they can make purchases of that amount."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "invalid_cvc",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The CVC number is incorrect."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should try again using the correct CVC."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "invalid_expiry_year",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The expiration year invalid."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should try again using the correct expiration date."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "invalid_number",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card number is incorrect."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should try again using the correct card number."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "invalid_pin",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The PIN entered is incorrect."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should try again using the correct PIN."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "issuer_not_available",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card issuer could not be reached, so the payment could not be authorized."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment should be attempted again. If it still cannot be processed, the customer needs to contact their card issuer."),
+        nullptr,
+        nullptr,
+        false, true
+    },
+    {
+        "lost_card",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment has been declined because the card is reported lost."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The specific reason for the decline should not be reported to the customer. Instead, it needs to be presented as a generic decline."),
+        true, false
+    },
+    {
+        "new_account_information_available",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card, or account the card is connected to, is invalid."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "no_action_taken",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "not_permitted",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment is not permitted."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "pickup_card",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card cannot be used to make this payment."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card cannot be used to make this payment (it is possible it has been reported lost or stolen)."),
+        nullptr,
+        true, false
+    },
+    {
+        "pin_try_exceeded",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The allowable number of PIN tries has been exceeded."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer must use another card or method of payment."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "processing_error",
+        QT_TRANSLATE_NOOP("QStripe::Error", "An error occurred while processing the card."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment should be attempted again. If it still cannot be processed, try again later."),
+        nullptr,
+        nullptr,
+        false, true
+    },
+    {
+        "reenter_transaction",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment could not be processed by the issuer for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment should be attempted again. If it still cannot be processed, the customer needs to contact their card issuer."),
+        nullptr,
+        nullptr,
+        false, true
+    },
+    {
+        "restricted_card",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card cannot be used to make this payment"),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card cannot be used to make this payment (it is possible it has been reported lost or stolen)."),
+        nullptr,
+        true, false
+    },
+    {
+        "revocation_of_all_authorizations",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "revocation_of_authorization",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "security_violation",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "service_not_allowed",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "stolen_card",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment has been declined."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The payment has been declined because the card is reported stolen."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The specific reason for the decline should not be reported to the customer. Instead, it needs to be presented as a generic decline."),
+        true, false
+    },
+    {
+        "stop_payment_order",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "testmode_decline",
+        QT_TRANSLATE_NOOP("QStripe::Error", "A Stripe test card number was used."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "A genuine card must be used to make a payment."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "transaction_not_allowed",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer needs to contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, false
+    },
+    {
+        "try_again_later",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The card has been declined for an unknown reason."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "Ask the customer to attempt the payment again. If subsequent payments are declined, the customer should contact their card issuer for more information."),
+        nullptr,
+        nullptr,
+        false, true
+    },
+    {
+        "withdrawal_count_limit_exceeded",
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer has exceeded the balance or credit limit available on their card."),
+        QT_TRANSLATE_NOOP("QStripe::Error", "The customer should use an alternative payment method."),
+        nullptr,
+        nullptr,
+        false, false
+    }
+};
+
+static const int DECLINE_CODE_COUNT = sizeof(DECLINE_CODES) / sizeof(DECLINE_CODES[0]);
+
+struct DeclineCodeTexts {
+    QString description,
+            nextSteps,
+            sensitiveDescription,
+            sensitiveNextSteps;
+};
+
+static QMutex s_DeclineCodeTranslationsMutex;
+// The translated texts of each decline code, keyed by the locale name.
+static QHash<QString, QVector<DeclineCodeTexts>> s_DeclineCodeTranslations;
+
+/**
+ * @brief Returns the index of declineCode in DECLINE_CODES. If declineCode is unknown, returns -1.
+ * @param declineCode
+ * @return int
+ */
+static int declineCodeIndex(const QString &declineCode)
+{
+    static const QHash<QString, int> indexes = []() {
+        QHash<QString, int> codes;
+        codes.reserve(DECLINE_CODE_COUNT);
+        for (int index = 0; index < DECLINE_CODE_COUNT; index++) {
+            codes.insert(QString::fromLatin1(DECLINE_CODES[index].code), index);
+        }
+
+        return codes;
+    }();
+
+    return indexes.value(declineCode, -1);
+}
+
+/**
+ * @brief Returns the translated texts of the decline code at index. All of the decline codes are translated the first time a locale is used.
+ * @param index
+ * @return DeclineCodeTexts
+ */
+static DeclineCodeTexts translatedDeclineCode(int index)
+{
+    QMutexLocker locker(&s_DeclineCodeTranslationsMutex);
+    const QString localeName = QLocale().name();
+    auto it = s_DeclineCodeTranslations.find(localeName);
+    if (it == s_DeclineCodeTranslations.end()) {
+        auto translate = [](const char *text) {
+            return text ? QCoreApplication::translate("QStripe::Error", text) : QString("");
+        };
+
+        QVector<DeclineCodeTexts> translations;
+        translations.reserve(DECLINE_CODE_COUNT);
+        for (const DeclineCodeInfo &info : DECLINE_CODES) {
+            DeclineCodeTexts texts;
+            texts.description = translate(info.description);
+            texts.nextSteps = translate(info.nextSteps);
+            texts.sensitiveDescription = translate(info.sensitiveDescription);
+            texts.sensitiveNextSteps = translate(info.sensitiveNextSteps);
+            translations.append(texts);
+        }
+
+        it = s_DeclineCodeTranslations.insert(localeName, translations);
+    }
+
+    return it.value().at(index);
+}
+
+
 Error::Error(QObject *parent)
     : QObject(parent)
     , m_ChargeID("")
@@ -70,152 +519,16 @@ QString Error::declineCodeDescription(QString declineCode, bool omitSensitive) c
     }
 
     QString description = "";
-    if (declineCode == declineCodeApproveWithId()) {
-        description = tr("The payment cannot be authorized.");
-    }
-    else if (declineCode == declineCodeCallIssuer()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeCardNotSupported()) {
-        description = tr("The card does not support this type of purchase.");
-    }
-    else if (declineCode == declineCodeCardVelocityExceeded()) {
-        description = tr("You have exceeded the balance or credit limit available on your card.");
-    }
-    else if (declineCode == declineCodeCurrencyNotSupported()) {
-        description = tr("The card does not support the specified currency.");
-    }
-    else if (declineCode == declineCodeDoNotHonor()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeDoNotTryAgain()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeDuplicateTransaction()) {
-        description = tr("A transaction with identical amount and credit card information was submitted very recently.");
-    }
-    else if (declineCode == declineCodeExpiredCard()) {
-        description = tr("The card has expired.");
-    }
-    else if (declineCode == declineCodeFraudulent()) {
-        description = tr("The payment has been declined as Stripe suspects it is fraudulent.");
-    }
-    else if (declineCode == declineCodeGenericDecline()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeIncorrectNumber()) {
-        description = tr("The card number is incorrect.");
-    }
-    else if (declineCode == declineCodeIncorrectCvc()) {
-        description = tr("The CVC number is incorrect.");
-    }
-    else if (declineCode == declineCodeIncorrectPin()) {
-        description = tr("The PIN entered is incorrect.");
-    }
-    else if (declineCode == declineCodeIncorrectZip()) {
-        description = tr("The ZIP/postal code is incorrect.");
-    }
-    else if (declineCode == declineCodeInsufficientFunds()) {
-        description = tr("The card has insufficient funds to complete the purchase.");
-    }
-    else if (declineCode == declineCodeInvalidAccount()) {
-        description = tr("The card, or account the card is connected to, is invalid.");
-    }
-    else if (declineCode == declineCodeInvalidAmount()) {
-        description = tr("The payment amount is invalid, or exceeds the amount that is allowed.");
-    }
-    else if (declineCode == declineCodeInvalidCvc()) {
-        description = tr("The CVC number is incorrect.");
-    }
-    else if (declineCode == declineCodeInvalidExpiryYear()) {
-        description = tr("The expiration year invalid.");
-    }
-    else if (declineCode == declineCodeInvalidNumber()) {
-        description = tr("The card number is incorrect.");
-    }
-    else if (declineCode == declineCodeInvalidPin()) {
-        description = tr("The PIN entered is incorrect.");
-    }
-    else if (declineCode == declineCodeIssuerNotAvailable()) {
-        description = tr("The card issuer could not be reached, so the payment could not be authorized.");
-    }
-    else if (declineCode == declineCodeLostCard()) {
-        if (omitSensitive) {
-            description = tr("The card has been declined for an unknown reason.");
-        }
-        else {
-            description = tr("The payment has been declined because the card is reported lost.");
-        }
-    }
-    else if (declineCode == declineCodeNewAccountInformationAvailable()) {
-        description = tr("The card, or account the card is connected to, is invalid.");
-    }
-    else if (declineCode == declineCodeNoActionTaken()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeNotPermitted()) {
-        description = tr("The payment is not permitted.");
-    }
-    else if (declineCode == declineCodePickupCard()) {
-        if (omitSensitive) {
-            description = tr("The card cannot be used to make this payment.");
+    const int index = declineCodeIndex(declineCode);
+    if (index > -1) {
+        const DeclineCodeTexts texts = translatedDeclineCode(index);
+        if (omitSensitive || texts.sensitiveDescription.isEmpty()) {
+            description = texts.description;
         }
         else {
-            description = tr("The card cannot be used to make this payment (it is possible it has been reported lost or stolen).");
+            description = texts.sensitiveDescription;
         }
     }
-    else if (declineCode == declineCodePinTryExceeded()) {
-        description = tr("The allowable number of PIN tries has been exceeded.");
-    }
-    else if (declineCode == declineCodeProcessingError()) {
-        description = tr("An error occurred while processing the card.");
-    }
-    else if (declineCode == declineCodeReenterTransaction()) {
-        description = tr("The payment could not be processed by the issuer for an unknown reason.");
-    }
-    else if (declineCode == declineCodeRestrictedCard()) {
-        if (omitSensitive) {
-            description = tr("The card cannot be used to make this payment");
-        }
-        else {
-            description = tr("The card cannot be used to make this payment (it is possible it has been reported lost or stolen).");
-        }
-    }
-    else if (declineCode == declineCodeRevocationOfAllAuthorizations()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeRevocationOfAuthorization()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeSecurityViolation()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeServiceNotAllowed()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeStolenCard()) {
-        if (omitSensitive) {
-            description = tr("The payment has been declined.");
-        }
-        else {
-            description = tr("The payment has been declined because the card is reported stolen.");
-        }
-    }
-    else if (declineCode == declineCodeStopPaymentOrder()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeTestmodeDecline()) {
-        description = tr("A Stripe test card number was used.");
-    }
-    else if (declineCode == declineCodeTransactionNotAllowed()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeTryAgainLater()) {
-        description = tr("The card has been declined for an unknown reason.");
-    }
-    else if (declineCode == declineCodeWithdrawalCountLimitExceeded()) {
-        description = tr("The customer has exceeded the balance or credit limit available on their card.");
-    }
     else {
         qDebug() << "[WARNING] Cannot find a description for the given decline code: " << declineCode;
     }
@@ -230,144 +543,16 @@ QString Error::declineCodeNextSteps(QString declineCode, bool omitSensitive) con
     }
 
     QString nextSteps = "";
-    if (declineCode == declineCodeApproveWithId()) {
-        nextSteps = tr("The payment should be attempted again. If it still cannot be processed, the customer needs to contact their card issuer.");
-    }
-    else if (declineCode == declineCodeCallIssuer()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeCardNotSupported()) {
-        nextSteps = tr("The customer needs to contact their card issuer to make sure their card can be used to make this type of purchase.");
-    }
-    else if (declineCode == declineCodeCardVelocityExceeded()) {
-        nextSteps = tr("The customer should contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeCurrencyNotSupported()) {
-        nextSteps = tr("The customer needs check with the issuer that the card can be used for the type of currency specified.");
-    }
-    else if (declineCode == declineCodeDoNotHonor()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeDoNotTryAgain()) {
-        nextSteps = tr("The customer should contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeDuplicateTransaction()) {
-        nextSteps = tr("Check to see if a recent payment already exists.");
-    }
-    else if (declineCode == declineCodeExpiredCard()) {
-        nextSteps = tr("The customer should use another card.");
-    }
-    else if (declineCode == declineCodeFraudulent()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeGenericDecline()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeIncorrectNumber()) {
-        nextSteps = tr("The customer should try again using the correct card number.");
-    }
-    else if (declineCode == declineCodeIncorrectCvc()) {
-        nextSteps = tr("The customer should try again using the correct CVC.");
-    }
-    else if (declineCode == declineCodeIncorrectPin()) {
-        nextSteps = tr("The customer should try again using the correct PIN.");
-    }
-    else if (declineCode == declineCodeIncorrectZip()) {
-        nextSteps = tr("The customer should try again using the correct billing ZIP/postal code.");
-    }
-    else if (declineCode == declineCodeInsufficientFunds()) {
-        nextSteps = tr("The customer should use an alternative payment method.");
-    }
-    else if (declineCode == declineCodeInvalidAccount()) {
-        nextSteps = tr("The customer needs to contact their card issuer to check that the card is working correctly.");
-    }
-    else if (declineCode == declineCodeInvalidAmount()) {
-        nextSteps = tr("If the amount appears to be correct, the customer needs to check with their card issuer that they can make purchases of that amount.");
-    }
-    else if (declineCode == declineCodeInvalidCvc()) {
-        nextSteps = tr("The customer should try again using the correct CVC.");
-    }
-    else if (declineCode == declineCodeInvalidExpiryYear()) {
-        nextSteps = tr("The customer should try again using the correct expiration date.");
-    }
-    else if (declineCode == declineCodeInvalidNumber()) {
-        nextSteps = tr("The customer should try again using the correct card number.");
-    }
-    else if (declineCode == declineCodeInvalidPin()) {
-        nextSteps = tr("The customer should try again using the correct PIN.");
-    }
-    else if (declineCode == declineCodeIssuerNotAvailable()) {
-        nextSteps = tr("The payment should be attempted again. If it still cannot be processed, the customer needs to contact their card issuer.");
-    }
-    else if (declineCode == declineCodeLostCard()) {
-        if (omitSensitive) {
-            nextSteps = tr("The customer needs to contact their card issuer for more information.");
+    const int index = declineCodeIndex(declineCode);
+    if (index > -1) {
+        const DeclineCodeTexts texts = translatedDeclineCode(index);
+        if (omitSensitive || texts.sensitiveNextSteps.isEmpty()) {
+            nextSteps = texts.nextSteps;
         }
         else {
-            nextSteps = tr("The specific reason for the decline should not be reported to the customer. Instead, it needs to be presented as a generic decline.");
+            nextSteps = texts.sensitiveNextSteps;
         }
     }
-    else if (declineCode == declineCodeNewAccountInformationAvailable()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeNoActionTaken()) {
-        nextSteps = tr("The customer should contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeNotPermitted()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodePickupCard()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodePinTryExceeded()) {
-        nextSteps = tr("The customer must use another card or method of payment.");
-    }
-    else if (declineCode == declineCodeProcessingError()) {
-        nextSteps = tr("The payment should be attempted again. If it still cannot be processed, try again later.");
-    }
-    else if (declineCode == declineCodeReenterTransaction()) {
-        nextSteps = tr("The payment should be attempted again. If it still cannot be processed, the customer needs to contact their card issuer.");
-    }
-    else if (declineCode == declineCodeRestrictedCard()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeRevocationOfAllAuthorizations()) {
-        nextSteps = tr("The customer should contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeRevocationOfAuthorization()) {
-        nextSteps = tr("The customer should contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeSecurityViolation()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeServiceNotAllowed()) {
-        nextSteps = tr("The customer should contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeStolenCard()) {
-        if (omitSensitive) {
-            nextSteps = tr("The customer needs to contact their card issuer for more information.");
-        }
-        else {
-            nextSteps = tr("The specific reason for the decline should not be reported to the customer. Instead, it needs to be presented as a generic decline.");
-        }
-
-    }
-    else if (declineCode == declineCodeStopPaymentOrder()) {
-        nextSteps = tr("The customer should contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeTestmodeDecline()) {
-        nextSteps = tr("A genuine card must be used to make a payment.");
-    }
-    else if (declineCode == declineCodeTransactionNotAllowed()) {
-        nextSteps = tr("The customer needs to contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeTryAgainLater()) {
-        nextSteps =
-            tr("Ask the customer to attempt the payment again. If subsequent payments are declined, the customer should contact their card issuer for more information.");
-    }
-    else if (declineCode == declineCodeWithdrawalCountLimitExceeded()) {
-        nextSteps = tr("The customer should use an alternative payment method.");
-    }
     else {
         qDebug() << "[WARNING] Cannot find a next step for the given decline code: " << declineCode;
     }
@@ -375,76 +560,40 @@ QString Error::declineCodeNextSteps(QString declineCode, bool omitSensitive) con
     return nextSteps;
 }
 
-Error::ErrorType Error::errorTypeFromString(const QString &typeString) const
+bool Error::declineCodeSensitive(QString declineCode) const
 {
-    ErrorType type = ErrorType::ErrorNone;
-    if (typeString == "api_connection_error") {
-        type = ErrorType::ErrorApiConnection;
-    }
-    else if (typeString == "api_error") {
-        type = ErrorType::ErrorApi;
-    }
-    else if (typeString == "authentication_error") {
-        type = ErrorType::ErrorAuthentication;
-    }
-    else if (typeString == "card_error") {
-        type = ErrorType::ErrorCard;
-    }
-    else if (typeString == "idempotency_error") {
-        type = ErrorType::ErrorIdempotency;
-    }
-    else if (typeString == "invalid_request_error") {
-        type = ErrorType::ErrorInvalidRequest;
+    if (declineCode.isEmpty()) {
+        declineCode = m_DeclineCode;
     }
-    else if (typeString == "rate_limit_error") {
-        type = ErrorType::ErrorRateLimit;
+
+    const int index = declineCodeIndex(declineCode);
+    return index > -1 && DECLINE_CODES[index].isSensitive;
+}
+
+bool Error::declineCodeRetryable(QString declineCode) const
+{
+    if (declineCode.isEmpty()) {
+        declineCode = m_DeclineCode;
     }
 
-    return type;
+    const int index = declineCodeIndex(declineCode);
+    return index > -1 && DECLINE_CODES[index].isRetryable;
 }
 
-Error::ErrorCode Error::errorCodeFromString(const QString &codeStr) const
+void Error::clearDeclineCodeTranslations()
 {
-    ErrorCode code = ErrorCode::CodeNone;
+    QMutexLocker locker(&s_DeclineCodeTranslationsMutex);
+    s_DeclineCodeTranslations.clear();
+}
 
-    if (codeStr == "invalid_number") {
-        code = ErrorCode::CodeInvalidNumber;
-    }
-    else if (codeStr == "invalid_expiry_month") {
-        code = ErrorCode::CodeInvalidExpiryMonth;
-    }
-    else if (codeStr == "invalid_expiry_year") {
-        code = ErrorCode::CodeInvalidExpiryYear;
-    }
-    else if (codeStr == "invalid_cvc") {
-        code = ErrorCode::CodeInvalidCVC;
-    }
-    else if (codeStr == "invalid_swipe_data") {
-        code = ErrorCode::CodeInvalidSwipeData;
-    }
-    else if (codeStr == "incorrect_number") {
-        code = ErrorCode::CodeIncorrectNumber;
-    }
-    else if (codeStr == "expired_card") {
-        code = ErrorCode::CodeExpiredCard;
-    }
-    else if (codeStr == "incorrect_cvc") {
-        code = ErrorCode::CodeIncorrectCVC;
-    }
-    else if (codeStr == "incorrect_zip") {
-        code = ErrorCode::CodeIncorrectZip;
-    }
-    else if (codeStr == "card_declined") {
-        code = ErrorCode::CodeCardDeclined;
-    }
-    else if (codeStr == "missing") {
-        code = ErrorCode::CodeMissing;
-    }
-    else if (codeStr == "processing_error") {
-        code = ErrorCode::CodeProcessingError;
-    }
+Error::ErrorType Error::errorTypeFromString(const QString &typeString) const
+{
+    return EnumTable::value(ERROR_TYPES, typeString, ErrorType::ErrorNone);
+}
 
-    return code;
+Error::ErrorCode Error::errorCodeFromString(const QString &codeStr) const
+{
+    return EnumTable::value(ERROR_CODES, codeStr, ErrorCode::CodeNone);
 }
 
 void Error::set(QVariantMap errorResponse, int httpCode, int networkErrorCode)
@@ -514,6 +663,54 @@ void Error::set(QVariantMap errorResponse, int httpCode, int networkErrorCode)
     m_NetworkError = networkErrorCode;
 }
 
+void Error::set(QJsonObject errorResponse, int httpCode, int networkErrorCode)
+{
+    if (errorResponse.contains("error")) {
+        errorResponse = errorResponse["error"].toObject();
+    }
+
+    m_RawError = errorResponse.toVariantMap();
+    m_Type = ErrorType::ErrorNone;
+    m_ChargeID = "";
+    m_Message = "";
+    m_Code = ErrorCode::CodeNone;
+    m_DeclineCode = "";
+    m_Param = "";
+
+    for (auto it = errorResponse.constBegin(); it != errorResponse.constEnd(); it++) {
+        const QString &key = it.key();
+        if (key == "type") {
+            // Stripe reports authentication with a an invalid request error
+            // type.
+            m_Type = httpCode == NetworkUtils::HTTP_401 ? ErrorType::ErrorAuthentication : errorTypeFromString(it.value().toString());
+        }
+        else if (key == "charge") {
+            m_ChargeID = it.value().toString();
+        }
+        else if (key == "message") {
+            m_Message = it.value().toString();
+        }
+        else if (key == "code") {
+            m_Code = errorCodeFromString(it.value().toString());
+        }
+        else if (key == "decline_code") {
+            m_DeclineCode = it.value().toString();
+        }
+        else if (key == "param") {
+            m_Param = it.value().toString();
+        }
+    }
+
+    if (networkErrorCode == QNetworkReply::ConnectionRefusedError ||
+        networkErrorCode == QNetworkReply::RemoteHostClosedError ||
+        networkErrorCode == QNetworkReply::HostNotFoundError) {
+        m_Type = ErrorType::ErrorApiConnection;
+    }
+
+    m_HttpStatus = httpCode;
+    m_NetworkError = networkErrorCode;
+}
+
 void Error::clear()
 {
     m_ChargeID = "";
@@ -0,0 +1,300 @@
+#include "QStripe/ListIterator.h"
+// Qt
+#include <QDebug>
+// QStripe
+#include "QStripe/Customer.h"
+#include "QStripe/Stripe.h"
+#include "QStripe/Card.h"
+
+namespace QStripe
+{
+
+ListIterator::ListIterator(QObject *parent)
+    : QObject(parent)
+    , m_ObjectType(ObjectCustomer)
+    , m_CustomerID("")
+    , m_Limit(10)
+    , m_CreatedAfter()
+    , m_CreatedBefore()
+    , m_NetworkUtils(this)
+    , m_Error()
+    , m_Generation(0)
+    , m_Cursor("")
+    , m_PrefetchedPage()
+    , m_CurrentPage()
+    , m_HasMore(false)
+    , m_IsRunning(false)
+    , m_IsPrefetchReady(false)
+    , m_IsPageRequested(false)
+    , m_ServerHasMore(false)
+{
+    m_NetworkUtils.setPriority(NetworkTransport::PriorityBulk);
+}
+
+ListIterator::ObjectType ListIterator::objectType() const
+{
+    return m_ObjectType;
+}
+
+void ListIterator::setObjectType(ObjectType type)
+{
+    const bool changed = m_ObjectType != type;
+    if (changed) {
+        m_ObjectType = type;
+        emit objectTypeChanged();
+    }
+}
+
+QString ListIterator::customerID() const
+{
+    return m_CustomerID;
+}
+
+void ListIterator::setCustomerID(const QString &id)
+{
+    const bool changed = m_CustomerID != id;
+    if (changed) {
+        m_CustomerID = id;
+        emit customerIDChanged();
+    }
+}
+
+int ListIterator::limit() const
+{
+    return m_Limit;
+}
+
+void ListIterator::setLimit(int limit)
+{
+    const bool changed = m_Limit != limit && limit > 0 && limit <= 100;
+    if (changed) {
+        m_Limit = limit;
+        emit limitChanged();
+    }
+}
+
+QDateTime ListIterator::createdAfter() const
+{
+    return m_CreatedAfter;
+}
+
+void ListIterator::setCreatedAfter(const QDateTime &date)
+{
+    const bool changed = m_CreatedAfter != date;
+    if (changed) {
+        m_CreatedAfter = date;
+        emit createdAfterChanged();
+    }
+}
+
+QDateTime ListIterator::createdBefore() const
+{
+    return m_CreatedBefore;
+}
+
+void ListIterator::setCreatedBefore(const QDateTime &date)
+{
+    const bool changed = m_CreatedBefore != date;
+    if (changed) {
+        m_CreatedBefore = date;
+        emit createdBeforeChanged();
+    }
+}
+
+bool ListIterator::hasMore() const
+{
+    return m_HasMore;
+}
+
+bool ListIterator::running() const
+{
+    return m_IsRunning;
+}
+
+bool ListIterator::start()
+{
+    if (Stripe::secretKey().length() == 0) {
+        qDebug() << "[ERROR] secretKey is not set in the Stripe instance. Cannot send the request.";
+        return false;
+    }
+
+    if (m_ObjectType == ObjectCard && m_CustomerID.length() == 0) {
+        qDebug() << "[ERROR] customerID is required to list the cards.";
+        return false;
+    }
+
+    m_NetworkUtils.setHeader("Authorization", "Bearer " + Stripe::secretKey());
+    if (Stripe::apiVersion().length() > 0) {
+        m_NetworkUtils.setHeader("Stripe-Version", Stripe::apiVersion());
+    }
+
+    m_Generation++;
+    clearCurrentPage();
+    m_Cursor = "";
+    m_PrefetchedPage = QJsonArray();
+    m_IsPrefetchReady = false;
+    m_IsPageRequested = true;
+    m_ServerHasMore = false;
+    setHasMore(false);
+    setRunning(true);
+
+    fetchPage();
+    return true;
+}
+
+bool ListIterator::next()
+{
+    if (m_IsRunning == false || m_HasMore == false || m_IsPageRequested) {
+        return false;
+    }
+
+    m_IsPageRequested = true;
+    if (m_IsPrefetchReady) {
+        emitPage();
+    }
+
+    return true;
+}
+
+void ListIterator::cancel()
+{
+    m_Generation++;
+    m_PrefetchedPage = QJsonArray();
+    m_IsPrefetchReady = false;
+    m_IsPageRequested = false;
+    setHasMore(false);
+    setRunning(false);
+}
+
+const Error *ListIterator::lastError() const
+{
+    return &m_Error;
+}
+
+void ListIterator::fetchPage()
+{
+    const unsigned int generation = m_Generation;
+    auto callback = [this, generation](const Response & response) {
+        if (generation != m_Generation) {
+            return;
+        }
+
+        const QJsonObject data = response.json();
+        if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
+            m_PrefetchedPage = data["data"].toArray();
+            m_ServerHasMore = data["has_more"].toBool() && m_PrefetchedPage.size() > 0;
+            if (m_PrefetchedPage.size() > 0) {
+                m_Cursor = m_PrefetchedPage.last().toObject()["id"].toString();
+            }
+
+            m_IsPrefetchReady = true;
+            if (m_IsPageRequested) {
+                emitPage();
+            }
+        }
+        else {
+            qDebug() << "[ERROR] Error occurred while fetching the list page.";
+            m_IsPageRequested = false;
+            setHasMore(false);
+            setRunning(false);
+            m_Error.set(data, response.httpStatus, response.networkError);
+            emit errorOccurred(&m_Error);
+        }
+    };
+
+    const QString url = m_ObjectType == ObjectCard ? Card::getURL(m_CustomerID) : Customer::getURL();
+    m_NetworkUtils.sendGet(url, callback, queryParams());
+}
+
+void ListIterator::emitPage()
+{
+    m_IsPageRequested = false;
+    m_IsPrefetchReady = false;
+    clearCurrentPage();
+
+    QVariantList objects;
+    for (const QJsonValue &item : m_PrefetchedPage) {
+        QObject *object = nullptr;
+        if (m_ObjectType == ObjectCard) {
+            object = Card::fromJson(item.toObject());
+        }
+        else {
+            object = Customer::fromJson(item.toObject());
+        }
+
+        object->setParent(this);
+        m_CurrentPage.append(object);
+        objects.append(QVariant::fromValue(object));
+    }
+
+    m_PrefetchedPage = QJsonArray();
+    setHasMore(m_ServerHasMore);
+    // Prefetch the following page while the consumer processes this one.
+    if (m_HasMore) {
+        fetchPage();
+    }
+
+    const unsigned int generation = m_Generation;
+    emit pageReceived(objects);
+
+    // The iteration may be restarted or cancelled from a slot.
+    if (generation == m_Generation && m_HasMore == false) {
+        setRunning(false);
+        emit finished();
+    }
+}
+
+void ListIterator::clearCurrentPage()
+{
+    for (const QPointer<QObject> &object : m_CurrentPage) {
+        if (object && object->parent() == this) {
+            object->deleteLater();
+        }
+    }
+
+    m_CurrentPage.clear();
+}
+
+QVariantMap ListIterator::queryParams() const
+{
+    QVariantMap params;
+    params["limit"] = QString::number(m_Limit);
+    if (m_Cursor.length() > 0) {
+        params["starting_after"] = m_Cursor;
+    }
+
+    if (m_CreatedAfter.isValid()) {
+        params["created[gte]"] = QString::number(m_CreatedAfter.toMSecsSinceEpoch() / 1000);
+    }
+
+    if (m_CreatedBefore.isValid()) {
+        params["created[lte]"] = QString::number(m_CreatedBefore.toMSecsSinceEpoch() / 1000);
+    }
+
+    // The sources endpoint returns every kind of source unless it is filtered.
+    if (m_ObjectType == ObjectCard) {
+        params["object"] = "card";
+    }
+
+    return params;
+}
+
+void ListIterator::setHasMore(bool hasMore)
+{
+    const bool changed = m_HasMore != hasMore;
+    if (changed) {
+        m_HasMore = hasMore;
+        emit hasMoreChanged();
+    }
+}
+
+void ListIterator::setRunning(bool running)
+{
+    const bool changed = m_IsRunning != running;
+    if (changed) {
+        m_IsRunning = running;
+        emit runningChanged();
+    }
+}
+
+}
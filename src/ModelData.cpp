@@ -0,0 +1,285 @@
+#include "QStripe/ModelData.h"
+// std
+#include <unordered_map>
+// Qt
+#include <QMutex>
+// QStripe
+#include "QStripe/ShippingInformation.h"
+#include "QStripe/Customer.h"
+
+namespace QStripe
+{
+
+AddressData::AddressData()
+    : zipCheck(Address::ZipCheckUnknown)
+{
+
+}
+
+AddressData AddressData::fromJson(const QJsonObject &object, const QString &prefix)
+{
+    AddressData address;
+    schema(prefix).read(address, object);
+    return address;
+}
+
+void AddressData::writeJson(QJsonObject &object, const QString &prefix) const
+{
+    schema(prefix).writeJson(object, *this);
+}
+
+const FieldSchema<AddressData> &AddressData::schema(const QString &prefix)
+{
+    // The address of a customer and the embedded address of a card are the only prefixes the library uses, so they are built once up front.
+    static const FieldSchema<AddressData> addressSchema = createSchema(QString());
+    static const FieldSchema<AddressData> cardAddressSchema = createSchema(Card::FIELD_ADDRESS_PREFIX);
+    if (prefix.isEmpty()) {
+        return addressSchema;
+    }
+    else if (prefix == Card::FIELD_ADDRESS_PREFIX) {
+        return cardAddressSchema;
+    }
+
+    // The other prefixes come from the users of Address. std::unordered_map does not move its elements when it grows, so the returned reference stays
+    // valid.
+    struct PrefixHash {
+        size_t operator()(const QString &key) const
+        {
+            return qHash(key);
+        }
+    };
+
+    static std::unordered_map<QString, FieldSchema<AddressData>, PrefixHash> schemas;
+    static QMutex mutex;
+
+    QMutexLocker locker(&mutex);
+    auto it = schemas.find(prefix);
+    if (it == schemas.end()) {
+        it = schemas.emplace(prefix, createSchema(prefix)).first;
+    }
+
+    return it->second;
+}
+
+FieldSchema<AddressData> AddressData::createSchema(const QString &prefix)
+{
+    return FieldSchema<AddressData>()
+           .add(prefix + Address::FIELD_COUNTRY, &AddressData::country)
+           .add(prefix + Address::FIELD_CITY, &AddressData::city)
+           .add(prefix + Address::FIELD_STATE, &AddressData::state)
+           .add(prefix + Address::FIELD_LINE_1, &AddressData::lineOne)
+           .add(prefix + Address::FIELD_LINE_2, &AddressData::lineTwo)
+           .add(prefix + Address::FIELD_POSTAL_CODE, &AddressData::postalCode)
+           .addEnum(prefix + Address::FIELD_ZIP_CHECK, &AddressData::zipCheck, &Address::zipCheckName, &Address::zipCheckType);
+}
+
+bool AddressData::operator==(const AddressData &other) const
+{
+    return schema().equals(*this, other);
+}
+
+bool AddressData::operator!=(const AddressData &other) const
+{
+    return !(*this == other);
+}
+
+ShippingInformationData ShippingInformationData::fromJson(const QJsonObject &object)
+{
+    ShippingInformationData shipping;
+    schema().read(shipping, object);
+    return shipping;
+}
+
+QJsonObject ShippingInformationData::json() const
+{
+    return schema().json(*this);
+}
+
+const FieldSchema<ShippingInformationData> &ShippingInformationData::schema()
+{
+    static const FieldSchema<ShippingInformationData> shippingSchema = FieldSchema<ShippingInformationData>()
+            .addNested(ShippingInformation::FIELD_ADDRESS, &ShippingInformationData::address, AddressData::schema())
+            .add(ShippingInformation::FIELD_NAME, &ShippingInformationData::name)
+            .add(ShippingInformation::FIELD_PHONE, &ShippingInformationData::phone);
+
+    return shippingSchema;
+}
+
+bool ShippingInformationData::operator==(const ShippingInformationData &other) const
+{
+    return schema().equals(*this, other);
+}
+
+bool ShippingInformationData::operator!=(const ShippingInformationData &other) const
+{
+    return !(*this == other);
+}
+
+TokenData::TokenData()
+    : type(Token::TypeUnknown)
+    , liveMode(false)
+    , used(false)
+{
+
+}
+
+TokenData TokenData::fromJson(const QJsonObject &object)
+{
+    TokenData token;
+    schema().read(token, object);
+    return token;
+}
+
+QJsonObject TokenData::json() const
+{
+    return schema().json(*this);
+}
+
+const FieldSchema<TokenData> &TokenData::schema()
+{
+    static const FieldSchema<TokenData> tokenSchema = FieldSchema<TokenData>()
+            .add(Token::FIELD_BANK_ACCOUNT, &TokenData::bankAccount)
+            .add(Token::FIELD_CREATED, &TokenData::created)
+            .add(Token::FIELD_ID, &TokenData::tokenID)
+            .add(Token::FIELD_LIVEMODE, &TokenData::liveMode)
+            .addEnum(Token::FIELD_TYPE, &TokenData::type, &Token::typeName, &Token::typeEnum, Token::TypeUnknown)
+            .add(Token::FIELD_USED, &TokenData::used);
+
+    return tokenSchema;
+}
+
+bool TokenData::operator==(const TokenData &other) const
+{
+    return schema().equals(*this, other);
+}
+
+bool TokenData::operator!=(const TokenData &other) const
+{
+    return !(*this == other);
+}
+
+CardData::CardData()
+    : brand(Card::Unknown)
+    , cvcCheck(Card::CVCCheckUnknown)
+    , expirationMonth(0)
+    , expirationYear(0)
+    , funding(Card::FundingUnknown)
+    , tokenizationMethod(Card::TokenizationUnknown)
+{
+
+}
+
+CardData CardData::fromJson(const QJsonObject &object)
+{
+    CardData card;
+    schema().read(card, object);
+    return card;
+}
+
+QVector<CardData> CardData::fromJson(const QJsonArray &array)
+{
+    QVector<CardData> cards;
+    cards.reserve(array.size());
+    for (const QJsonValue &value : array) {
+        cards.append(fromJson(value.toObject()));
+    }
+
+    return cards;
+}
+
+QJsonObject CardData::json() const
+{
+    return schema().json(*this);
+}
+
+const FieldSchema<CardData> &CardData::schema()
+{
+    static const FieldSchema<CardData> cardSchema = FieldSchema<CardData>()
+            .add(Card::FIELD_ID, &CardData::cardID)
+            .addEnum(Card::FIELD_BRAND, &CardData::brand, &Card::cardBrandName, &Card::cardBrandType, Card::Unknown)
+            .add(Card::FIELD_COUNTRY, &CardData::country)
+            .add(Card::FIELD_CURRENCY, &CardData::currency)
+            .addEnum(Card::FIELD_CVC_CHECK, &CardData::cvcCheck, &Card::cvcCheckName, &Card::cvcCheckType, Card::CVCCheckUnknown)
+            .add(Card::FIELD_EXP_MONTH, &CardData::expirationMonth)
+            .add(Card::FIELD_EXP_YEAR, &CardData::expirationYear)
+            .add(Card::FIELD_FINGERPRINT, &CardData::fingerprint)
+            .addEnum(Card::FIELD_FUNDING, &CardData::funding, &Card::fundingTypeString, &Card::fundingType, Card::FundingUnknown)
+            .add(Card::FIELD_NAME, &CardData::name)
+            .add(Card::FIELD_LAST4, &CardData::lastFourDigits)
+            .addEnum(Card::FIELD_TOKENIZATION_METHOD, &CardData::tokenizationMethod, &Card::tokenizationMethodName, &Card::tokenizationMethodType,
+                     Card::TokenizationUnknown)
+            .add(Card::FIELD_METADATA, &CardData::metadata)
+            .addEmbedded(&CardData::address, AddressData::schema(Card::FIELD_ADDRESS_PREFIX));
+
+    return cardSchema;
+}
+
+bool CardData::operator==(const CardData &other) const
+{
+    return schema().equals(*this, other);
+}
+
+bool CardData::operator!=(const CardData &other) const
+{
+    return !(*this == other);
+}
+
+CustomerData::CustomerData()
+    : deleted(false)
+{
+
+}
+
+CustomerData CustomerData::fromJson(const QJsonObject &object)
+{
+    CustomerData customer;
+    schema().read(customer, object);
+    return customer;
+}
+
+QVector<CustomerData> CustomerData::fromJson(const QJsonArray &array)
+{
+    QVector<CustomerData> customers;
+    customers.reserve(array.size());
+    for (const QJsonValue &value : array) {
+        customers.append(fromJson(value.toObject()));
+    }
+
+    return customers;
+}
+
+QJsonObject CustomerData::json() const
+{
+    return schema().json(*this);
+}
+
+const FieldSchema<CustomerData> &CustomerData::schema()
+{
+    static const FieldSchema<CustomerData> customerSchema = FieldSchema<CustomerData>()
+            .add(Customer::FIELD_ID, &CustomerData::customerID).alwaysOmitEmpty()
+            .add(Customer::FIELD_CURRENCY, &CustomerData::currency)
+            .add(Customer::FIELD_DEFAULT_SOURCE, &CustomerData::defaultSource)
+            .addNested(Customer::FIELD_SHIPPING, &CustomerData::shipping, ShippingInformationData::schema())
+            // Stripe requires both the name and the phone for the shipping information, so it is not sent If one of them is missing.
+            .setEmptyCheck([](const CustomerData &customer) {
+                return customer.shipping.name.isEmpty() || customer.shipping.phone.isEmpty();
+            })
+            .add(Customer::FIELD_EMAIL, &CustomerData::email)
+            .add(Customer::FIELD_DESCRIPTION, &CustomerData::description)
+            .add(Customer::FIELD_METADATA, &CustomerData::metadata)
+            .add(Customer::FIELD_DELETED, &CustomerData::deleted).alwaysOmitEmpty();
+
+    return customerSchema;
+}
+
+bool CustomerData::operator==(const CustomerData &other) const
+{
+    return schema().equals(*this, other);
+}
+
+bool CustomerData::operator!=(const CustomerData &other) const
+{
+    return !(*this == other);
+}
+
+}
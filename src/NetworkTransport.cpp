@@ -0,0 +1,617 @@
+#include "QStripe/NetworkTransport.h"
+// Qt
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QtMath>
+// QStripe
+#include "QStripe/NetworkUtils.h"
+
+namespace QStripe
+{
+
+QWeakPointer<NetworkTransport> NetworkTransport::m_Instance;
+int NetworkTransport::m_PoolSize = 1;
+bool NetworkTransport::m_IsHttp2Enabled = false;
+int NetworkTransport::m_RetryMaxAttempts = 3;
+int NetworkTransport::m_RetryBaseDelay = 250;
+int NetworkTransport::m_RetryMaxDelay = 8000;
+int NetworkTransport::m_RetryDeadline = 30000;
+int NetworkTransport::m_IdempotencyTableSize = 100;
+double NetworkTransport::m_ReadRate = 0;
+double NetworkTransport::m_WriteRate = 0;
+int NetworkTransport::m_StarvationThreshold = 2000;
+bool NetworkTransport::m_IsGetDeduplicationEnabled = true;
+
+NetworkTransport::NetworkTransport(QObject *parent)
+    : QObject(parent)
+    , m_Managers()
+    , m_NextManager(0)
+    , m_Http1Hosts()
+    , m_Http2ReplyCount(0)
+    , m_Http1ReplyCount(0)
+    , m_Http2FallbackCount(0)
+    , m_RetryCount(0)
+    , m_IdempotentReplayCount(0)
+    , m_DeduplicatedGetCount(0)
+    , m_ReadBucket()
+    , m_WriteBucket()
+    , m_Clock()
+    , m_DrainTimer()
+    , m_LaneMetrics()
+    , m_IdempotentEntries()
+    , m_FinishedIdempotentKeys()
+    , m_InFlightGets()
+#ifndef QT_NO_SSL
+    , m_SslConfiguration(QSslConfiguration::defaultConfiguration())
+#endif // QT_NO_SSL
+{
+#ifndef QT_NO_SSL
+    // Session persistence is required to be able to hand the session ticket of one manager to the others.
+    m_SslConfiguration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+#endif // QT_NO_SSL
+
+    m_Clock.start();
+    m_DrainTimer.setSingleShot(true);
+    connect(&m_DrainTimer, &QTimer::timeout, this, &NetworkTransport::drain);
+
+    growPool();
+}
+
+NetworkTransport::~NetworkTransport()
+{
+
+}
+
+QSharedPointer<NetworkTransport> NetworkTransport::instance()
+{
+    QSharedPointer<NetworkTransport> transport = m_Instance.toStrongRef();
+    if (transport.isNull()) {
+        transport = QSharedPointer<NetworkTransport>(new NetworkTransport(), &QObject::deleteLater);
+        m_Instance = transport;
+    }
+
+    return transport;
+}
+
+int NetworkTransport::poolSize()
+{
+    return m_PoolSize;
+}
+
+void NetworkTransport::setPoolSize(int size)
+{
+    const bool changed = size != m_PoolSize && size > 0;
+    if (changed) {
+        m_PoolSize = size;
+
+        QSharedPointer<NetworkTransport> transport = m_Instance.toStrongRef();
+        if (transport) {
+            transport->growPool();
+        }
+    }
+}
+
+bool NetworkTransport::http2Enabled()
+{
+    return m_IsHttp2Enabled;
+}
+
+void NetworkTransport::setHttp2Enabled(bool enabled)
+{
+    m_IsHttp2Enabled = enabled;
+}
+
+int NetworkTransport::retryMaxAttempts()
+{
+    return m_RetryMaxAttempts;
+}
+
+void NetworkTransport::setRetryMaxAttempts(int attempts)
+{
+    if (attempts > 0) {
+        m_RetryMaxAttempts = attempts;
+    }
+}
+
+int NetworkTransport::retryBaseDelay()
+{
+    return m_RetryBaseDelay;
+}
+
+void NetworkTransport::setRetryBaseDelay(int msecs)
+{
+    if (msecs >= 0) {
+        m_RetryBaseDelay = msecs;
+    }
+}
+
+int NetworkTransport::retryMaxDelay()
+{
+    return m_RetryMaxDelay;
+}
+
+void NetworkTransport::setRetryMaxDelay(int msecs)
+{
+    if (msecs >= 0) {
+        m_RetryMaxDelay = msecs;
+    }
+}
+
+int NetworkTransport::retryDeadline()
+{
+    return m_RetryDeadline;
+}
+
+void NetworkTransport::setRetryDeadline(int msecs)
+{
+    if (msecs >= 0) {
+        m_RetryDeadline = msecs;
+    }
+}
+
+void NetworkTransport::countRetry()
+{
+    m_RetryCount++;
+}
+
+int NetworkTransport::retryCount() const
+{
+    return m_RetryCount;
+}
+
+double NetworkTransport::readRate()
+{
+    return m_ReadRate;
+}
+
+void NetworkTransport::setReadRate(double requestsPerSecond)
+{
+    if (requestsPerSecond >= 0) {
+        m_ReadRate = requestsPerSecond;
+        QSharedPointer<NetworkTransport> transport = m_Instance.toStrongRef();
+        if (transport) {
+            transport->drain();
+        }
+    }
+}
+
+double NetworkTransport::writeRate()
+{
+    return m_WriteRate;
+}
+
+void NetworkTransport::setWriteRate(double requestsPerSecond)
+{
+    if (requestsPerSecond >= 0) {
+        m_WriteRate = requestsPerSecond;
+        QSharedPointer<NetworkTransport> transport = m_Instance.toStrongRef();
+        if (transport) {
+            transport->drain();
+        }
+    }
+}
+
+int NetworkTransport::starvationThreshold()
+{
+    return m_StarvationThreshold;
+}
+
+void NetworkTransport::setStarvationThreshold(int msecs)
+{
+    if (msecs >= 0) {
+        m_StarvationThreshold = msecs;
+    }
+}
+
+void NetworkTransport::submit(QObject *owner, bool write, Priority priority, std::function<void()> &&start)
+{
+    TokenBucket &bucket = write ? m_WriteBucket : m_ReadBucket;
+    // Skip the queue when there is no limit and nothing is waiting, this keeps the order of the requests.
+    if (currentRate(bucket, write) <= 0 && bucket.isEmpty()) {
+        m_LaneMetrics[priority].dequeuedCount++;
+        start();
+        return;
+    }
+
+    bucket.lanes[priority].enqueue(Job{QPointer<QObject>(owner), std::move(start), m_Clock.elapsed(), priority});
+    drain();
+}
+
+void NetworkTransport::reportLatency(Priority priority, qint64 msecs)
+{
+    m_LaneMetrics[priority].totalLatency += msecs;
+    m_LaneMetrics[priority].finishedCount++;
+}
+
+int NetworkTransport::averageLatency(Priority priority) const
+{
+    const LaneMetrics &metrics = m_LaneMetrics[priority];
+    return metrics.finishedCount > 0 ? static_cast<int>(metrics.totalLatency / metrics.finishedCount) : 0;
+}
+
+int NetworkTransport::averageQueueWaitTime(Priority priority) const
+{
+    const LaneMetrics &metrics = m_LaneMetrics[priority];
+    return metrics.dequeuedCount > 0 ? static_cast<int>(metrics.totalQueueWaitTime / metrics.dequeuedCount) : 0;
+}
+
+void NetworkTransport::reportResponse(bool write, int httpStatus)
+{
+    TokenBucket &bucket = write ? m_WriteBucket : m_ReadBucket;
+    if (httpStatus == NetworkUtils::HTTP_429) {
+        // Multiplicative decrease. The tokens are dropped so that the bucket pauses instead of sending another burst.
+        bucket.factor = qMax(0.05, bucket.factor / 2);
+        bucket.tokens = 0;
+        bucket.updatedAt = m_Clock.elapsed();
+    }
+    else if (httpStatus > 0 && bucket.factor < 1) {
+        // Additive increase back to the configured rate.
+        bucket.factor = qMin(1.0, bucket.factor + 0.05);
+    }
+}
+
+int NetworkTransport::queuedRequestCount() const
+{
+    return m_ReadBucket.size() + m_WriteBucket.size();
+}
+
+int NetworkTransport::queueWaitTime() const
+{
+    const qint64 now = m_Clock.elapsed();
+    double wait = 0;
+    const bool writes[] = {false, true};
+    for (bool write : writes) {
+        TokenBucket bucket = write ? m_WriteBucket : m_ReadBucket;
+        const double rate = currentRate(bucket, write);
+        if (rate > 0) {
+            refill(bucket, rate, now);
+            // The new request needs a token after all of the queued ones.
+            wait = qMax(wait, (bucket.size() + 1 - bucket.tokens) * 1000 / rate);
+        }
+    }
+
+    return static_cast<int>(qMax(0.0, wait));
+}
+
+int NetworkTransport::idempotencyTableSize()
+{
+    return m_IdempotencyTableSize;
+}
+
+void NetworkTransport::setIdempotencyTableSize(int size)
+{
+    if (size > 0) {
+        m_IdempotencyTableSize = size;
+    }
+}
+
+bool NetworkTransport::joinIdempotent(const QString &key, QObject *context, const std::function<void(const Response &)> &callback)
+{
+    auto it = m_IdempotentEntries.find(key);
+    if (it == m_IdempotentEntries.end()) {
+        m_IdempotentEntries.insert(key, IdempotentEntry());
+        return false;
+    }
+
+    m_IdempotentReplayCount++;
+    if (it->finished) {
+        const QSharedPointer<Response> response = it->response;
+        // Keep the callback asynchronous, the same as a network reply.
+        QTimer::singleShot(0, context, [callback, response]() {
+            if (callback) {
+                callback(*response);
+            }
+        });
+    }
+    else {
+        it->waiting.append(qMakePair(QPointer<QObject>(context), callback));
+    }
+
+    return true;
+}
+
+void NetworkTransport::finishIdempotent(const QString &key, const Response &response)
+{
+    auto it = m_IdempotentEntries.find(key);
+    if (it == m_IdempotentEntries.end()) {
+        return;
+    }
+
+    const auto waiting = it->waiting;
+    const bool replayable = response.httpStatus > 0 &&
+                            response.httpStatus < NetworkUtils::HTTP_500 &&
+                            response.httpStatus != NetworkUtils::HTTP_409 &&
+                            response.httpStatus != NetworkUtils::HTTP_429;
+    if (replayable) {
+        it->finished = true;
+        it->response = QSharedPointer<Response>(new Response(response));
+        it->waiting.clear();
+
+        m_FinishedIdempotentKeys.enqueue(key);
+        while (m_FinishedIdempotentKeys.size() > m_IdempotencyTableSize) {
+            m_IdempotentEntries.remove(m_FinishedIdempotentKeys.dequeue());
+        }
+    }
+    else {
+        m_IdempotentEntries.erase(it);
+    }
+
+    for (const auto &waiter : waiting) {
+        if (waiter.first && waiter.second) {
+            waiter.second(response);
+        }
+    }
+}
+
+void NetworkTransport::abandonIdempotent(const QString &key, QObject *context)
+{
+    auto it = m_IdempotentEntries.find(key);
+    if (it == m_IdempotentEntries.end() || it->finished) {
+        return;
+    }
+
+    for (int index = it->waiting.size() - 1; index >= 0; index--) {
+        if (it->waiting.at(index).first == context) {
+            it->waiting.remove(index);
+        }
+    }
+
+    finishIdempotent(key, Response("", 0, QNetworkReply::OperationCanceledError));
+}
+
+int NetworkTransport::idempotentReplayCount() const
+{
+    return m_IdempotentReplayCount;
+}
+
+bool NetworkTransport::getDeduplicationEnabled()
+{
+    return m_IsGetDeduplicationEnabled;
+}
+
+void NetworkTransport::setGetDeduplicationEnabled(bool enabled)
+{
+    m_IsGetDeduplicationEnabled = enabled;
+}
+
+QString NetworkTransport::getDeduplicationKey(const QNetworkRequest &request)
+{
+    // The headers include the secret key and the API version, which change the response.
+    QByteArray key = request.url().toEncoded();
+    for (const QByteArray &header : request.rawHeaderList()) {
+        key += '\n' + header + ": " + request.rawHeader(header);
+    }
+
+    return QString::fromUtf8(key);
+}
+
+bool NetworkTransport::joinGet(const QString &key, QObject *context, const std::function<void(const Response &)> &callback)
+{
+    auto it = m_InFlightGets.find(key);
+    if (it == m_InFlightGets.end()) {
+        m_InFlightGets.insert(key, Waiters());
+        return false;
+    }
+
+    m_DeduplicatedGetCount++;
+    it->append(qMakePair(QPointer<QObject>(context), callback));
+    return true;
+}
+
+void NetworkTransport::finishGet(const QString &key, const Response &response)
+{
+    // The response is passed by reference to every waiter, so its body and its parsed JSON are shared.
+    const Waiters waiting = m_InFlightGets.take(key);
+    for (const auto &waiter : waiting) {
+        if (waiter.first && waiter.second) {
+            waiter.second(response);
+        }
+    }
+}
+
+NetworkTransport::Waiter NetworkTransport::abandonGet(const QString &key, QObject *context)
+{
+    auto it = m_InFlightGets.find(key);
+    if (it == m_InFlightGets.end()) {
+        return Waiter();
+    }
+
+    // The waiters whose context is already destroyed are dropped too, they would not be called anyway.
+    for (int index = it->size() - 1; index >= 0; index--) {
+        if (it->at(index).first.isNull() || it->at(index).first == context) {
+            it->remove(index);
+        }
+    }
+
+    for (int index = 0; index < it->size(); index++) {
+        if (qobject_cast<NetworkUtils *>(it->at(index).first.data()) != nullptr) {
+            const Waiter heir = it->at(index);
+            it->remove(index);
+            return heir;
+        }
+    }
+
+    // None of the waiters can send the request again.
+    finishGet(key, Response("", 0, QNetworkReply::OperationCanceledError));
+    return Waiter();
+}
+
+int NetworkTransport::deduplicatedGetCount() const
+{
+    return m_DeduplicatedGetCount;
+}
+
+bool NetworkTransport::http2Allowed(const QString &host) const
+{
+    return m_Http1Hosts.contains(host) == false;
+}
+
+void NetworkTransport::fallbackToHttp1(const QString &host)
+{
+    m_Http1Hosts.insert(host);
+    m_Http2FallbackCount++;
+}
+
+void NetworkTransport::countReply(bool http2Used)
+{
+    if (http2Used) {
+        m_Http2ReplyCount++;
+    }
+    else {
+        m_Http1ReplyCount++;
+    }
+}
+
+int NetworkTransport::http2ReplyCount() const
+{
+    return m_Http2ReplyCount;
+}
+
+int NetworkTransport::http1ReplyCount() const
+{
+    return m_Http1ReplyCount;
+}
+
+int NetworkTransport::http2FallbackCount() const
+{
+    return m_Http2FallbackCount;
+}
+
+QNetworkAccessManager *NetworkTransport::nextManager()
+{
+    if (m_NextManager >= m_PoolSize || m_NextManager >= m_Managers.size()) {
+        m_NextManager = 0;
+    }
+
+    QNetworkAccessManager *manager = m_Managers.at(m_NextManager);
+    m_NextManager++;
+    return manager;
+}
+
+void NetworkTransport::prepare(QNetworkRequest &request) const
+{
+#ifndef QT_NO_SSL
+    if (request.url().scheme() == "https") {
+        request.setSslConfiguration(m_SslConfiguration);
+    }
+#else
+    Q_UNUSED(request);
+#endif // QT_NO_SSL
+}
+
+void NetworkTransport::track(QNetworkReply *reply)
+{
+#ifndef QT_NO_SSL
+    connect(reply, &QNetworkReply::encrypted, this, [this, reply]() {
+        const QByteArray ticket = reply->sslConfiguration().sessionTicket();
+        if (ticket.isEmpty() == false && ticket != m_SslConfiguration.sessionTicket()) {
+            m_SslConfiguration.setSessionTicket(ticket);
+        }
+    });
+#else
+    Q_UNUSED(reply);
+#endif // QT_NO_SSL
+}
+
+void NetworkTransport::growPool()
+{
+    while (m_Managers.size() < m_PoolSize) {
+        m_Managers.append(new QNetworkAccessManager(this));
+    }
+}
+
+double NetworkTransport::currentRate(const TokenBucket &bucket, bool write) const
+{
+    return (write ? m_WriteRate : m_ReadRate) * bucket.factor;
+}
+
+void NetworkTransport::refill(TokenBucket &bucket, double rate, qint64 now) const
+{
+    // The bucket holds one second of requests.
+    const double capacity = qMax(1.0, rate);
+    if (bucket.tokens < 0) {
+        bucket.tokens = capacity;
+    }
+    else {
+        bucket.tokens = qMin(capacity, bucket.tokens + (now - bucket.updatedAt) * rate / 1000);
+    }
+
+    bucket.updatedAt = now;
+}
+
+void NetworkTransport::drain()
+{
+    const qint64 now = m_Clock.elapsed();
+    const qint64 readWait = drainBucket(m_ReadBucket, false, now);
+    const qint64 writeWait = drainBucket(m_WriteBucket, true, now);
+
+    qint64 wait = readWait;
+    if (wait < 0 || (writeWait >= 0 && writeWait < wait)) {
+        wait = writeWait;
+    }
+
+    if (wait >= 0 && (m_DrainTimer.isActive() == false || m_DrainTimer.remainingTime() > wait)) {
+        m_DrainTimer.start(static_cast<int>(wait));
+    }
+}
+
+qint64 NetworkTransport::drainBucket(TokenBucket &bucket, bool write, qint64 now)
+{
+    const double rate = currentRate(bucket, write);
+    if (rate > 0) {
+        refill(bucket, rate, now);
+    }
+
+    int lane = nextLane(bucket, now);
+    while (lane >= 0) {
+        QQueue<Job> &queue = bucket.lanes[lane];
+        if (queue.head().owner.isNull()) {
+            queue.dequeue();
+            lane = nextLane(bucket, now);
+            continue;
+        }
+
+        if (rate > 0 && bucket.tokens < 1) {
+            return static_cast<qint64>(qCeil((1 - bucket.tokens) * 1000 / rate));
+        }
+
+        if (rate > 0) {
+            bucket.tokens -= 1;
+        }
+
+        Job job = queue.dequeue();
+        LaneMetrics &metrics = m_LaneMetrics[job.priority];
+        metrics.totalQueueWaitTime += now - job.enqueuedAt;
+        metrics.dequeuedCount++;
+        job.start();
+
+        lane = nextLane(bucket, now);
+    }
+
+    return -1;
+}
+
+int NetworkTransport::nextLane(const TokenBucket &bucket, qint64 now) const
+{
+    int starvedLane = -1;
+    int firstLane = -1;
+    for (int lane = PriorityInteractive; lane < PriorityCount; lane++) {
+        if (bucket.lanes[lane].isEmpty()) {
+            continue;
+        }
+
+        if (firstLane < 0) {
+            firstLane = lane;
+        }
+
+        const qint64 enqueuedAt = bucket.lanes[lane].head().enqueuedAt;
+        if (now - enqueuedAt > m_StarvationThreshold && (starvedLane < 0 || enqueuedAt < bucket.lanes[starvedLane].head().enqueuedAt)) {
+            starvedLane = lane;
+        }
+    }
+
+    return starvedLane >= 0 ? starvedLane : firstLane;
+}
+
+}
@@ -1,11 +1,20 @@
 #include "QStripe/NetworkUtils.h"
+// std
+#include <limits>
 // Qt
 #include <QNetworkRequest>
 #include <QMimeDatabase>
 #include <QNetworkReply>
 #include <QHttpPart>
+#include <QDebug>
+#include <QTimer>
+#include <QDateTime>
 #include <QUrlQuery>
+#include <QUuid>
 #include <QFile>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QRandomGenerator>
+#endif
 // QStripe
 #include "QStripe/Utils.h"
 
@@ -16,20 +25,49 @@ unsigned int NetworkUtils::m_RequestCount = 0;
 
 NetworkUtils::NetworkUtils(QObject *parent)
     : QObject(parent)
+    , m_Transport(NetworkTransport::instance())
+    , m_PendingRequests()
+    , m_Headers()
+    , m_IsHttp2Enabled(false)
+    , m_IsHttp2Direct(false)
+    , m_MaxAttempts(0)
+    , m_RetryDeadline(0)
+    , m_Priority(NetworkTransport::PriorityNormal)
+    , m_ScheduledRetries()
+    , m_QueuedRequests()
 {
-    connect(&m_Network, &QNetworkAccessManager::finished, this, &NetworkUtils::onRequestFinished);
     setHeader("Content-Type", "application/x-www-form-urlencoded");
 }
 
 NetworkUtils::~NetworkUtils()
 {
+    // The replies are deleted with this instance. The callbacks must not be called after this point since their owners are being destroyed.
+    // The idempotency keys of the dropped requests are freed so that they can be sent again, and the dropped GET requests are handed over to their
+    // waiters.
+    for (const PendingRequest &pending : m_PendingRequests) {
+        abandonRequestKeys(pending);
+    }
+
+    for (const PendingRequest &pending : m_ScheduledRetries) {
+        abandonRequestKeys(pending);
+    }
+
+    for (const PendingRequest &pending : m_QueuedRequests) {
+        abandonRequestKeys(pending);
+    }
 
+    m_PendingRequests.clear();
+    m_ScheduledRetries.clear();
+    m_QueuedRequests.clear();
 }
 
 void NetworkUtils::sendGet(const QString &url, RequestCallback callback, const QVariantMap &queryParams)
 {
-    const int availableIndex = getAvailableIndex();
-    const unsigned int threadIndex = availableIndex == -1 ? m_Callbacks.size() : availableIndex;
+    sendGet(url, std::move(callback), queryParams, m_Priority);
+}
+
+void NetworkUtils::sendGet(const QString &url, RequestCallback callback, const QVariantMap &queryParams, NetworkTransport::Priority priority)
+{
     QUrl qurl = QUrl(url);
 
     if (queryParams.size() > 0) {
@@ -43,87 +81,65 @@ void NetworkUtils::sendGet(const QString &url, RequestCallback callback, const Q
 
     QNetworkRequest request(qurl);
     setHeaders(request);
-    QNetworkReply *reply = m_Network.get(request);
 
-    reply->setObjectName(QString::number(threadIndex));
-    insertCallback(threadIndex, std::move(callback));
+    QString deduplicationKey;
+    if (NetworkTransport::getDeduplicationEnabled()) {
+        deduplicationKey = NetworkTransport::getDeduplicationKey(request);
+        if (m_Transport->joinGet(deduplicationKey, this, callback)) {
+            return;
+        }
+    }
+
+    send(QNetworkAccessManager::GetOperation, request, QByteArray(), std::move(callback), priority, deduplicationKey);
 }
 
 void NetworkUtils::sendDelete(const QString &url, RequestCallback callback)
 {
-    const int availableIndex = getAvailableIndex();
-    const unsigned int threadIndex = availableIndex == -1 ? m_Callbacks.size() : availableIndex;
     const QUrl qurl = QUrl(url);
     QNetworkRequest request(qurl);
     setHeaders(request);
-    QNetworkReply *reply = m_Network.deleteResource(request);
+    send(QNetworkAccessManager::DeleteOperation, request, QByteArray(), std::move(callback), m_Priority);
+}
 
-    reply->setObjectName(QString::number(threadIndex));
-    insertCallback(threadIndex, std::move(callback));
+void NetworkUtils::sendPost(const QString &url, const QVariantMap &data, RequestCallback callback, const QString &idempotencyKey)
+{
+    sendPost(url, data, std::move(callback), idempotencyKey, m_Priority);
 }
 
-void NetworkUtils::sendPost(const QString &url, const QVariantMap &data, RequestCallback callback)
+void NetworkUtils::sendPost(const QString &url, const QVariantMap &data, RequestCallback callback, const QString &idempotencyKey,
+                            NetworkTransport::Priority priority)
 {
-    const int availableIndex = getAvailableIndex();
-    const unsigned int threadIndex = availableIndex == -1 ? m_Callbacks.size() : availableIndex;
+    // Only the keys given by the caller can be submitted twice, the generated ones are unique.
+    if (idempotencyKey.length() > 0 && m_Transport->joinIdempotent(idempotencyKey, this, callback)) {
+        qDebug() << "[INFO] A request with the idempotency key" << idempotencyKey << "is already sent. Using its response.";
+        return;
+    }
+
     const QUrl qurl = QUrl(url);
     QNetworkRequest request(qurl);
     setHeaders(request);
 
-    QUrlQuery query;
-    for (auto it = data.constBegin(); it != data.constEnd(); it++) {
-        QString value = "";
-        if (it.value().type() == QVariant::String) {
-            value = it.value().toString();
-        }
-        else if (it.value().type() == QVariant::Map) {
-            value = Utils::toJsonString(it.value().toMap());
-        }
-        else if (it.value().type() == QVariant::Int) {
-            value = QString::number(it.value().toInt());
-        }
-
-        query.addQueryItem(it.key(), it.value().toString());
-    }
-
-    const QByteArray postData = query.toString().toUtf8();
+    const QByteArray postData = Utils::toFormData(data);
     request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, postData.size());
-    QNetworkReply *reply = m_Network.post(request, postData);
+    request.setRawHeader("Idempotency-Key", (idempotencyKey.length() > 0 ? idempotencyKey : generateIdempotencyKey()).toUtf8());
+    send(QNetworkAccessManager::PostOperation, request, postData, std::move(callback), priority);
+}
 
-    reply->setObjectName(QString::number(threadIndex));
-    insertCallback(threadIndex, std::move(callback));
+QString NetworkUtils::generateIdempotencyKey()
+{
+    // Strip the braces.
+    return QUuid::createUuid().toString().mid(1, 36);
 }
 
 void NetworkUtils::sendPut(const QString &url, const QVariantMap &data, RequestCallback callback)
 {
-    const int availableIndex = getAvailableIndex();
-    const unsigned int threadIndex = availableIndex == -1 ? m_Callbacks.size() : availableIndex;
     const QUrl qurl = QUrl(url);
     QNetworkRequest request(qurl);
     setHeaders(request);
 
-    QUrlQuery query;
-    for (auto it = data.constBegin(); it != data.constEnd(); it++) {
-        QString value = "";
-        if (it.value().type() == QVariant::String) {
-            value = it.value().toString();
-        }
-        else if (it.value().type() == QVariant::Map) {
-            value = Utils::toJsonString(it.value().toMap());
-        }
-        else if (it.value().type() == QVariant::Int) {
-            value = QString::number(it.value().toInt());
-        }
-
-        query.addQueryItem(it.key(), it.value().toString());
-    }
-    const QByteArray putData = query.toString().toUtf8();
+    const QByteArray putData = Utils::toFormData(data);
     request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, putData.size());
-
-    QNetworkReply *reply = m_Network.put(request, putData);
-
-    reply->setObjectName(QString::number(threadIndex));
-    insertCallback(threadIndex, std::move(callback));
+    send(QNetworkAccessManager::PutOperation, request, putData, std::move(callback), m_Priority);
 }
 
 int NetworkUtils::getNextrequestID()
@@ -132,6 +148,61 @@ int NetworkUtils::getNextrequestID()
     return m_RequestCount;
 }
 
+bool NetworkUtils::http2Enabled() const
+{
+    return m_IsHttp2Enabled || NetworkTransport::http2Enabled();
+}
+
+void NetworkUtils::setHttp2Enabled(bool enabled)
+{
+    m_IsHttp2Enabled = enabled;
+}
+
+bool NetworkUtils::http2Direct() const
+{
+    return m_IsHttp2Direct;
+}
+
+void NetworkUtils::setHttp2Direct(bool direct)
+{
+    m_IsHttp2Direct = direct;
+}
+
+NetworkTransport::Priority NetworkUtils::priority() const
+{
+    return m_Priority;
+}
+
+void NetworkUtils::setPriority(NetworkTransport::Priority priority)
+{
+    m_Priority = priority;
+}
+
+int NetworkUtils::maxAttempts() const
+{
+    return m_MaxAttempts > 0 ? m_MaxAttempts : NetworkTransport::retryMaxAttempts();
+}
+
+void NetworkUtils::setMaxAttempts(int attempts)
+{
+    m_MaxAttempts = attempts > 0 ? attempts : 0;
+}
+
+int NetworkUtils::retryDeadline() const
+{
+    return m_RetryDeadline > 0 ? m_RetryDeadline : NetworkTransport::retryDeadline();
+}
+
+void NetworkUtils::setRetryDeadline(int msecs)
+{
+    m_RetryDeadline = msecs > 0 ? msecs : 0;
+}
+
+int NetworkUtils::pendingRequestCount() const
+{
+    return m_PendingRequests.size() + m_ScheduledRetries.size() + m_QueuedRequests.size();
+}
+
 void NetworkUtils::setHeader(const QString &headerName, const QString &headerValue)
 {
     m_Headers[headerName.toUtf8()] = headerValue.toUtf8();
@@ -142,45 +213,213 @@ void NetworkUtils::removeHeader(const QString &headerName)
     m_Headers.remove(headerName.toUtf8());
 }
 
-void NetworkUtils::onReceivedResponse(const Response &response, int threadIndex)
+void NetworkUtils::dispatch(PendingRequest &&pending)
+{
+    const unsigned int requestID = pending.requestID;
+    const bool write = pending.operation != QNetworkAccessManager::GetOperation;
+    const NetworkTransport::Priority priority = pending.priority;
+    m_QueuedRequests.insert(requestID, std::move(pending));
+    // The transport drops the job If this instance is destroyed while it is queued.
+    m_Transport->submit(this, write, priority, [this, requestID]() {
+        if (m_QueuedRequests.contains(requestID)) {
+            sendNow(m_QueuedRequests.take(requestID));
+        }
+    });
+}
+
+void NetworkUtils::sendNow(PendingRequest &&pending)
 {
-    if (threadIndex >= m_Callbacks.size()) {
+    QNetworkAccessManager *manager = m_Transport->nextManager();
+    QNetworkReply *reply = nullptr;
+
+    if (pending.operation == QNetworkAccessManager::GetOperation) {
+        reply = manager->get(pending.request);
+    }
+    else if (pending.operation == QNetworkAccessManager::DeleteOperation) {
+        reply = manager->deleteResource(pending.request);
+    }
+    else if (pending.operation == QNetworkAccessManager::PostOperation) {
+        reply = manager->post(pending.request, pending.body);
+    }
+    else if (pending.operation == QNetworkAccessManager::PutOperation) {
+        reply = manager->put(pending.request, pending.body);
+    }
+
+    if (reply == nullptr) {
+        qDebug() << "[ERROR] Unsupported network operation:" << pending.operation;
         return;
     }
 
-    RequestCallback &callback = m_Callbacks[threadIndex];
-    if (callback) {
-        callback(response);
+    reply->setParent(this);
+    m_Transport->track(reply);
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onRequestFinished(reply);
+    });
+
+    m_PendingRequests.insert(reply, std::move(pending));
+}
+
+void NetworkUtils::send(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &body, RequestCallback &&callback,
+                        NetworkTransport::Priority priority, const QString &deduplicationKey)
+{
+    PendingRequest pending(getNextrequestID(), operation, request, body, std::move(callback), parent());
+    pending.deduplicationKey = deduplicationKey;
+    pending.maxAttempts = maxAttempts();
+    pending.deadline = retryDeadline();
+    pending.priority = priority;
+    // Qt's connection queue is separate from the rate limiter queue, so it gets the priority too.
+    if (priority == NetworkTransport::PriorityInteractive) {
+        pending.request.setPriority(QNetworkRequest::HighPriority);
+    }
+    else if (priority == NetworkTransport::PriorityBulk) {
+        pending.request.setPriority(QNetworkRequest::LowPriority);
     }
 
-    m_Callbacks[threadIndex] = nullptr;
+    dispatch(std::move(pending));
 }
 
-int NetworkUtils::getAvailableIndex()
+bool NetworkUtils::shouldFallbackToHttp1(QNetworkReply *reply, const PendingRequest &pending) const
 {
-    auto foundIt = std::find_if(m_Callbacks.begin(), m_Callbacks.end(), [](std::function<void(const Response &)> cb) {
-        return cb == nullptr;
-    });
+    const bool http2Allowed = pending.request.attribute(QNetworkRequest::Http2AllowedAttribute).toBool();
+    if (http2Allowed == false || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+        return false;
+    }
+
+    // A connection reset is not a sign that the server does not support HTTP/2, so it is left to the retry policy.
+    const QNetworkReply::NetworkError error = reply->error();
+    return error == QNetworkReply::ProtocolFailure || error == QNetworkReply::ProtocolUnknownError;
+}
+
+int NetworkUtils::retryDelay(QNetworkReply *reply, const PendingRequest &pending) const
+{
+    if (pending.retryCount + 1 >= pending.maxAttempts) {
+        return -1;
+    }
+
+    const QVariant statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    const int status = statusCode.toInt();
+    const QNetworkReply::NetworkError error = reply->error();
+    const bool http2Failed = shouldFallbackToHttp1(reply, pending);
+    bool retryable = false;
+    // True If the request did not reach Stripe, so it is safe to send it again regardless of the operation.
+    bool notProcessed = false;
+    if (statusCode.isValid()) {
+        retryable = status == HTTP_429 || status == HTTP_500 || status == HTTP_502 || status == HTTP_503 || status == HTTP_504;
+        notProcessed = status == HTTP_429;
+    }
+    else {
+        retryable = error == QNetworkReply::ConnectionRefusedError ||
+                    error == QNetworkReply::RemoteHostClosedError ||
+                    error == QNetworkReply::HostNotFoundError ||
+                    error == QNetworkReply::TimeoutError ||
+                    error == QNetworkReply::TemporaryNetworkFailureError ||
+                    error == QNetworkReply::NetworkSessionFailedError ||
+                    error == QNetworkReply::UnknownNetworkError ||
+                    http2Failed;
+        notProcessed = error == QNetworkReply::ConnectionRefusedError || error == QNetworkReply::HostNotFoundError;
+    }
+
+    // Stripe tells whether a request can be retried with this header, it overrides the status code.
+    const QByteArray shouldRetry = reply->rawHeader("Stripe-Should-Retry");
+    if (shouldRetry == "false") {
+        return -1;
+    }
+    else if (shouldRetry == "true") {
+        retryable = true;
+    }
 
-    if (foundIt == m_Callbacks.end()) {
+    if (retryable == false) {
         return -1;
     }
 
-    return static_cast<int>(std::distance(m_Callbacks.begin(), foundIt));
+    const bool idempotent = pending.operation == QNetworkAccessManager::GetOperation ||
+                            pending.operation == QNetworkAccessManager::DeleteOperation ||
+                            pending.request.hasRawHeader("Idempotency-Key");
+    if (idempotent == false && notProcessed == false && shouldRetry != "true") {
+        return -1;
+    }
+
+    int delay = -1;
+    const QByteArray retryAfter = reply->rawHeader("Retry-After");
+    if (retryAfter.isEmpty() == false) {
+        bool ok = false;
+        const qint64 seconds = retryAfter.trimmed().toLongLong(&ok);
+        if (ok) {
+            // Clamped before the conversion to milliseconds so that a large value does not overflow. A delay past the deadline is not retried anyway.
+            const qint64 msecs = qMin<qint64>(seconds, std::numeric_limits<int>::max() / 1000) * 1000;
+            delay = static_cast<int>(qBound<qint64>(0, msecs, pending.deadline));
+        }
+        else {
+            const QDateTime date = QDateTime::fromString(QString::fromLatin1(retryAfter).trimmed(), Qt::RFC2822Date);
+            if (date.isValid()) {
+                delay = static_cast<int>(qBound<qint64>(0, QDateTime::currentDateTimeUtc().msecsTo(date), pending.deadline));
+            }
+        }
+    }
+
+    if (delay < 0 && http2Failed) {
+        // The request is sent again with HTTP/1.1, so there is no reason to wait.
+        delay = 0;
+    }
+    else if (delay < 0) {
+        // Full jitter: a random delay between 0 and the capped exponential backoff.
+        const qint64 backoff = qint64(NetworkTransport::retryBaseDelay()) << qMin(pending.retryCount, 20);
+        const int cap = static_cast<int>(qMin<qint64>(NetworkTransport::retryMaxDelay(), backoff));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        delay = QRandomGenerator::global()->bounded(cap + 1);
+#else
+        delay = qrand() % (cap + 1);
+#endif
+    }
+
+    if (pending.elapsed.elapsed() + delay > pending.deadline) {
+        return -1;
+    }
+
+    return delay;
+}
+
+void NetworkUtils::scheduleRetry(PendingRequest &&pending, int delay)
+{
+    const unsigned int requestID = pending.requestID;
+    m_ScheduledRetries.insert(requestID, std::move(pending));
+    // The timer is bound to this instance, so a retry does not outlive the object that sent it.
+    QTimer::singleShot(delay, this, [this, requestID]() {
+        if (m_ScheduledRetries.contains(requestID)) {
+            dispatch(m_ScheduledRetries.take(requestID));
+        }
+    });
 }
 
-void NetworkUtils::insertCallback(const int &threadIndex, RequestCallback &&callback)
+void NetworkUtils::abandonRequestKeys(const PendingRequest &pending)
 {
-    if (threadIndex < m_Callbacks.size()) {
-        m_Callbacks[threadIndex] = callback;
+    const QByteArray key = pending.request.rawHeader("Idempotency-Key");
+    if (key.isEmpty() == false) {
+        m_Transport->abandonIdempotent(QString::fromUtf8(key), this);
     }
-    else {
-        m_Callbacks.push_back(callback);
+
+    if (pending.deduplicationKey.isEmpty() == false) {
+        const NetworkTransport::Waiter heir = m_Transport->abandonGet(pending.deduplicationKey, this);
+        NetworkUtils *network = qobject_cast<NetworkUtils *>(heir.first.data());
+        if (network != nullptr) {
+            // One of the waiters sends the request again, and the rest of them get its response.
+            RequestCallback callback = heir.second;
+            network->send(QNetworkAccessManager::GetOperation, pending.request, QByteArray(), std::move(callback), pending.priority,
+                          pending.deduplicationKey);
+        }
     }
 }
 
 void NetworkUtils::setHeaders(QNetworkRequest &request)
 {
+    m_Transport->prepare(request);
+
+    const bool useHttp2 = http2Enabled() && m_Transport->http2Allowed(request.url().host());
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, useHttp2);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    request.setAttribute(QNetworkRequest::Http2DirectAttribute, useHttp2 && m_IsHttp2Direct);
+#endif
+
     for (auto it = m_Headers.constBegin(); it != m_Headers.constEnd(); it++) {
         request.setRawHeader(it.key(), it.value());
     }
@@ -188,14 +427,51 @@ void NetworkUtils::setHeaders(QNetworkRequest &request)
 
 void NetworkUtils::onRequestFinished(QNetworkReply *reply)
 {
-    const Response response(reply->readAll(), reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), reply->error());
-    bool intConversionOk = false;
-    int callbackIndex = reply->objectName().toInt(&intConversionOk);
-    if (intConversionOk == false) {
-        callbackIndex = -1;
+    reply->deleteLater();
+    PendingRequest pending = m_PendingRequests.take(reply);
+    const QVariant statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    const bool http2Used = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+    if (statusCode.isValid()) {
+        m_Transport->countReply(http2Used);
+        m_Transport->reportResponse(pending.operation != QNetworkAccessManager::GetOperation, statusCode.toInt());
+    }
+
+    // The resend after a failed HTTP/2 negotiation goes through the retry policy, so it counts as an attempt and is only done If it is safe.
+    const int delay = retryDelay(reply, pending);
+    if (shouldFallbackToHttp1(reply, pending)) {
+        qDebug() << "[WARNING] HTTP/2 request failed with" << reply->error() << "Switching" << pending.request.url().host() << "to HTTP/1.1.";
+        m_Transport->fallbackToHttp1(pending.request.url().host());
+        pending.request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+        pending.request.setAttribute(QNetworkRequest::Http2DirectAttribute, false);
+#endif
     }
 
-    onReceivedResponse(response, callbackIndex);
+    if (delay >= 0) {
+        qDebug() << "[WARNING] Request failed with status" << statusCode.toInt() << "and error"
+                 << reply->error() << "Retrying in" << delay << "ms.";
+        pending.retryCount++;
+        m_Transport->countRetry();
+        scheduleRetry(std::move(pending), delay);
+        return;
+    }
+
+    m_Transport->reportLatency(pending.priority, pending.elapsed.elapsed());
+    const Response response(reply->readAll(), statusCode.toInt(), reply->error(), http2Used);
+    const QByteArray idempotencyKey = pending.request.rawHeader("Idempotency-Key");
+    if (idempotencyKey.isEmpty() == false) {
+        m_Transport->finishIdempotent(QString::fromUtf8(idempotencyKey), response);
+    }
+
+    // The callback may destroy this instance, so the transport is kept alive for the waiters of the identical GET requests.
+    const QSharedPointer<NetworkTransport> transport = m_Transport;
+    if (pending.callback) {
+        pending.callback(response);
+    }
+
+    if (pending.deduplicationKey.isEmpty() == false) {
+        transport->finishGet(pending.deduplicationKey, response);
+    }
 }
 
 }
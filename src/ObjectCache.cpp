@@ -0,0 +1,205 @@
+#include "QStripe/ObjectCache.h"
+// Qt
+#include <QStringList>
+
+namespace QStripe
+{
+
+bool ObjectCache::m_IsEnabled = false;
+int ObjectCache::m_TimeToLive = 60000;
+int ObjectCache::m_MaxEntries = 1000;
+int ObjectCache::m_MaxBytes = 0;
+int ObjectCache::m_TotalBytes = 0;
+int ObjectCache::m_HitCount = 0;
+int ObjectCache::m_MissCount = 0;
+int ObjectCache::m_EvictionCount = 0;
+QHash<QString, ObjectCache::Entry> ObjectCache::m_Entries;
+std::list<QString> ObjectCache::m_Order;
+QElapsedTimer ObjectCache::m_Clock;
+
+ObjectCache::ObjectCache()
+{
+
+}
+
+bool ObjectCache::enabled()
+{
+    return m_IsEnabled;
+}
+
+void ObjectCache::setEnabled(bool enabled)
+{
+    const bool changed = m_IsEnabled != enabled;
+    if (changed) {
+        m_IsEnabled = enabled;
+        clear();
+    }
+}
+
+int ObjectCache::timeToLive()
+{
+    return m_TimeToLive;
+}
+
+void ObjectCache::setTimeToLive(int msecs)
+{
+    if (msecs > 0) {
+        m_TimeToLive = msecs;
+    }
+}
+
+int ObjectCache::maxEntries()
+{
+    return m_MaxEntries;
+}
+
+void ObjectCache::setMaxEntries(int count)
+{
+    const bool changed = m_MaxEntries != count && count > 0;
+    if (changed) {
+        m_MaxEntries = count;
+        evict();
+    }
+}
+
+int ObjectCache::maxBytes()
+{
+    return m_MaxBytes;
+}
+
+void ObjectCache::setMaxBytes(int bytes)
+{
+    const bool changed = m_MaxBytes != bytes && bytes >= 0;
+    if (changed) {
+        m_MaxBytes = bytes;
+        evict();
+    }
+}
+
+bool ObjectCache::find(const QString &key, QJsonObject &data)
+{
+    if (m_IsEnabled == false) {
+        return false;
+    }
+
+    auto it = m_Entries.find(key);
+    if (it == m_Entries.end()) {
+        m_MissCount++;
+        return false;
+    }
+
+    if (it->expiresAt <= now()) {
+        remove(key);
+        m_MissCount++;
+        return false;
+    }
+
+    m_Order.splice(m_Order.begin(), m_Order, it->position);
+    data = it->data;
+    m_HitCount++;
+    return true;
+}
+
+void ObjectCache::insert(const QString &key, const QJsonObject &data, int byteSize, const QString &parentKey)
+{
+    if (m_IsEnabled == false || key.length() == 0) {
+        return;
+    }
+
+    remove(key);
+
+    m_Order.push_front(key);
+    Entry entry;
+    entry.data = data;
+    entry.byteSize = byteSize;
+    entry.expiresAt = now() + m_TimeToLive;
+    entry.parentKey = parentKey;
+    entry.position = m_Order.begin();
+
+    m_Entries.insert(key, entry);
+    m_TotalBytes += byteSize;
+    evict();
+}
+
+void ObjectCache::remove(const QString &key)
+{
+    auto it = m_Entries.find(key);
+    if (it != m_Entries.end()) {
+        m_TotalBytes -= it->byteSize;
+        m_Order.erase(it->position);
+        m_Entries.erase(it);
+    }
+}
+
+void ObjectCache::removeWithChildren(const QString &key)
+{
+    remove(key);
+
+    QStringList children;
+    for (auto it = m_Entries.constBegin(); it != m_Entries.constEnd(); it++) {
+        if (it->parentKey == key) {
+            children.append(it.key());
+        }
+    }
+
+    for (const QString &child : children) {
+        remove(child);
+    }
+}
+
+void ObjectCache::clear()
+{
+    m_Entries.clear();
+    m_Order.clear();
+    m_TotalBytes = 0;
+}
+
+int ObjectCache::count()
+{
+    return m_Entries.size();
+}
+
+int ObjectCache::hitCount()
+{
+    return m_HitCount;
+}
+
+int ObjectCache::missCount()
+{
+    return m_MissCount;
+}
+
+int ObjectCache::evictionCount()
+{
+    return m_EvictionCount;
+}
+
+QString ObjectCache::customerKey(const QString &customerID)
+{
+    return "customer:" + customerID;
+}
+
+QString ObjectCache::cardKey(const QString &customerID, const QString &cardID)
+{
+    return "card:" + customerID + "/" + cardID;
+}
+
+qint64 ObjectCache::now()
+{
+    if (m_Clock.isValid() == false) {
+        m_Clock.start();
+    }
+
+    return m_Clock.elapsed();
+}
+
+void ObjectCache::evict()
+{
+    while (m_Order.empty() == false && (m_Entries.size() > m_MaxEntries || (m_MaxBytes > 0 && m_TotalBytes > m_MaxBytes))) {
+        const QString key = m_Order.back();
+        remove(key);
+        m_EvictionCount++;
+    }
+}
+
+}
@@ -9,6 +9,7 @@
 #include "QStripe/Stripe.h"
 #include "QStripe/Address.h"
 #include "QStripe/Customer.h"
+#include "QStripe/ListIterator.h"
 #include "QStripe/PaymentSource.h"
 #include "QStripe/ShippingInformation.h"
 
@@ -27,6 +28,7 @@ void QStripePlugin::registerQStripe(const char *uri)
     qmlRegisterType<QStripe::Customer>(uri, QSTRIPE_VER_MAJOR, QSTRIPE_VER_MINOR, "Customer");
 
     qmlRegisterType<QStripe::Error>(uri, QSTRIPE_VER_MAJOR, QSTRIPE_VER_MINOR, "Error");
+    qmlRegisterType<QStripe::ListIterator>(uri, QSTRIPE_VER_MAJOR, QSTRIPE_VER_MINOR, "ListIterator");
     qmlRegisterType<QStripe::PaymentSource>(uri, QSTRIPE_VER_MAJOR, QSTRIPE_VER_MINOR, "PaymentSource");
     qmlRegisterType<QStripe::ShippingInformation>(uri, QSTRIPE_VER_MAJOR, QSTRIPE_VER_MINOR, "ShippingInformation");
 
@@ -1,5 +1,6 @@
 #include "QStripe/ShippingInformation.h"
 // QStripe
+#include "QStripe/ModelData.h"
 #include "QStripe/Utils.h"
 
 namespace QStripe
@@ -62,12 +63,7 @@ void ShippingInformation::setAddress(Address *addr)
 
 QVariantMap ShippingInformation::json() const
 {
-    QVariantMap data;
-    data[FIELD_ADDRESS] = m_Address.json();
-    data[FIELD_NAME] = name();
-    data[FIELD_PHONE] = phone();
-
-    return data;
+    return ShippingInformationData::schema().variantMap(data());
 }
 
 QString ShippingInformation::jsonString() const
@@ -119,6 +115,29 @@ ShippingInformation *ShippingInformation::fromJson(const QVariantMap &data)
     return shipping;
 }
 
+ShippingInformation *ShippingInformation::fromJson(const QJsonObject &object)
+{
+    ShippingInformation *shipping = new ShippingInformation();
+    shipping->setData(ShippingInformationData::fromJson(object));
+    return shipping;
+}
+
+ShippingInformationData ShippingInformation::data() const
+{
+    ShippingInformationData data;
+    data.name = m_Name;
+    data.phone = m_Phone;
+    data.address = m_Address.data();
+    return data;
+}
+
+void ShippingInformation::setData(const ShippingInformationData &data)
+{
+    setName(data.name);
+    setPhone(data.phone);
+    m_Address.setData(data.address);
+}
+
 ShippingInformation *ShippingInformation::fromString(const QString &dataStr)
 {
     return fromJson(Utils::toVariantMap(dataStr));
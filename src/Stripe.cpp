@@ -1,7 +1,9 @@
 #include "QStripe/Stripe.h"
+// Qt
+#include <QTimer>
 // QStripe
+#include "QStripe/ObjectCache.h"
 #include "QStripe/Customer.h"
-#include "QStripe/Utils.h"
 
 namespace QStripe
 {
@@ -9,11 +11,14 @@ namespace QStripe
 QString Stripe::m_PublishableKey = "";
 QString Stripe::m_SecretKey = "";
 QString Stripe::m_APIVersion = "";
+QString Stripe::m_APIBaseUrl = "https://api.stripe.com/v1";
 
 Stripe::Stripe(QObject *parent)
     : QObject(parent)
-    , m_NetworkUtils()
+    , m_NetworkUtils(this)
     , m_Error()
+    , m_MaxConcurrentRequests(6)
+    , m_CustomerBatch()
 {
 
 }
@@ -41,6 +46,8 @@ void Stripe::setSecretKey(const QString &key)
     const bool changed = key != m_SecretKey;
     if (changed) {
         m_SecretKey = key;
+        // The cached objects belong to the previous account.
+        ObjectCache::clear();
     }
 }
 
@@ -57,6 +64,174 @@ void Stripe::setApiVersion(const QString &version)
     }
 }
 
+QString Stripe::apiBaseUrl()
+{
+    return m_APIBaseUrl;
+}
+
+void Stripe::setApiBaseUrl(const QString &url)
+{
+    const bool changed = url != m_APIBaseUrl;
+    if (changed) {
+        m_APIBaseUrl = url;
+        ObjectCache::clear();
+    }
+}
+
+bool Stripe::http2Enabled()
+{
+    return NetworkTransport::http2Enabled();
+}
+
+void Stripe::setHttp2Enabled(bool enabled)
+{
+    NetworkTransport::setHttp2Enabled(enabled);
+}
+
+int Stripe::http2ReplyCount() const
+{
+    return NetworkTransport::instance()->http2ReplyCount();
+}
+
+int Stripe::http1ReplyCount() const
+{
+    return NetworkTransport::instance()->http1ReplyCount();
+}
+
+int Stripe::maxRetryAttempts()
+{
+    return NetworkTransport::retryMaxAttempts();
+}
+
+void Stripe::setMaxRetryAttempts(int attempts)
+{
+    NetworkTransport::setRetryMaxAttempts(attempts);
+}
+
+int Stripe::retryDeadline()
+{
+    return NetworkTransport::retryDeadline();
+}
+
+void Stripe::setRetryDeadline(int msecs)
+{
+    NetworkTransport::setRetryDeadline(msecs);
+}
+
+int Stripe::retryCount() const
+{
+    return NetworkTransport::instance()->retryCount();
+}
+
+double Stripe::readRateLimit()
+{
+    return NetworkTransport::readRate();
+}
+
+void Stripe::setReadRateLimit(double requestsPerSecond)
+{
+    NetworkTransport::setReadRate(requestsPerSecond);
+}
+
+double Stripe::writeRateLimit()
+{
+    return NetworkTransport::writeRate();
+}
+
+void Stripe::setWriteRateLimit(double requestsPerSecond)
+{
+    NetworkTransport::setWriteRate(requestsPerSecond);
+}
+
+int Stripe::queuedRequestCount() const
+{
+    return NetworkTransport::instance()->queuedRequestCount();
+}
+
+int Stripe::queueWaitTime() const
+{
+    return NetworkTransport::instance()->queueWaitTime();
+}
+
+int Stripe::averageLatency(int priority) const
+{
+    if (priority < NetworkTransport::PriorityInteractive || priority >= NetworkTransport::PriorityCount) {
+        return 0;
+    }
+
+    return NetworkTransport::instance()->averageLatency(static_cast<NetworkTransport::Priority>(priority));
+}
+
+int Stripe::connectionPoolSize()
+{
+    return NetworkTransport::poolSize();
+}
+
+void Stripe::setConnectionPoolSize(int size)
+{
+    NetworkTransport::setPoolSize(size);
+}
+
+bool Stripe::cacheEnabled()
+{
+    return ObjectCache::enabled();
+}
+
+void Stripe::setCacheEnabled(bool enabled)
+{
+    ObjectCache::setEnabled(enabled);
+}
+
+int Stripe::cacheTimeToLive()
+{
+    return ObjectCache::timeToLive();
+}
+
+void Stripe::setCacheTimeToLive(int msecs)
+{
+    ObjectCache::setTimeToLive(msecs);
+}
+
+int Stripe::cacheMaxEntries()
+{
+    return ObjectCache::maxEntries();
+}
+
+void Stripe::setCacheMaxEntries(int count)
+{
+    ObjectCache::setMaxEntries(count);
+}
+
+int Stripe::cacheMaxBytes()
+{
+    return ObjectCache::maxBytes();
+}
+
+void Stripe::setCacheMaxBytes(int bytes)
+{
+    ObjectCache::setMaxBytes(bytes);
+}
+
+int Stripe::cacheHitCount() const
+{
+    return ObjectCache::hitCount();
+}
+
+int Stripe::cacheMissCount() const
+{
+    return ObjectCache::missCount();
+}
+
+int Stripe::cacheEvictionCount() const
+{
+    return ObjectCache::evictionCount();
+}
+
+void Stripe::clearCache()
+{
+    ObjectCache::clear();
+}
+
 QQmlListProperty<Customer> Stripe::customers()
 {
     return QQmlListProperty<Customer>(this, this, &Stripe::appendCustomer, &Stripe::customerCount, &Stripe::customer, &Stripe::clearCustomers);
@@ -93,14 +268,26 @@ bool Stripe::fetchCustomer(const QString &customerID)
         return false;
     }
 
+    QJsonObject cached;
+    if (ObjectCache::find(ObjectCache::customerKey(customerID), cached)) {
+        // The signal is still emitted asynchronously, the same as a network reply.
+        QTimer::singleShot(0, this, [this, cached]() {
+            Customer *customer = Customer::fromJson(cached);
+            customer->setParent(this);
+            emit customerFetched(customer);
+        });
+        return true;
+    }
+
     m_NetworkUtils.setHeader("Authorization", "Bearer " + Stripe::secretKey());
     if (Stripe::apiVersion().length() > 0) {
         m_NetworkUtils.setHeader("Stripe-Version", Stripe::apiVersion());
     }
 
-    auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+    auto callback = [this, customerID](const Response & response) {
+        const QJsonObject data = response.json();
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
+            ObjectCache::insert(ObjectCache::customerKey(customerID), data, response.body.size());
             Customer *customer = Customer::fromJson(data);
             customer->setParent(this);
             emit customerFetched(customer);
@@ -116,6 +303,55 @@ bool Stripe::fetchCustomer(const QString &customerID)
     return true;
 }
 
+int Stripe::maxConcurrentRequests() const
+{
+    return m_MaxConcurrentRequests;
+}
+
+void Stripe::setMaxConcurrentRequests(int count)
+{
+    const bool changed = count != m_MaxConcurrentRequests && count > 0;
+    if (changed) {
+        m_MaxConcurrentRequests = count;
+        fetchNextCustomers();
+    }
+}
+
+bool Stripe::fetchCustomers(const QStringList &customerIDs)
+{
+    if (m_SecretKey.length() == 0) {
+        qDebug() << "[ERROR] secretKey is not set in the Stripe instance. Cannot send the request.";
+        return false;
+    }
+
+    if (fetchingCustomers()) {
+        qDebug() << "[ERROR] A customer batch is already being fetched.";
+        return false;
+    }
+
+    QStringList ids = customerIDs;
+    ids.removeAll(QString(""));
+    ids.removeDuplicates();
+    if (ids.size() == 0) {
+        return false;
+    }
+
+    m_NetworkUtils.setHeader("Authorization", "Bearer " + Stripe::secretKey());
+    if (Stripe::apiVersion().length() > 0) {
+        m_NetworkUtils.setHeader("Stripe-Version", Stripe::apiVersion());
+    }
+
+    m_CustomerBatch = CustomerBatch();
+    m_CustomerBatch.customerIDs = ids;
+    fetchNextCustomers();
+    return true;
+}
+
+bool Stripe::fetchingCustomers() const
+{
+    return m_CustomerBatch.customerIDs.size() > 0;
+}
+
 bool Stripe::fetchCard(const QString &customerID, const QString &cardID)
 {
     if (m_SecretKey.length() == 0) {
@@ -131,14 +367,25 @@ bool Stripe::fetchCard(const QString &customerID, const QString &cardID)
         return false;
     }
 
+    QJsonObject cached;
+    if (ObjectCache::find(ObjectCache::cardKey(customerID, cardID), cached)) {
+        QTimer::singleShot(0, this, [this, cached]() {
+            Card *card = Card::fromJson(cached);
+            card->setParent(this);
+            emit cardFetched(card);
+        });
+        return true;
+    }
+
     m_NetworkUtils.setHeader("Authorization", "Bearer " + Stripe::secretKey());
     if (Stripe::apiVersion().length() > 0) {
         m_NetworkUtils.setHeader("Stripe-Version", Stripe::apiVersion());
     }
 
-    auto callback = [this](const Response & response) {
-        QVariantMap data = Utils::toVariantMap(response.data);
+    auto callback = [this, customerID, cardID](const Response & response) {
+        const QJsonObject data = response.json();
         if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
+            ObjectCache::insert(ObjectCache::cardKey(customerID, cardID), data, response.body.size(), ObjectCache::customerKey(customerID));
             Card *card = Card::fromJson(data);
             card->setParent(this);
             emit cardFetched(card);
@@ -159,6 +406,66 @@ const Error *Stripe::lastError() const
     return &m_Error;
 }
 
+void Stripe::fetchNextCustomers()
+{
+    while (m_CustomerBatch.inFlightCount < m_MaxConcurrentRequests && m_CustomerBatch.nextIndex < m_CustomerBatch.customerIDs.size()) {
+        const QString customerID = m_CustomerBatch.customerIDs.at(m_CustomerBatch.nextIndex);
+        m_CustomerBatch.nextIndex++;
+        m_CustomerBatch.inFlightCount++;
+
+        QJsonObject cached;
+        if (ObjectCache::find(ObjectCache::customerKey(customerID), cached)) {
+            // Keep the cached results asynchronous so that the progress is reported the same way for all of the customers.
+            QTimer::singleShot(0, this, [this, customerID, cached]() {
+                onBatchCustomerFetched(customerID, cached, NetworkUtils::HttpStatusCodes::HTTP_200, QNetworkReply::NoError);
+            });
+            continue;
+        }
+
+        auto callback = [this, customerID](const Response & response) {
+            const QJsonObject data = response.json();
+            if (response.httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
+                ObjectCache::insert(ObjectCache::customerKey(customerID), data, response.body.size());
+            }
+
+            onBatchCustomerFetched(customerID, data, response.httpStatus, response.networkError);
+        };
+
+        m_NetworkUtils.sendGet(Customer::getURL(customerID), callback, QVariantMap(), NetworkTransport::PriorityBulk);
+    }
+}
+
+void Stripe::onBatchCustomerFetched(const QString &customerID, const QJsonObject &data, unsigned int httpStatus,
+                                    QNetworkReply::NetworkError networkError)
+{
+    m_CustomerBatch.inFlightCount--;
+    m_CustomerBatch.finishedCount++;
+
+    if (httpStatus == NetworkUtils::HttpStatusCodes::HTTP_200) {
+        Customer *customer = Customer::fromJson(data);
+        customer->setParent(this);
+        m_CustomerBatch.customers.append(QVariant::fromValue(customer));
+    }
+    else {
+        Error *error = new Error(this);
+        error->set(data, httpStatus, networkError);
+        m_CustomerBatch.errors[customerID] = QVariant::fromValue(error);
+    }
+
+    const int totalCount = m_CustomerBatch.customerIDs.size();
+    emit customersFetchProgress(m_CustomerBatch.finishedCount, totalCount);
+
+    if (m_CustomerBatch.finishedCount == totalCount) {
+        const CustomerBatch batch = m_CustomerBatch;
+        // Reset the batch before emitting so that a new batch can be started from the slots.
+        m_CustomerBatch = CustomerBatch();
+        emit customersFetched(batch.customers, batch.errors);
+    }
+    else {
+        fetchNextCustomers();
+    }
+}
+
 void Stripe::updateVersionHeader()
 {
     m_NetworkUtils.setHeader("Stripe-Version", m_APIVersion);
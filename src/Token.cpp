@@ -1,10 +1,21 @@
 #include "QStripe/Token.h"
 // QStripe
+#include "QStripe/EnumTable.h"
+#include "QStripe/ModelData.h"
+#include "QStripe/Stripe.h"
 #include "QStripe/Utils.h"
 
 namespace QStripe
 {
 
+static constexpr EnumName<Token::Type> TOKEN_TYPES[] = {
+    {Token::TypeBankAccount, "bank_account"},
+    {Token::TypeCard, "card"},
+    {Token::TypePII, "pii"},
+    {Token::TypeAccount, "account"},
+    {Token::TypeUnknown, "unknown"}
+};
+
 const QString Token::FIELD_BANK_ACCOUNT = "bank_account";
 const QString Token::FIELD_CREATED = "created";
 
@@ -71,42 +82,12 @@ void Token::clear()
 
 QString Token::typeName(Type type)
 {
-    QString name = "unknown";
-
-    if (type == Type::TypeBankAccount) {
-        name = "bank_account";
-    }
-    else if (type == Type::TypeCard) {
-        name = "card";
-    }
-    else if (type == Type::TypePII) {
-        name = "pii";
-    }
-    else if (type == Type::TypeAccount) {
-        name = "account";
-    }
-
-    return name;
+    return EnumTable::name(TOKEN_TYPES, type, QLatin1String("unknown"));
 }
 
 Token::Type Token::typeEnum(const QString &name)
 {
-    Type type = Type::TypeUnknown;
-
-    if (name == "bank_account") {
-        type = Type::TypeBankAccount;
-    }
-    else if (name == "card") {
-        type = Type::TypeCard;
-    }
-    else if (name == "pii") {
-        type = Type::TypePII;
-    }
-    else if (name == "account") {
-        type = Type::TypeAccount;
-    }
-
-    return type;
+    return EnumTable::value(TOKEN_TYPES, name, Type::TypeUnknown);
 }
 
 Token *Token::fromJson(const QVariantMap &data)
@@ -140,30 +121,77 @@ Token *Token::fromJson(const QVariantMap &data)
     return token;
 }
 
-Token *Token::fromString(const QString &data)
+Token *Token::fromJson(const QJsonObject &object)
 {
-    return fromJson(Utils::toVariantMap(data));
+    return fromData(TokenData::fromJson(object));
 }
 
-QString Token::getURL(const QString &tokenID)
+Token *Token::fromData(const TokenData &data)
 {
-    return "https://api.stripe.com/v1/tokens" + (tokenID.length() > 0 ? "/" + tokenID : "");
+    Token *token = new Token();
+    token->m_BankAccount = data.bankAccount;
+    token->m_Created = data.created;
+    token->m_TokenID = data.tokenID;
+
+    token->m_IsLiveMode = data.liveMode;
+    token->m_Type = data.type;
+    token->m_IsUsed = data.used;
+
+    return token;
 }
 
-QVariantMap Token::json() const
+TokenData Token::data() const
 {
-    QVariantMap data;
+    TokenData data;
+    data.bankAccount = m_BankAccount;
+    data.created = m_Created;
+    data.tokenID = m_TokenID;
 
-    data[FIELD_BANK_ACCOUNT] = m_BankAccount;
-    data[FIELD_CREATED] = m_Created.toSecsSinceEpoch();
+    data.liveMode = m_IsLiveMode;
+    data.type = m_Type;
+    data.used = m_IsUsed;
 
-    data[FIELD_ID] = m_TokenID;
-    data[FIELD_LIVEMODE] = m_IsLiveMode;
-    data[FIELD_TYPE] = typeName(m_Type);
+    return data;
+}
 
-    data[FIELD_USED] = m_IsUsed;
+void Token::applyJson(const QJsonObject &object)
+{
+    for (auto it = object.constBegin(); it != object.constEnd(); it++) {
+        const QString &key = it.key();
+        if (key == FIELD_BANK_ACCOUNT) {
+            m_BankAccount = it.value().toObject().toVariantMap();
+        }
+        else if (key == FIELD_CREATED) {
+            m_Created = QDateTime::fromSecsSinceEpoch(it.value().toInt());
+        }
+        else if (key == FIELD_ID) {
+            m_TokenID = it.value().toString();
+        }
+        else if (key == FIELD_LIVEMODE) {
+            m_IsLiveMode = it.value().toBool();
+        }
+        else if (key == FIELD_TYPE) {
+            m_Type = typeEnum(it.value().toString());
+        }
+        else if (key == FIELD_USED) {
+            m_IsUsed = it.value().toBool();
+        }
+    }
+}
 
-    return data;
+Token *Token::fromString(const QString &data)
+{
+    return fromJson(Utils::toVariantMap(data));
+}
+
+QString Token::getURL(const QString &tokenID)
+{
+    return Stripe::apiBaseUrl() + "/tokens" + (tokenID.length() > 0 ? "/" + tokenID : "");
+}
+
+QVariantMap Token::json() const
+{
+    return TokenData::schema().variantMap(data());
 }
 
 QString Token::jsonString() const
@@ -1,7 +1,6 @@
 #include "QStripe/Utils.h"
 // Qt
 #include <QJsonDocument>
-#include <QJsonObject>
 
 namespace QStripe
 {
@@ -21,13 +20,112 @@ QString Utils::toJsonString(const QVariantMap &data)
 
 QVariantMap Utils::toVariantMap(const QString &data)
 {
-    QVariantMap map;
-    const QJsonDocument doc = QJsonDocument::fromJson(data.toUtf8());
+    return toVariantMap(data.toUtf8());
+}
+
+QVariantMap Utils::toVariantMap(const QByteArray &data)
+{
+    return toJsonObject(data).toVariantMap();
+}
+
+QJsonObject Utils::toJsonObject(const QByteArray &data)
+{
+    QJsonObject object;
+    const QJsonDocument doc = QJsonDocument::fromJson(data);
     if (doc.isNull() == false) {
-        map = doc.object().toVariantMap();
+        object = doc.object();
     }
 
-    return map;
+    return object;
+}
+
+QVariantMap Utils::changedEntries(const QVariantMap &current, const QVariantMap &previous)
+{
+    QVariantMap changes;
+    for (auto it = current.constBegin(); it != current.constEnd(); it++) {
+        auto previousIt = previous.constFind(it.key());
+        if (previousIt == previous.constEnd() || previousIt.value() != it.value()) {
+            changes.insert(it.key(), it.value());
+        }
+    }
+
+    for (auto it = previous.constBegin(); it != previous.constEnd(); it++) {
+        if (current.contains(it.key()) == false) {
+            changes.insert(it.key(), QString(""));
+        }
+    }
+
+    return changes;
+}
+
+QByteArray Utils::toFormData(const QVariantMap &data)
+{
+    QByteArray body;
+    // Most of the fields are short, so this is usually enough to encode the body without reallocating.
+    body.reserve(data.size() * 48);
+    for (auto it = data.constBegin(); it != data.constEnd(); it++) {
+        QByteArray key;
+        appendFormEncoded(key, it.key().toUtf8(), true);
+        appendFormField(body, key, it.value());
+    }
+
+    return body;
+}
+
+void Utils::appendFormField(QByteArray &body, const QByteArray &key, const QVariant &value)
+{
+    if (value.type() == QVariant::Map) {
+        const QVariantMap map = value.toMap();
+        for (auto it = map.constBegin(); it != map.constEnd(); it++) {
+            QByteArray nestedKey = key;
+            nestedKey.append('[');
+            appendFormEncoded(nestedKey, it.key().toUtf8(), true);
+            nestedKey.append(']');
+            appendFormField(body, nestedKey, it.value());
+        }
+    }
+    else if (value.type() == QVariant::List || value.type() == QVariant::StringList) {
+        const QVariantList list = value.toList();
+        for (int index = 0; index < list.size(); index++) {
+            const QVariant &item = list.at(index);
+            if (item.type() == QVariant::Map) {
+                appendFormField(body, key + "[" + QByteArray::number(index) + "]", item);
+            }
+            else {
+                appendFormField(body, key + "[]", item);
+            }
+        }
+    }
+    else {
+        if (body.isEmpty() == false) {
+            body.append('&');
+        }
+
+        body.append(key);
+        body.append('=');
+        appendFormEncoded(body, value.toString().toUtf8(), false);
+    }
+}
+
+void Utils::appendFormEncoded(QByteArray &body, const QByteArray &data, bool isKey)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    for (const char character : data) {
+        const uchar byte = static_cast<uchar>(character);
+        const bool isUnreserved = (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || (byte >= '0' && byte <= '9') ||
+                                  byte == '-' || byte == '_' || byte == '.' || byte == '~';
+        if (isUnreserved || (isKey && (byte == '[' || byte == ']'))) {
+            body.append(character);
+        }
+        else if (byte == ' ') {
+            body.append('+');
+        }
+        else {
+            body.append('%');
+            body.append(hexDigits[byte >> 4]);
+            body.append(hexDigits[byte & 0x0F]);
+        }
+    }
 }
 
 }
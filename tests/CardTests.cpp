@@ -3,6 +3,8 @@
 #include <QSignalSpy>
 #include <QDate>
 // QStripe
+#include "QStripe/CardValidator.h"
+#include "QStripe/ModelData.h"
 #include "QStripe/Card.h"
 #include "QStripe/Utils.h"
 #include "QStripe/Token.h"
@@ -159,6 +161,84 @@ void CardTests::testFromJson()
     addr->deleteLater();
 }
 
+void CardTests::testFromJsonObject()
+{
+    const QVariantMap data = getCardData();
+    const QJsonObject object = Utils::toJsonObject(Utils::toJsonString(data).toUtf8());
+
+    Card *expected = Card::fromJson(data);
+    Card *card = Card::fromJson(object);
+    QCOMPARE(card->json(), expected->json());
+    QCOMPARE(card->address()->json(), expected->address()->json());
+
+    expected->deleteLater();
+    card->deleteLater();
+}
+
+void CardTests::testData()
+{
+    const QVariantMap data = getCardData();
+    const QJsonObject object = Utils::toJsonObject(Utils::toJsonString(data).toUtf8());
+
+    const CardData cardData = CardData::fromJson(object);
+    QCOMPARE(cardData.cardID, data[Card::FIELD_ID].toString());
+    QCOMPARE(Card::cardBrandName(cardData.brand), data[Card::FIELD_BRAND].toString());
+    QCOMPARE(cardData.expirationYear, data[Card::FIELD_EXP_YEAR].toInt());
+
+    Card *expected = Card::fromJson(data);
+    Card *card = Card::fromData(cardData);
+    QCOMPARE(card->json(), expected->json());
+    QCOMPARE(card->address()->json(), expected->address()->json());
+    QCOMPARE(card->data().json(), cardData.json());
+
+    expected->deleteLater();
+    card->deleteLater();
+}
+
+void CardTests::testApplyJson()
+{
+    const QVariantMap data = getCardData();
+    Card *card = Card::fromJson(data);
+    card->setCardNumber("4242424242424242");
+    QSignalSpy spyAddress(card, &Card::addressChanged);
+    QSignalSpy spyLastFour(card, &Card::lastFourDigitsChanged);
+
+    QJsonObject object = Utils::toJsonObject(Utils::toJsonString(data).toUtf8());
+    card->applyJson(object);
+    QCOMPARE(spyAddress.count(), 0);
+    QCOMPARE(spyLastFour.count(), 0);
+
+    object[Card::FIELD_ADDRESS_PREFIX + Address::FIELD_CITY] = "Changed City";
+    card->applyJson(object);
+    QCOMPARE(spyAddress.count(), 1);
+    QCOMPARE(card->address()->city(), QString("Changed City"));
+    QCOMPARE(card->cardNumber(), QString("4242424242424242"));
+
+    card->deleteLater();
+}
+
+void CardTests::testDirtyFields()
+{
+    Card *card = Card::fromJson(getCardData());
+    QCOMPARE(card->isDirty(), false);
+
+    // The card number is only sent when the token is created.
+    card->setCardNumber("4242424242424242");
+    QCOMPARE(card->isDirty(), false);
+
+    card->address()->setCity("Changed City");
+    QCOMPARE(card->isDirty(), true);
+
+    QJsonObject object = Utils::toJsonObject(card->jsonString().toUtf8());
+    card->applyJson(object);
+    QCOMPARE(card->isDirty(), false);
+
+    card->setName("Changed Name");
+    QCOMPARE(card->isDirty(), true);
+
+    card->deleteLater();
+}
+
 void CardTests::testJsonStr()
 {
     QVariantMap data = getCardData();
@@ -269,6 +349,11 @@ void CardTests::testCardBrand()
     const QString masterCardOne = "5555555555554444";
     const QString masterCardTwo = "5105105105105100";
 
+    const QString discoverCoBranded = "6221260000000000";
+    const QString unionPay = "6200000000000005";
+    const QString maestro = "6759649826438453";
+    const QString mir = "2200000000000004";
+
     Card card;
 
     card.setCardNumber(americanExpressOne);
@@ -309,6 +394,49 @@ void CardTests::testCardBrand()
 
     card.setCardNumber(masterCardTwo);
     QCOMPARE(card.possibleCardBrand(), Card::MasterCard);
+
+    card.setCardNumber(discoverCoBranded);
+    QCOMPARE(card.possibleCardBrand(), Card::Discover);
+
+    card.setCardNumber(unionPay);
+    QCOMPARE(card.possibleCardBrand(), Card::UnionPay);
+
+    card.setCardNumber(maestro);
+    QCOMPARE(card.possibleCardBrand(), Card::Maestro);
+
+    card.setCardNumber(mir);
+    QCOMPARE(card.possibleCardBrand(), Card::Mir);
+
+    card.setCardNumber("4111 1111");
+    QCOMPARE(card.possibleCardBrand(), Card::Visa);
+
+    card.setCardNumber("411");
+    QCOMPARE(card.possibleCardBrand(), Card::Unknown);
+
+    // The values stored by the applications keep their meaning.
+    QCOMPARE(static_cast<int>(Card::MasterCard), 5);
+    QCOMPARE(static_cast<int>(Card::Unknown), 6);
+}
+
+void CardTests::testEnumNames()
+{
+    const QMetaEnum brands = QMetaEnum::fromType<Card::CardBrand>();
+    for (int index = 0; index < brands.keyCount(); index++) {
+        const Card::CardBrand brand = static_cast<Card::CardBrand>(brands.value(index));
+        QCOMPARE(Card::cardBrandType(Card::cardBrandName(brand)), brand);
+    }
+
+    QCOMPARE(Card::cardBrandName(Card::DinersClub), QString("Diners Club"));
+    QCOMPARE(Card::cardBrandType("Visa "), Card::Unknown);
+    QCOMPARE(Card::cardBrandType(""), Card::Unknown);
+
+    QCOMPARE(Card::fundingType("prepaid"), Card::FundingPrePaid);
+    QCOMPARE(Card::fundingTypeString(Card::FundingDebit), QString("debit"));
+    QCOMPARE(Card::cvcCheckType("unavailable"), Card::CVCCheckUnavailable);
+    QCOMPARE(Card::cvcCheckName(Card::CVCCheckUnknown), QString("unknown"));
+    QCOMPARE(Card::tokenizationMethodType("android_pay"), Card::GooglePay);
+    QCOMPARE(Card::tokenizationMethodName(Card::ApplePay), QString("apple_pay"));
+    QCOMPARE(Card::tokenizationMethodType("samsung_pay"), Card::TokenizationUnknown);
 }
 
 void CardTests::testCardLength()
@@ -373,6 +501,16 @@ void CardTests::testCardLength()
 
     card.setCardNumber(masterCardValid);
     QCOMPARE(card.validCardLenght(), true);
+
+    // Maestro cards can be between 12 and 19 digits.
+    card.setCardNumber("675964982643");
+    QCOMPARE(card.validCardLenght(), true);
+
+    card.setCardNumber("6759649826438453");
+    QCOMPARE(card.validCardLenght(), true);
+
+    card.setCardNumber("67596498264");
+    QCOMPARE(card.validCardLenght(), false);
 }
 
 void CardTests::testCardNumberValidation()
@@ -439,6 +577,57 @@ void CardTests::testCardNumberValidation()
     QCOMPARE(card.validCardNumber(), true);
 }
 
+void CardTests::testIncrementalCardNumber()
+{
+    const QString americanExpress = "378282246310005";
+    Card card;
+    Card fullCard;
+
+    // Type the number one digit at a time, and compare the results with a card that is given the whole number.
+    QString number;
+    for (const QChar &digit : americanExpress) {
+        number.append(digit);
+        card.setCardNumber(number);
+        fullCard.setCardNumber("");
+        fullCard.setCardNumber(number);
+
+        QCOMPARE(card.brand(), fullCard.brand());
+        QCOMPARE(card.validCardNumber(), fullCard.validCardNumber());
+        QCOMPARE(card.formattedCardNumber(), fullCard.formattedCardNumber());
+    }
+
+    QCOMPARE(card.brand(), Card::AmericanExpress);
+    QCOMPARE(card.validCardNumber(), true);
+    QCOMPARE(card.formattedCardNumber(), QString("3782 822463 10005"));
+
+    // Delete the digits one by one.
+    while (number.length() > 0) {
+        number.chop(1);
+        card.setCardNumber(number);
+        fullCard.setCardNumber("");
+        fullCard.setCardNumber(number);
+
+        QCOMPARE(card.brand(), fullCard.brand());
+        QCOMPARE(card.validCardNumber(), fullCard.validCardNumber());
+        QCOMPARE(card.formattedCardNumber(), fullCard.formattedCardNumber());
+    }
+
+    QCOMPARE(card.formattedCardNumber(), QString(""));
+
+    card.setCardNumber("4242424242424242");
+    QCOMPARE(card.formattedCardNumber(), QString("4242 4242 4242 4242"));
+    QCOMPARE(card.validCardNumber(), true);
+
+    // A space makes the number invalid, but it is not a part of the formatted number.
+    card.setCardNumber("4242424242424242 ");
+    QCOMPARE(card.validCardNumber(), false);
+    QCOMPARE(card.formattedCardNumber(), QString("4242 4242 4242 4242"));
+
+    card.setCardNumber("4242424242424242");
+    QCOMPARE(card.validCardNumber(), true);
+    QCOMPARE(card.brand(), Card::Visa);
+}
+
 void CardTests::testValidExpirationMonth()
 {
     Card card;
@@ -547,6 +736,51 @@ void CardTests::testValidCVC()
     QCOMPARE(card.validCVC(), true);
 }
 
+void CardTests::testCardValidator()
+{
+    const QDate today = QDate::currentDate();
+    const int nextYear = today.year() + 1;
+
+    QVector<CardValidator::Row> rows;
+    rows.append(CardValidator::Row("4242424242424242", 12, nextYear));
+    rows.append(CardValidator::Row("378282246310005", 1, nextYear % 100));
+    // Expired.
+    rows.append(CardValidator::Row("4242424242424242", 12, today.year() - 1));
+    // Invalid month.
+    rows.append(CardValidator::Row("4242424242424242", 13, nextYear));
+    // Fails the Luhn check.
+    rows.append(CardValidator::Row("4242424242424241", 12, nextYear));
+    // Invalid length for American Express.
+    rows.append(CardValidator::Row("3782822463100005", 12, nextYear));
+    rows.append(CardValidator::Row("42424242a4242424", 12, nextYear));
+
+    const QBitArray results = CardValidator::validate(rows);
+    QCOMPARE(results.size(), rows.size());
+    QCOMPARE(results.testBit(0), true);
+    QCOMPARE(results.testBit(1), true);
+    QCOMPARE(results.count(true), 2);
+
+    // The results must be the same as the ones of Card, and in the same order when the rows are split into multiple chunks.
+    const QVector<QByteArray> samples = {"4242424242424242", "4242424242424241", "6011000990139424", "30569309025904", "6759649826438453", "5105105105105100"};
+    QVector<QByteArray> numbers;
+    for (int index = 0; index < 10000; index++) {
+        numbers.append(samples.at(index % samples.size()));
+    }
+
+    const QBitArray numberResults = CardValidator::validateCardNumbers(numbers);
+    Card card;
+    for (int index = 0; index < samples.size(); index++) {
+        card.setCardNumber(QString::fromLatin1(samples.at(index)));
+        QCOMPARE(CardValidator::validCardNumber(samples.at(index)), card.validCardNumber());
+    }
+
+    for (int index = 0; index < numbers.size(); index++) {
+        QCOMPARE(numberResults.testBit(index), CardValidator::validCardNumber(numbers.at(index)));
+    }
+
+    QVERIFY(CardValidator::validate(QVector<CardValidator::Row>()).isEmpty());
+}
+
 void CardTests::testCreateToken()
 {
     const QDate today = QDate::currentDate();
@@ -20,19 +20,26 @@ public:
 private slots:
     void testSignals();
     void testFromJson();
+    void testFromJsonObject();
+    void testData();
+    void testApplyJson();
+    void testDirtyFields();
     void testJsonStr();
 
     void testJson();
     void testSet();
     void testCardBrand();
+    void testEnumNames();
 
     void testCardLength();
     void testCardNumberValidation();
+    void testIncrementalCardNumber();
     void testValidExpirationMonth();
 
     void testValidExpirationYear();
     void testValidExpirationDate();
     void testValidCVC();
+    void testCardValidator();
 
     void testCreateToken();
     void testTokenFetch();
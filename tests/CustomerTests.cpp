@@ -1,7 +1,10 @@
 #include "CustomerTests.h"
 #include <QtTest/QtTest>
 #include <QSignalSpy>
+// Tests
+#include "LocalServer.h"
 // QStripe
+#include "QStripe/ModelData.h"
 #include "QStripe/Customer.h"
 #include "QStripe/Stripe.h"
 #include "QStripe/Utils.h"
@@ -124,6 +127,174 @@ void CustomerTests::testFromJson()
     QCOMPARE(customer->customerID(), data[Customer::FIELD_ID].toString());
 }
 
+void CustomerTests::testFromJsonObject()
+{
+    const QVariantMap data = getData();
+    const QJsonObject object = Utils::toJsonObject(Utils::toJsonString(data).toUtf8());
+
+    Customer *expected = Customer::fromJson(data);
+    Customer *customer = Customer::fromJson(object);
+    QCOMPARE(customer->json(), expected->json());
+    QCOMPARE(customer->shippingInformation()->json(), expected->shippingInformation()->json());
+
+    expected->deleteLater();
+    customer->deleteLater();
+}
+
+void CustomerTests::testData()
+{
+    const QVariantMap data = getData();
+    const QJsonObject object = Utils::toJsonObject(Utils::toJsonString(data).toUtf8());
+
+    const CustomerData customerData = CustomerData::fromJson(object);
+    QCOMPARE(customerData.customerID, data[Customer::FIELD_ID].toString());
+    QCOMPARE(customerData.email, data[Customer::FIELD_EMAIL].toString());
+    QCOMPARE(customerData.metadata, data[Customer::FIELD_METADATA].toMap());
+    QCOMPARE(customerData.shipping.name, data[Customer::FIELD_SHIPPING].toMap()[ShippingInformation::FIELD_NAME].toString());
+
+    Customer *expected = Customer::fromJson(data);
+    Customer *customer = Customer::fromData(customerData);
+    QCOMPARE(customer->json(), expected->json());
+    QCOMPARE(customer->data().json(), customerData.json());
+
+    QJsonArray array;
+    array.append(object);
+    array.append(object);
+    QCOMPARE(CustomerData::fromJson(array).size(), 2);
+
+    expected->deleteLater();
+    customer->deleteLater();
+}
+
+void CustomerTests::testDataSchema()
+{
+    const QJsonObject object = Utils::toJsonObject(Utils::toJsonString(getData()).toUtf8());
+    const CustomerData customerData = CustomerData::fromJson(object);
+    QCOMPARE(CustomerData::fromJson(customerData.json()), customerData);
+    QCOMPARE(customerData.json(), object);
+
+    CustomerData other = customerData;
+    QCOMPARE(other, customerData);
+    other.shipping.address.zipCheck = Address::ZipCheckPass;
+    QVERIFY(other != customerData);
+
+    // The ID is only written when it is set, and the metadata is flattened in the form data.
+    CustomerData empty;
+    empty.metadata["order"] = "42";
+    QVariantMap expected;
+    expected[Customer::FIELD_METADATA + "[order]"] = "42";
+    QCOMPARE(CustomerData::schema().formData(empty, true), expected);
+    QVERIFY(CustomerData::schema().json(empty).contains(Customer::FIELD_ID) == false);
+
+    // The shipping information is omitted unless both the name and the phone are set.
+    empty.shipping.name = "Furkan Uzumcu";
+    QVERIFY(CustomerData::schema().formData(empty, true).contains(Customer::FIELD_SHIPPING) == false);
+    empty.shipping.phone = "+11234123123";
+    QVERIFY(CustomerData::schema().formData(empty, true).contains(Customer::FIELD_SHIPPING));
+
+    const AddressData address = AddressData::fromJson(object[Customer::FIELD_SHIPPING].toObject());
+    QJsonObject prefixed;
+    address.writeJson(prefixed, Card::FIELD_ADDRESS_PREFIX);
+    QCOMPARE(AddressData::fromJson(prefixed, Card::FIELD_ADDRESS_PREFIX), address);
+    QVERIFY(prefixed.contains(Card::FIELD_ADDRESS_PREFIX + Address::FIELD_LINE_1));
+}
+
+void CustomerTests::testApplyJson()
+{
+    const QVariantMap data = getData();
+    Customer *customer = Customer::fromJson(data);
+    QSignalSpy spyEmail(customer, &Customer::emailChanged);
+    QSignalSpy spyDescription(customer, &Customer::descriptionChanged);
+    QSignalSpy spyShipping(customer, &Customer::shippingInformationChanged);
+
+    QJsonObject object = Utils::toJsonObject(Utils::toJsonString(data).toUtf8());
+    object[Customer::FIELD_EMAIL] = "changed@example.com";
+    object.remove(Customer::FIELD_METADATA);
+    customer->applyJson(object);
+
+    QCOMPARE(customer->email(), QString("changed@example.com"));
+    QCOMPARE(spyEmail.count(), 1);
+    QCOMPARE(spyDescription.count(), 0);
+    QCOMPARE(spyShipping.count(), 0);
+    // The missing fields are not changed.
+    QCOMPARE(customer->metadata(), data[Customer::FIELD_METADATA].toMap());
+
+    object[Customer::FIELD_SHIPPING] = QJsonValue::Null;
+    customer->applyJson(object);
+    QCOMPARE(spyShipping.count(), 1);
+    QCOMPARE(customer->shippingInformation()->name(), QString(""));
+
+    customer->deleteLater();
+}
+
+void CustomerTests::testBatchedUpdates()
+{
+    Customer customer;
+    QSignalSpy spyEmail(&customer, &Customer::emailChanged);
+    QSignalSpy spyDescription(&customer, &Customer::descriptionChanged);
+
+    customer.beginUpdate();
+    customer.setEmail("first@example.com");
+    customer.setEmail("second@example.com");
+    customer.beginUpdate();
+    customer.setDescription("Description");
+    customer.endUpdate();
+
+    // The nested batch does not emit the signals.
+    QCOMPARE(spyEmail.count(), 0);
+    QCOMPARE(spyDescription.count(), 0);
+
+    customer.endUpdate();
+    QCOMPARE(customer.email(), QString("second@example.com"));
+    QCOMPARE(spyEmail.count(), 1);
+    QCOMPARE(spyDescription.count(), 1);
+
+    QSignalSpy spyCurrency(&customer, &Customer::currencyChanged);
+    customer.clear();
+    QCOMPARE(spyEmail.count(), 2);
+    QCOMPARE(spyDescription.count(), 2);
+    // Currency was already empty.
+    QCOMPARE(spyCurrency.count(), 0);
+}
+
+void CustomerTests::testDirtyFields()
+{
+    const QVariantMap data = getData();
+    Customer *customer = Customer::fromJson(data);
+    QCOMPARE(customer->isDirty(), false);
+
+    // Setting the same metadata again does not change anything that is sent.
+    QVariantMap metadata = customer->metadata();
+    metadata["meta"] = "changed";
+    customer->setMetadata(metadata);
+    QCOMPARE(customer->isDirty(), true);
+    metadata["meta"] = data[Customer::FIELD_METADATA].toMap()["meta"];
+    customer->setMetadata(metadata);
+    QCOMPARE(customer->isDirty(), false);
+
+    customer->shippingInformation()->setPhone("+10000000000");
+    QCOMPARE(customer->isDirty(), true);
+
+    customer->applyJson(Utils::toJsonObject(Utils::toJsonString(data).toUtf8()));
+    QCOMPARE(customer->isDirty(), false);
+
+    customer->setEmail("baz@bar.com");
+    QCOMPARE(customer->isDirty(), true);
+
+    QVariantMap previous;
+    previous["removed"] = "value";
+    previous["same"] = "value";
+    QVariantMap current;
+    current["same"] = "value";
+    current["added"] = "value";
+    QVariantMap expected;
+    expected["removed"] = "";
+    expected["added"] = "value";
+    QCOMPARE(Utils::changedEntries(current, previous), expected);
+
+    customer->deleteLater();
+}
+
 void CustomerTests::testJsonStr()
 {
     QVariantMap data = getData();
@@ -300,6 +471,71 @@ void CustomerTests::testUpdateCustomer()
     }
 }
 
+void CustomerTests::testAutoSave()
+{
+    QVERIFY2(m_CustomerID.length() > 0, "Customer ID doesn't exist. Cannot continue auto save test.");
+    if (m_CustomerID.length() > 0) {
+        QVariantMap data = getData();
+        data[Customer::FIELD_ID] = m_CustomerID;
+        data.remove(Customer::FIELD_DEFAULT_SOURCE);
+
+        Customer *customer = Customer::fromJson(data);
+        QSignalSpy spyAutoSave(customer, &Customer::autoSaveChanged);
+        customer->setAutoSaveInterval(100);
+        customer->setAutoSave(true);
+        QCOMPARE(spyAutoSave.count(), 1);
+        QCOMPARE(customer->autoSaveInterval(), 100);
+
+        QSignalSpy spyUpdated(customer, &Customer::updated);
+        customer->setEmail("auto@save.com");
+        customer->setDescription("Auto saved description.");
+        QVERIFY2(spyUpdated.wait() == true, customer->lastError()->message().toStdString().c_str());
+
+        // Both of the changes are sent with a single update.
+        QCOMPARE(spyUpdated.wait(1000), false);
+        QCOMPARE(spyUpdated.count(), 1);
+        QCOMPARE(customer->isDirty(), false);
+        QCOMPARE(customer->email(), QString("auto@save.com"));
+
+        customer->deleteLater();
+    }
+}
+
+void CustomerTests::testSingleFlightUpdate()
+{
+    LocalServer server;
+    server.setReplyDelay(200);
+    server.enqueueReply(200, "{\"id\": \"cus_local\", \"email\": \"second@example.com\"}");
+    server.enqueueReply(200, "{\"id\": \"cus_local\", \"email\": \"second@example.com\", \"description\": \"Edited in flight\"}");
+    LocalApiScope scope(server);
+
+    QVariantMap data;
+    data[Customer::FIELD_ID] = "cus_local";
+    data[Customer::FIELD_EMAIL] = "first@example.com";
+    QScopedPointer<Customer> customer(Customer::fromJson(data));
+    QSignalSpy spyUpdated(customer.data(), &Customer::updated);
+
+    customer->setEmail("second@example.com");
+    QVERIFY(customer->update());
+    QTRY_COMPARE(server.requests().size(), 1);
+
+    // The edit is made while the response of the first update is delayed. The second update waits for the first one.
+    customer->setDescription("Edited in flight");
+    QVERIFY(customer->update());
+    QTRY_COMPARE(spyUpdated.count(), 1);
+    // The response of the first update does not overwrite the local value.
+    QCOMPARE(customer->description(), QString("Edited in flight"));
+
+    QTRY_COMPARE(spyUpdated.count(), 2);
+    QCOMPARE(server.requests().size(), 2);
+    QCOMPARE(server.requests().at(0).body, QByteArray("email=second%40example.com"));
+    // Only the field that was edited during the flight is sent with the second update.
+    QCOMPARE(server.requests().at(1).body, QByteArray("description=Edited+in+flight"));
+    QCOMPARE(customer->description(), QString("Edited in flight"));
+    QCOMPARE(customer->email(), QString("second@example.com"));
+    QCOMPARE(customer->isDirty(), false);
+}
+
 void CustomerTests::testDeleteCustomerErrors()
 {
     QVERIFY2(m_CustomerIDToDelete.length() > 0, "m_CustomerIDToDelete doesn't exist. Cannot continue delete test.");
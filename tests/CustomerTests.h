@@ -18,6 +18,12 @@ private:
 private slots:
     void testSignals();
     void testFromJson();
+    void testFromJsonObject();
+    void testData();
+    void testDataSchema();
+    void testApplyJson();
+    void testBatchedUpdates();
+    void testDirtyFields();
     void testJsonStr();
 
     void testJson();
@@ -27,6 +33,8 @@ private slots:
     void testCreateCustomer();
     void testUpdateCustomerErrors();
     void testUpdateCustomer();
+    void testAutoSave();
+    void testSingleFlightUpdate();
 
     void testDeleteCustomerErrors();
     void testDeleteCustomer();
@@ -40,4 +40,62 @@ void ErrorTests::testError()
     data.remove("type");
     error.set(data, 400, 2);
     QCOMPARE(error.type(), Error::ErrorApiConnection);
+
+    QJsonObject errorObject;
+    errorObject["type"] = "card_error";
+    errorObject["code"] = "invalid_number";
+    errorObject["message"] = data["message"].toString();
+    QJsonObject response;
+    response["error"] = errorObject;
+
+    error.set(response, 402, 0);
+    QCOMPARE(error.type(), Error::ErrorCard);
+    QCOMPARE(error.code(), Error::CodeInvalidNumber);
+    QCOMPARE(error.message(), data["message"].toString());
+    QCOMPARE(error.chargeID(), QString(""));
+    QCOMPARE(error.rawErrorObject(), errorObject.toVariantMap());
+}
+
+void ErrorTests::testDeclineCodes()
+{
+    Error error;
+    QCOMPARE(error.declineCodeDescription(error.declineCodeExpiredCard()), QString("The card has expired."));
+    QCOMPARE(error.declineCodeNextSteps(error.declineCodeExpiredCard()), QString("The customer should use another card."));
+
+    // The sensitive decline codes return the generic texts unless omitSensitive is false.
+    QCOMPARE(error.declineCodeSensitive(error.declineCodeStolenCard()), true);
+    QCOMPARE(error.declineCodeDescription(error.declineCodeStolenCard()), QString("The payment has been declined."));
+    QCOMPARE(error.declineCodeDescription(error.declineCodeStolenCard(), false),
+             QString("The payment has been declined because the card is reported stolen."));
+    QCOMPARE(error.declineCodeNextSteps(error.declineCodePickupCard(), false),
+             QString("The customer needs to contact their card issuer for more information."));
+    QCOMPARE(error.declineCodeSensitive(error.declineCodeExpiredCard()), false);
+
+    QCOMPARE(error.declineCodeRetryable(error.declineCodeTryAgainLater()), true);
+    QCOMPARE(error.declineCodeRetryable(error.declineCodeProcessingError()), true);
+    QCOMPARE(error.declineCodeRetryable(error.declineCodeInsufficientFunds()), false);
+    QCOMPARE(error.declineCodeRetryable(error.declineCodeStolenCard()), false);
+
+    QCOMPARE(error.declineCodeDescription("unknown_decline_code"), QString(""));
+    QCOMPARE(error.declineCodeRetryable("unknown_decline_code"), false);
+
+    // The decline code of the instance is used by default.
+    QVariantMap data;
+    data["type"] = "card_error";
+    data["code"] = "card_declined";
+    data["decline_code"] = error.declineCodeIssuerNotAvailable();
+    error.set(data, 402);
+    QCOMPARE(error.declineCodeRetryable(), true);
+    QCOMPARE(error.declineCodeDescription(), QString("The card issuer could not be reached, so the payment could not be authorized."));
+
+    // Every decline code has a description.
+    const QMetaObject *metaObject = error.metaObject();
+    for (int index = metaObject->propertyOffset(); index < metaObject->propertyCount(); index++) {
+        const QMetaProperty property = metaObject->property(index);
+        if (QString(property.name()).startsWith("DeclineCode")) {
+            const QString declineCode = property.read(&error).toString();
+            QVERIFY2(error.declineCodeDescription(declineCode, false).length() > 0, qPrintable(declineCode));
+            QVERIFY2(error.declineCodeNextSteps(declineCode, false).length() > 0, qPrintable(declineCode));
+        }
+    }
 }
@@ -9,4 +9,5 @@ public:
 
 private slots:
     void testError();
+    void testDeclineCodes();
 };
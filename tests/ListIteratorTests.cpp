@@ -0,0 +1,68 @@
+#include "ListIteratorTests.h"
+#include "LocalServer.h"
+#include <QtTest/QtTest>
+// QStripe
+#include "QStripe/ListIterator.h"
+#include "QStripe/Customer.h"
+#include "QStripe/Stripe.h"
+
+using namespace QStripe;
+
+ListIteratorTests::ListIteratorTests(QObject *parent)
+    : QObject(parent)
+    , m_ApiBaseUrl()
+    , m_SecretKey()
+{
+
+}
+
+void ListIteratorTests::init()
+{
+    m_ApiBaseUrl = Stripe::apiBaseUrl();
+    m_SecretKey = Stripe::secretKey();
+}
+
+void ListIteratorTests::cleanup()
+{
+    Stripe::setApiBaseUrl(m_ApiBaseUrl);
+    Stripe::setSecretKey(m_SecretKey);
+}
+
+void ListIteratorTests::testListIterator()
+{
+    LocalServer server;
+    server.enqueueReply(200, "{\"data\": [{\"id\": \"cus_1\"}, {\"id\": \"cus_2\"}], \"has_more\": true}");
+    server.enqueueReply(200, "{\"data\": [{\"id\": \"cus_3\"}], \"has_more\": false}");
+
+    Stripe::setApiBaseUrl(server.url("/v1"));
+    Stripe::setSecretKey("sk_test_local");
+
+    ListIterator iterator;
+    iterator.setLimit(2);
+    QSignalSpy pageSpy(&iterator, &ListIterator::pageReceived);
+    QSignalSpy finishedSpy(&iterator, &ListIterator::finished);
+
+    QVERIFY(iterator.start());
+    QTRY_COMPARE(pageSpy.count(), 1);
+    QVERIFY(iterator.hasMore());
+
+    const QVariantList firstPage = pageSpy.at(0).at(0).toList();
+    QCOMPARE(firstPage.size(), 2);
+    QPointer<Customer> firstCustomer = firstPage.at(0).value<Customer *>();
+    QCOMPARE(firstCustomer->customerID(), QString("cus_1"));
+
+    // The second page is prefetched without calling next().
+    QTRY_COMPARE(server.requests().size(), 2);
+    QVERIFY(server.requests().at(1).path.contains("starting_after=cus_2"));
+    QVERIFY(server.requests().at(1).path.contains("limit=2"));
+
+    QVERIFY(iterator.next());
+    QTRY_COMPARE(pageSpy.count(), 2);
+    QCOMPARE(pageSpy.at(1).at(0).toList().size(), 1);
+    // The previous page is deleted with deleteLater().
+    QTRY_VERIFY(firstCustomer.isNull());
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(iterator.hasMore(), false);
+    QCOMPARE(iterator.running(), false);
+    QCOMPARE(server.requests().size(), 2);
+}
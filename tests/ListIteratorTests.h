@@ -0,0 +1,19 @@
+#pragma once
+#include <QObject>
+
+class ListIteratorTests : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ListIteratorTests(QObject *parent = nullptr);
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testListIterator();
+
+private:
+    QString m_ApiBaseUrl, m_SecretKey;
+};
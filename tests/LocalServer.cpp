@@ -0,0 +1,164 @@
+#include "LocalServer.h"
+#include <QTcpSocket>
+#include <QTimer>
+// QStripe
+#include "QStripe/Stripe.h"
+
+LocalServer::LocalServer(QObject *parent)
+    : QTcpServer(parent)
+    , m_Buffers()
+    , m_Replies()
+    , m_DefaultReply{200, "{}", QMap<QByteArray, QByteArray>()}
+    , m_Requests()
+    , m_IsHttp2Rejected(false)
+    , m_ReplyDelay(0)
+{
+    connect(this, &QTcpServer::newConnection, this, &LocalServer::onNewConnection);
+    listen(QHostAddress::LocalHost);
+}
+
+QString LocalServer::url(const QString &path) const
+{
+    return QString("http://127.0.0.1:%1").arg(serverPort()) + path;
+}
+
+void LocalServer::enqueueReply(int status, const QByteArray &body, const QMap<QByteArray, QByteArray> &headers)
+{
+    m_Replies.enqueue(Reply{status, body, headers});
+}
+
+void LocalServer::setDefaultReply(int status, const QByteArray &body)
+{
+    m_DefaultReply = Reply{status, body, QMap<QByteArray, QByteArray>()};
+}
+
+void LocalServer::enqueueDisconnect()
+{
+    m_Replies.enqueue(Reply{0, QByteArray(), QMap<QByteArray, QByteArray>()});
+}
+
+void LocalServer::setHttp2Rejected(bool rejected)
+{
+    m_IsHttp2Rejected = rejected;
+}
+
+void LocalServer::setReplyDelay(int msecs)
+{
+    m_ReplyDelay = msecs;
+}
+
+const QList<LocalServer::Request> &LocalServer::requests() const
+{
+    return m_Requests;
+}
+
+void LocalServer::clearRequests()
+{
+    m_Requests.clear();
+}
+
+void LocalServer::onNewConnection()
+{
+    while (hasPendingConnections()) {
+        QTcpSocket *socket = nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            onReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_Buffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void LocalServer::onReadyRead(QTcpSocket *socket)
+{
+    QByteArray &buffer = m_Buffers[socket];
+    buffer.append(socket->readAll());
+
+    // Keep-alive connections can carry more than one request.
+    while (true) {
+        const int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return;
+        }
+
+        const QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        Request request;
+        const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        request.method = requestLine.value(0);
+        request.path = requestLine.value(1);
+        if (m_IsHttp2Rejected && request.method == "PRI") {
+            // The client reads this as an invalid HTTP/2 frame.
+            socket->write("HTTP/1.1 505 HTTP Version Not Supported\r\nConnection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            m_Buffers.remove(socket);
+            return;
+        }
+
+        for (int index = 1; index < lines.size(); index++) {
+            const int separator = lines.at(index).indexOf(':');
+            if (separator > 0) {
+                request.headers[lines.at(index).left(separator).trimmed().toLower()] = lines.at(index).mid(separator + 1).trimmed();
+            }
+        }
+
+        const int contentLength = request.headers.value("content-length").toInt();
+        if (buffer.size() < headerEnd + 4 + contentLength) {
+            return;
+        }
+
+        request.body = buffer.mid(headerEnd + 4, contentLength);
+        buffer.remove(0, headerEnd + 4 + contentLength);
+
+        m_Requests.append(request);
+        respond(socket);
+        emit requestReceived();
+        // The socket is closed If the reply was a disconnect.
+        if (m_Buffers.contains(socket) == false) {
+            return;
+        }
+    }
+}
+
+void LocalServer::respond(QTcpSocket *socket)
+{
+    const Reply reply = m_Replies.isEmpty() ? m_DefaultReply : m_Replies.dequeue();
+    if (reply.status == 0) {
+        socket->abort();
+        return;
+    }
+
+    QByteArray data = "HTTP/1.1 " + QByteArray::number(reply.status) + " Status\r\n";
+    data += "Content-Type: application/json\r\n";
+    data += "Content-Length: " + QByteArray::number(reply.body.size()) + "\r\n";
+    data += "Connection: keep-alive\r\n";
+    for (auto it = reply.headers.constBegin(); it != reply.headers.constEnd(); it++) {
+        data += it.key() + ": " + it.value() + "\r\n";
+    }
+
+    data += "\r\n" + reply.body;
+    if (m_ReplyDelay > 0) {
+        // The timer is bound to the socket, so the reply is dropped If the client disconnects.
+        QTimer::singleShot(m_ReplyDelay, socket, [socket, data]() {
+            socket->write(data);
+        });
+    }
+    else {
+        socket->write(data);
+    }
+}
+
+LocalApiScope::LocalApiScope(const LocalServer &server)
+    : m_ApiBaseUrl(QStripe::Stripe::apiBaseUrl())
+    , m_SecretKey(QStripe::Stripe::secretKey())
+{
+    QStripe::Stripe::setApiBaseUrl(server.url("/v1"));
+    QStripe::Stripe::setSecretKey("sk_test_local");
+}
+
+LocalApiScope::~LocalApiScope()
+{
+    QStripe::Stripe::setApiBaseUrl(m_ApiBaseUrl);
+    QStripe::Stripe::setSecretKey(m_SecretKey);
+}
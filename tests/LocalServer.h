@@ -0,0 +1,120 @@
+#pragma once
+#include <QTcpServer>
+#include <QQueue>
+#include <QHash>
+#include <QMap>
+
+class QTcpSocket;
+
+/**
+ * @brief LocalServer is a minimal HTTP/1.1 stand-in for the Stripe API. It records the requests it receives and answers them with the queued replies, or
+ * with the default reply when the queue is empty.
+ */
+class LocalServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    struct Request {
+        QByteArray method, path, body;
+        // Header names are lower case.
+        QMap<QByteArray, QByteArray> headers;
+    };
+
+/**
+ * @brief LocalApiScope points the Stripe API base URL and the secret key to a LocalServer, and restores them when it goes out of scope. It can be used in
+ * the test classes that cannot restore them in cleanup(), e.g the ones that set the secret key for the tests that follow them.
+ */
+class LocalApiScope
+{
+public:
+    explicit LocalApiScope(const LocalServer &server);
+    ~LocalApiScope();
+
+private:
+    QString m_ApiBaseUrl, m_SecretKey;
+};
+
+    struct Reply {
+        // 0 closes the connection without answering.
+        int status;
+        QByteArray body;
+        QMap<QByteArray, QByteArray> headers;
+    };
+
+/**
+ * @brief LocalApiScope points the Stripe API base URL and the secret key to a LocalServer, and restores them when it goes out of scope. It can be used in
+ * the test classes that cannot restore them in cleanup(), e.g the ones that set the secret key for the tests that follow them.
+ */
+class LocalApiScope
+{
+public:
+    explicit LocalApiScope(const LocalServer &server);
+    ~LocalApiScope();
+
+private:
+    QString m_ApiBaseUrl, m_SecretKey;
+};
+
+public:
+    explicit LocalServer(QObject *parent = nullptr);
+
+    /**
+     * @brief Returns the base URL of the server. Can be used with `Stripe::setApiBaseUrl()`.
+     * @return QString
+     */
+    QString url(const QString &path = "") const;
+
+    void enqueueReply(int status, const QByteArray &body, const QMap<QByteArray, QByteArray> &headers = QMap<QByteArray, QByteArray>());
+    void setDefaultReply(int status, const QByteArray &body);
+
+    /**
+     * @brief Closes the connection in the middle of the next request instead of answering it.
+     */
+    void enqueueDisconnect();
+
+    /**
+     * @brief If true, the HTTP/2 connection preface is answered with garbage and the connection is closed, like a server that does not speak HTTP/2.
+     * @param rejected
+     */
+    void setHttp2Rejected(bool rejected);
+
+    /**
+     * @brief Delays every reply by msecs, e.g to change a model while its request is in flight. The default value is 0.
+     * @param msecs
+     */
+    void setReplyDelay(int msecs);
+
+    const QList<Request> &requests() const;
+    void clearRequests();
+
+signals:
+    void requestReceived();
+
+private:
+    QHash<QTcpSocket *, QByteArray> m_Buffers;
+    QQueue<Reply> m_Replies;
+    Reply m_DefaultReply;
+    QList<Request> m_Requests;
+    bool m_IsHttp2Rejected;
+    int m_ReplyDelay;
+
+private:
+    void onNewConnection();
+    void onReadyRead(QTcpSocket *socket);
+    void respond(QTcpSocket *socket);
+};
+
+/**
+ * @brief LocalApiScope points the Stripe API base URL and the secret key to a LocalServer, and restores them when it goes out of scope. It can be used in
+ * the test classes that cannot restore them in cleanup(), e.g the ones that set the secret key for the tests that follow them.
+ */
+class LocalApiScope
+{
+public:
+    explicit LocalApiScope(const LocalServer &server);
+    ~LocalApiScope();
+
+private:
+    QString m_ApiBaseUrl, m_SecretKey;
+};
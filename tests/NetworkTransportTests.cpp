@@ -0,0 +1,105 @@
+#include "NetworkTransportTests.h"
+#include "LocalServer.h"
+#include <QtTest/QtTest>
+// QStripe
+#include "QStripe/NetworkTransport.h"
+#include "QStripe/NetworkUtils.h"
+
+using namespace QStripe;
+
+NetworkTransportTests::NetworkTransportTests(QObject *parent)
+    : QObject(parent)
+    , m_ReadRate(0)
+    , m_WriteRate(0)
+    , m_IsGetDeduplicationEnabled(true)
+{
+
+}
+
+void NetworkTransportTests::init()
+{
+    m_ReadRate = NetworkTransport::readRate();
+    m_WriteRate = NetworkTransport::writeRate();
+    m_IsGetDeduplicationEnabled = NetworkTransport::getDeduplicationEnabled();
+}
+
+void NetworkTransportTests::cleanup()
+{
+    NetworkTransport::setReadRate(m_ReadRate);
+    NetworkTransport::setWriteRate(m_WriteRate);
+    NetworkTransport::setGetDeduplicationEnabled(m_IsGetDeduplicationEnabled);
+}
+
+void NetworkTransportTests::testRateLimiter()
+{
+    LocalServer server;
+    NetworkUtils network;
+    QSharedPointer<NetworkTransport> transport = NetworkTransport::instance();
+    NetworkTransport::setReadRate(5);
+    // Each of the identical requests should go through the rate limiter.
+    NetworkTransport::setGetDeduplicationEnabled(false);
+
+    int finishedCount = 0;
+    auto callback = [&finishedCount](const Response &) {
+        finishedCount++;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int index = 0; index < 8; index++) {
+        network.sendGet(server.url("/v1/customers/cus_1"), callback);
+    }
+
+    // The bucket starts with one second of tokens, the rest is queued instead of rejected.
+    QCOMPARE(transport->queuedRequestCount(), 3);
+    QVERIFY(transport->queueWaitTime() > 0);
+    QCOMPARE(network.pendingRequestCount(), 8);
+
+    // The writes have their own bucket.
+    bool posted = false;
+    network.sendPost(server.url("/v1/customers"), QVariantMap(), [&posted](const Response &) {
+        posted = true;
+    });
+    QCOMPARE(transport->queuedRequestCount(), 3);
+
+    QTRY_COMPARE(finishedCount, 8);
+    QVERIFY(posted);
+    // The 3 queued requests need 3 tokens at 5 per second.
+    QVERIFY(timer.elapsed() >= 500);
+    QCOMPARE(transport->queuedRequestCount(), 0);
+}
+
+void NetworkTransportTests::testPriorityLanes()
+{
+    LocalServer server;
+    NetworkUtils bulk;
+    bulk.setPriority(NetworkTransport::PriorityBulk);
+    QSharedPointer<NetworkTransport> transport = NetworkTransport::instance();
+    NetworkTransport::setReadRate(10);
+    NetworkTransport::setGetDeduplicationEnabled(false);
+
+    QStringList order;
+    // Use the first burst of tokens so that the next requests are queued.
+    for (int index = 0; index < 10; index++) {
+        bulk.sendGet(server.url("/v1/customers/burst"), [](const Response &) {});
+    }
+
+    for (int index = 0; index < 3; index++) {
+        bulk.sendGet(server.url("/v1/customers/bulk"), [&order](const Response &) {
+            order.append("bulk");
+        });
+    }
+
+    // The priority of a single request can be set without changing the priority of the instance.
+    bulk.sendGet(server.url("/v1/customers/interactive"), [&order](const Response &) {
+        order.append("interactive");
+    }, QVariantMap(), NetworkTransport::PriorityInteractive);
+    QCOMPARE(bulk.priority(), NetworkTransport::PriorityBulk);
+
+    QVERIFY(transport->queuedRequestCount() >= 4);
+    // The interactive request is queued last but it is sent first.
+    QTRY_COMPARE(order.size(), 4);
+    QCOMPARE(order.first(), QString("interactive"));
+    QVERIFY(transport->averageQueueWaitTime(NetworkTransport::PriorityBulk) > transport->averageQueueWaitTime(NetworkTransport::PriorityInteractive));
+    QVERIFY(transport->averageLatency(NetworkTransport::PriorityInteractive) > 0);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <QObject>
+
+class NetworkTransportTests : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NetworkTransportTests(QObject *parent = nullptr);
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testRateLimiter();
+    void testPriorityLanes();
+
+private:
+    double m_ReadRate, m_WriteRate;
+    bool m_IsGetDeduplicationEnabled;
+};
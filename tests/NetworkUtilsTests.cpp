@@ -0,0 +1,347 @@
+#include "NetworkUtilsTests.h"
+#include "LocalServer.h"
+#include <QtTest/QtTest>
+// QStripe
+#include "QStripe/NetworkUtils.h"
+#include "QStripe/Utils.h"
+
+using namespace QStripe;
+
+NetworkUtilsTests::NetworkUtilsTests(QObject *parent)
+    : QObject(parent)
+    , m_RetryBaseDelay(0)
+    , m_IsGetDeduplicationEnabled(true)
+{
+
+}
+
+void NetworkUtilsTests::init()
+{
+    m_RetryBaseDelay = NetworkTransport::retryBaseDelay();
+    m_IsGetDeduplicationEnabled = NetworkTransport::getDeduplicationEnabled();
+}
+
+void NetworkUtilsTests::cleanup()
+{
+    NetworkTransport::setRetryBaseDelay(m_RetryBaseDelay);
+    NetworkTransport::setGetDeduplicationEnabled(m_IsGetDeduplicationEnabled);
+}
+
+void NetworkUtilsTests::testPendingRequests()
+{
+    LocalServer server;
+    NetworkUtils network;
+
+    int finishedCount = 0;
+    auto callback = [&finishedCount](const Response & response) {
+        QCOMPARE(response.httpStatus, 200u);
+        finishedCount++;
+    };
+
+    network.sendGet(server.url("/v1/customers/cus_1"), callback);
+    network.sendGet(server.url("/v1/customers/cus_2"), callback);
+    QCOMPARE(network.pendingRequestCount(), 2);
+
+    QTRY_COMPARE(finishedCount, 2);
+    QCOMPARE(network.pendingRequestCount(), 0);
+    QCOMPARE(server.requests().size(), 2);
+}
+
+void NetworkUtilsTests::testHttp2Fallback()
+{
+    LocalServer server;
+    NetworkUtils network;
+    network.setHttp2Enabled(true);
+
+    QSharedPointer<NetworkTransport> transport = NetworkTransport::instance();
+    const int http1Count = transport->http1ReplyCount();
+
+    bool finished = false;
+    network.sendGet(server.url("/v1/customers/cus_1"), [&finished](const Response & response) {
+        // The stand-in server only speaks HTTP/1.1.
+        QCOMPARE(response.http2Used, false);
+        QCOMPARE(response.httpStatus, 200u);
+        finished = true;
+    });
+
+    QTRY_VERIFY(finished);
+    QCOMPARE(transport->http1ReplyCount(), http1Count + 1);
+
+    // A connection reset is retried by the retry policy but does not switch the host to HTTP/1.1. The POST has no attempts left, so it is not sent again.
+    const int fallbackCount = transport->http2FallbackCount();
+    const QString host = QUrl(server.url()).host();
+    server.clearRequests();
+    server.enqueueDisconnect();
+    network.setMaxAttempts(1);
+    unsigned int status = 1;
+    network.sendPost(server.url("/v1/customers"), QVariantMap(), [&status](const Response & response) {
+        status = response.httpStatus;
+    });
+
+    QTRY_COMPARE(status, 0u);
+    QCOMPARE(server.requests().size(), 1);
+    QCOMPARE(transport->http2FallbackCount(), fallbackCount);
+    QVERIFY(transport->http2Allowed(host));
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    // A server that does not speak HTTP/2 fails the negotiation. The host is switched to HTTP/1.1 and the GET is sent again right away.
+    server.clearRequests();
+    server.setHttp2Rejected(true);
+    network.setMaxAttempts(0);
+    network.setHttp2Direct(true);
+    finished = false;
+    network.sendGet(server.url("/v1/customers/cus_1"), [&finished](const Response & response) {
+        QCOMPARE(response.http2Used, false);
+        QCOMPARE(response.httpStatus, 200u);
+        finished = true;
+    });
+
+    QTRY_VERIFY(finished);
+    QCOMPARE(transport->http2FallbackCount(), fallbackCount + 1);
+    QCOMPARE(transport->http2Allowed(host), false);
+    QCOMPARE(server.requests().size(), 1);
+#endif
+}
+
+void NetworkUtilsTests::testHttp2Direct()
+{
+    // Point this to a cleartext HTTP/2 server (e.g `nghttpd --no-tls 8080`) to run the test.
+    const QString h2cUrl = qEnvironmentVariable("QSTRIPE_H2C_URL");
+    if (h2cUrl.isEmpty()) {
+        QSKIP("QSTRIPE_H2C_URL is not set.");
+    }
+
+    NetworkUtils network;
+    network.setHttp2Enabled(true);
+    network.setHttp2Direct(true);
+
+    QSharedPointer<NetworkTransport> transport = NetworkTransport::instance();
+    const int http2Count = transport->http2ReplyCount();
+    // Each of the identical requests should be sent.
+    NetworkTransport::setGetDeduplicationEnabled(false);
+
+    int finishedCount = 0;
+    for (int index = 0; index < 10; index++) {
+        network.sendGet(h2cUrl, [&finishedCount](const Response & response) {
+            QCOMPARE(response.http2Used, true);
+            finishedCount++;
+        });
+    }
+
+    QTRY_COMPARE(finishedCount, 10);
+    QCOMPARE(transport->http2ReplyCount(), http2Count + 10);
+}
+
+void NetworkUtilsTests::testRetry()
+{
+    LocalServer server;
+    NetworkUtils network;
+    QSharedPointer<NetworkTransport> transport = NetworkTransport::instance();
+    NetworkTransport::setRetryBaseDelay(10);
+
+    // A 503 is retried, and Retry-After is respected for 429.
+    server.enqueueReply(503, "{}");
+    server.enqueueReply(429, "{}", {{"Retry-After", "0"}});
+    const int retryCount = transport->retryCount();
+    unsigned int status = 0;
+    network.sendGet(server.url("/v1/customers/cus_1"), [&status](const Response & response) {
+        status = response.httpStatus;
+    });
+
+    QTRY_COMPARE(status, 200u);
+    QCOMPARE(server.requests().size(), 3);
+    QCOMPARE(transport->retryCount(), retryCount + 2);
+    QCOMPARE(network.pendingRequestCount(), 0);
+
+    // The last response is returned when the attempts run out.
+    server.clearRequests();
+    server.enqueueReply(500, "{}");
+    server.enqueueReply(500, "{}");
+    network.setMaxAttempts(2);
+    status = 0;
+    network.sendGet(server.url("/v1/customers/cus_1"), [&status](const Response & response) {
+        status = response.httpStatus;
+    });
+
+    QTRY_COMPARE(status, 500u);
+    QCOMPARE(server.requests().size(), 2);
+
+    // A PUT does not have an idempotency key, so it is not retried after a 500.
+    server.clearRequests();
+    server.enqueueReply(500, "{}");
+    status = 0;
+    network.sendPut(server.url("/v1/customers"), QVariantMap(), [&status](const Response & response) {
+        status = response.httpStatus;
+    });
+
+    QTRY_COMPARE(status, 500u);
+    QCOMPARE(server.requests().size(), 1);
+
+    // A Retry-After that does not fit in milliseconds is past the deadline, so the request is not retried.
+    server.clearRequests();
+    server.enqueueReply(429, "{}", {{"Retry-After", "99999999999"}});
+    network.setMaxAttempts(0);
+    status = 0;
+    network.sendGet(server.url("/v1/customers/cus_2"), [&status](const Response & response) {
+        status = response.httpStatus;
+    });
+
+    QTRY_COMPARE(status, 429u);
+    QCOMPARE(server.requests().size(), 1);
+}
+
+void NetworkUtilsTests::testIdempotencyKey()
+{
+    LocalServer server;
+    NetworkUtils network;
+    NetworkTransport::setRetryBaseDelay(10);
+
+    // The generated key is kept when the request is retried.
+    server.enqueueReply(503, "{}");
+    unsigned int status = 0;
+    network.sendPost(server.url("/v1/customers"), QVariantMap(), [&status](const Response & response) {
+        status = response.httpStatus;
+    });
+
+    QTRY_COMPARE(status, 200u);
+    QCOMPARE(server.requests().size(), 2);
+    QVERIFY(server.requests().at(0).headers.value("idempotency-key").isEmpty() == false);
+    QCOMPARE(server.requests().at(0).headers.value("idempotency-key"), server.requests().at(1).headers.value("idempotency-key"));
+
+    // A duplicate submission is answered with the response of the first one.
+    server.clearRequests();
+    server.enqueueReply(200, "{\"id\": \"cus_1\"}");
+    const QString key = NetworkUtils::generateIdempotencyKey();
+    QStringList responses;
+    auto callback = [&responses](const Response & response) {
+        responses.append(response.data());
+    };
+
+    network.sendPost(server.url("/v1/customers"), QVariantMap(), callback, key);
+    network.sendPost(server.url("/v1/customers"), QVariantMap(), callback, key);
+    QTRY_COMPARE(responses.size(), 2);
+    network.sendPost(server.url("/v1/customers"), QVariantMap(), callback, key);
+    QTRY_COMPARE(responses.size(), 3);
+
+    QCOMPARE(server.requests().size(), 1);
+    QCOMPARE(server.requests().at(0).headers.value("idempotency-key"), key.toUtf8());
+    QCOMPARE(responses.at(1), responses.at(0));
+    QCOMPARE(responses.at(2), responses.at(0));
+}
+
+void NetworkUtilsTests::testGetDeduplication()
+{
+    LocalServer server;
+    NetworkUtils first, second;
+    QSharedPointer<NetworkTransport> transport = NetworkTransport::instance();
+    const int deduplicatedCount = transport->deduplicatedGetCount();
+
+    server.enqueueReply(200, "{\"id\": \"cus_1\"}");
+    QStringList ids;
+    auto callback = [&ids](const Response & response) {
+        ids.append(response.json()["id"].toString());
+    };
+
+    // The identical requests share one response, even when they are sent from different instances.
+    first.sendGet(server.url("/v1/customers/cus_1"), callback);
+    first.sendGet(server.url("/v1/customers/cus_1"), callback);
+    second.sendGet(server.url("/v1/customers/cus_1"), callback);
+    QTRY_COMPARE(ids.size(), 3);
+    QCOMPARE(server.requests().size(), 1);
+    QCOMPARE(ids, QStringList({"cus_1", "cus_1", "cus_1"}));
+    QCOMPARE(transport->deduplicatedGetCount(), deduplicatedCount + 2);
+
+    // A different secret key is a different request.
+    server.clearRequests();
+    ids.clear();
+    second.setHeader("Authorization", "Bearer sk_test_other");
+    first.sendGet(server.url("/v1/customers/cus_1"), callback);
+    second.sendGet(server.url("/v1/customers/cus_1"), callback);
+    QTRY_COMPARE(ids.size(), 2);
+    QCOMPARE(server.requests().size(), 2);
+
+    // The request is not shared once it is finished.
+    server.clearRequests();
+    first.sendGet(server.url("/v1/customers/cus_1"), callback);
+    QTRY_COMPARE(ids.size(), 3);
+    QCOMPARE(server.requests().size(), 1);
+    QCOMPARE(transport->deduplicatedGetCount(), deduplicatedCount + 2);
+
+    // A failed response is shared with all of the waiters as well.
+    server.clearRequests();
+    server.enqueueReply(404, "{\"error\": {\"type\": \"invalid_request_error\", \"message\": \"No such customer\"}}");
+    QList<unsigned int> statuses;
+    auto statusCallback = [&statuses](const Response & response) {
+        statuses.append(response.httpStatus);
+    };
+
+    first.sendGet(server.url("/v1/customers/cus_2"), statusCallback);
+    first.sendGet(server.url("/v1/customers/cus_2"), statusCallback);
+    QTRY_COMPARE(statuses.size(), 2);
+    QCOMPARE(server.requests().size(), 1);
+    QCOMPARE(statuses, QList<unsigned int>({404, 404}));
+
+    // If the instance that sent the request is destroyed, one of the waiters sends it again.
+    server.clearRequests();
+    statuses.clear();
+    server.setReplyDelay(200);
+    NetworkUtils *owner = new NetworkUtils();
+    owner->sendGet(server.url("/v1/customers/cus_3"), statusCallback);
+    second.sendGet(server.url("/v1/customers/cus_3"), statusCallback);
+    QTRY_COMPARE(server.requests().size(), 1);
+
+    delete owner;
+    QTRY_COMPARE(statuses.size(), 1);
+    QCOMPARE(statuses.first(), 200u);
+    QCOMPARE(server.requests().size(), 2);
+    server.setReplyDelay(0);
+}
+
+void NetworkUtilsTests::benchmarkResponseParsing_data()
+{
+    QTest::addColumn<bool>("decodeBody");
+    QTest::newRow("QString") << true;
+    QTest::newRow("QByteArray") << false;
+}
+
+void NetworkUtilsTests::benchmarkResponseParsing()
+{
+    QFETCH(bool, decodeBody);
+
+    // A list page with 100 customers, roughly the size of the largest response the library receives.
+    QByteArray body = "{\"object\":\"list\",\"has_more\":false,\"data\":[";
+    for (int index = 0; index < 100; index++) {
+        if (index > 0) {
+            body += ",";
+        }
+
+        body += "{\"id\":\"cus_" + QByteArray::number(index) + "\",\"object\":\"customer\",\"email\":\"customer@example.com\","
+                "\"description\":\"Customer\",\"currency\":\"usd\",\"created\":1500000000,\"livemode\":false}";
+    }
+
+    body += "]}";
+
+    const Response response(body, 200, QNetworkReply::NoError);
+
+    // The intermediate buffers that are built from the body before it is parsed.
+    int copiedBytes = 0;
+    if (decodeBody) {
+        const QString decoded = response.data();
+        copiedBytes = decoded.size() * static_cast<int>(sizeof(QChar)) + decoded.toUtf8().size();
+    }
+
+    qInfo() << "[INFO]" << QTest::currentDataTag() << "copies" << copiedBytes << "bytes for a" << body.size() << "byte response.";
+
+    QVariantMap data;
+    QBENCHMARK {
+        if (decodeBody) {
+            // The previous path decoded the body to a UTF-16 QString and encoded it back to UTF-8 before parsing.
+            data = Utils::toVariantMap(response.data());
+        }
+        else {
+            data = Utils::toVariantMap(response.body);
+        }
+    }
+
+    QCOMPARE(data["data"].toList().size(), 100);
+}
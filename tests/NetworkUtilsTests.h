@@ -0,0 +1,27 @@
+#pragma once
+#include <QObject>
+
+class NetworkUtilsTests : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NetworkUtilsTests(QObject *parent = nullptr);
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testPendingRequests();
+    void testHttp2Fallback();
+    void testHttp2Direct();
+    void testRetry();
+    void testIdempotencyKey();
+    void testGetDeduplication();
+    void benchmarkResponseParsing_data();
+    void benchmarkResponseParsing();
+
+private:
+    int m_RetryBaseDelay;
+    bool m_IsGetDeduplicationEnabled;
+};
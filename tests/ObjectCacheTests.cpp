@@ -0,0 +1,103 @@
+#include "ObjectCacheTests.h"
+#include "LocalServer.h"
+#include <QtTest/QtTest>
+// QStripe
+#include "QStripe/ObjectCache.h"
+#include "QStripe/Customer.h"
+#include "QStripe/Stripe.h"
+
+using namespace QStripe;
+
+ObjectCacheTests::ObjectCacheTests(QObject *parent)
+    : QObject(parent)
+    , m_ApiBaseUrl()
+    , m_SecretKey()
+    , m_IsCacheEnabled(false)
+    , m_CacheMaxEntries(0)
+{
+
+}
+
+void ObjectCacheTests::init()
+{
+    m_ApiBaseUrl = Stripe::apiBaseUrl();
+    m_SecretKey = Stripe::secretKey();
+    m_IsCacheEnabled = Stripe::cacheEnabled();
+    m_CacheMaxEntries = Stripe::cacheMaxEntries();
+}
+
+void ObjectCacheTests::cleanup()
+{
+    Stripe::setCacheEnabled(m_IsCacheEnabled);
+    Stripe::setCacheMaxEntries(m_CacheMaxEntries);
+    Stripe::setApiBaseUrl(m_ApiBaseUrl);
+    Stripe::setSecretKey(m_SecretKey);
+}
+
+void ObjectCacheTests::testObjectCache()
+{
+    LocalServer server;
+    server.setDefaultReply(200, "{\"id\": \"cus_1\", \"email\": \"foo@bar.com\"}");
+
+    Stripe::setApiBaseUrl(server.url("/v1"));
+    Stripe::setSecretKey("sk_test_local");
+    Stripe::setCacheEnabled(true);
+    Stripe::setCacheMaxEntries(1);
+
+    Stripe stripe;
+    QSignalSpy spy(&stripe, &Stripe::customerFetched);
+    const int hitCount = stripe.cacheHitCount();
+    const int evictionCount = stripe.cacheEvictionCount();
+
+    QVERIFY(stripe.fetchCustomer("cus_1"));
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(stripe.fetchCustomer("cus_1"));
+    // The cached customer is still delivered asynchronously.
+    QCOMPARE(spy.count(), 1);
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(0).value<Customer *>()->email(), QString("foo@bar.com"));
+    QCOMPARE(server.requests().size(), 1);
+    QCOMPARE(stripe.cacheHitCount(), hitCount + 1);
+
+    // cus_2 evicts cus_1.
+    server.enqueueReply(200, "{\"id\": \"cus_2\"}");
+    QVERIFY(stripe.fetchCustomer("cus_2"));
+    QTRY_COMPARE(spy.count(), 3);
+    QCOMPARE(stripe.cacheEvictionCount(), evictionCount + 1);
+    QCOMPARE(ObjectCache::count(), 1);
+
+    // A deleted customer is removed from the cache.
+    Customer *customer = spy.at(2).at(0).value<Customer *>();
+    QSignalSpy deletedSpy(customer, &Customer::customerDeleted);
+    QVERIFY(customer->deleteCustomer());
+    QTRY_COMPARE(deletedSpy.count(), 1);
+    QCOMPARE(ObjectCache::count(), 0);
+}
+
+void ObjectCacheTests::testCacheAccount()
+{
+    LocalServer server;
+    Stripe::setApiBaseUrl(server.url("/v1"));
+    Stripe::setSecretKey("sk_test_local");
+    Stripe::setCacheEnabled(true);
+
+    Stripe stripe;
+    QSignalSpy cardSpy(&stripe, &Stripe::cardFetched);
+    QSignalSpy errorSpy(&stripe, &Stripe::errorOccurred);
+
+    // A card is only returned from the cache for the customer that it was fetched with.
+    server.enqueueReply(200, "{\"id\": \"card_1\", \"customer\": \"cus_A\"}");
+    QVERIFY(stripe.fetchCard("cus_A", "card_1"));
+    QTRY_COMPARE(cardSpy.count(), 1);
+
+    server.enqueueReply(404, "{\"error\": {\"type\": \"invalid_request_error\", \"message\": \"No such source\"}}");
+    QVERIFY(stripe.fetchCard("cus_B", "card_1"));
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(cardSpy.count(), 1);
+    QCOMPARE(server.requests().size(), 2);
+
+    // The objects of the previous account are dropped when the secret key changes.
+    QCOMPARE(ObjectCache::count(), 1);
+    Stripe::setSecretKey("sk_test_other");
+    QCOMPARE(ObjectCache::count(), 0);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <QObject>
+
+class ObjectCacheTests : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ObjectCacheTests(QObject *parent = nullptr);
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testObjectCache();
+    void testCacheAccount();
+
+private:
+    QString m_ApiBaseUrl, m_SecretKey;
+    bool m_IsCacheEnabled;
+    int m_CacheMaxEntries;
+};
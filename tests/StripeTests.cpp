@@ -2,6 +2,8 @@
 #include <QtTest/QtTest>
 #include <QSignalSpy>
 #include <QDebug>
+// Tests
+#include "LocalServer.h"
 // QStripe
 #include "QStripe/Customer.h"
 #include "QStripe/Stripe.h"
@@ -13,10 +15,25 @@ StripeTests::StripeTests(QString customerID, QString cardID, QObject *parent)
     : QObject(parent)
     , m_CustomerID(customerID)
     , m_CardID(cardID)
+    , m_ApiBaseUrl()
+    , m_SecretKey()
 {
 
 }
 
+void StripeTests::init()
+{
+    // Some of the tests point the library to a LocalServer.
+    m_ApiBaseUrl = Stripe::apiBaseUrl();
+    m_SecretKey = Stripe::secretKey();
+}
+
+void StripeTests::cleanup()
+{
+    Stripe::setApiBaseUrl(m_ApiBaseUrl);
+    Stripe::setSecretKey(m_SecretKey);
+}
+
 void StripeTests::testFetchCustomer()
 {
     if (m_CustomerID.length() == 0) {
@@ -62,3 +79,34 @@ void StripeTests::testFetchCard()
 //        QCOMPARE(card->cardID(), m_CardID);
 //    }
 }
+
+void StripeTests::testFetchCustomers()
+{
+    LocalServer server;
+    server.enqueueReply(404, "{\"error\": {\"type\": \"invalid_request_error\", \"message\": \"No such customer\"}}");
+
+    Stripe::setApiBaseUrl(server.url("/v1"));
+    Stripe::setSecretKey("sk_test_local");
+
+    Stripe stripe;
+    stripe.setMaxConcurrentRequests(2);
+    QSignalSpy progressSpy(&stripe, &Stripe::customersFetchProgress);
+    QSignalSpy fetchedSpy(&stripe, &Stripe::customersFetched);
+
+    QVERIFY(stripe.fetchCustomers({"cus_1", "cus_2", "", "cus_3", "cus_2", "cus_4", "cus_5"}));
+    QVERIFY(stripe.fetchingCustomers());
+    QCOMPARE(stripe.fetchCustomers({"cus_6"}), false);
+    // The batch errors are not reported through lastError().
+    QCOMPARE(stripe.lastError()->type(), Error::ErrorNone);
+
+    QTRY_COMPARE(fetchedSpy.count(), 1);
+    QCOMPARE(progressSpy.count(), 5);
+    QCOMPARE(stripe.fetchingCustomers(), false);
+    QCOMPARE(server.requests().size(), 5);
+
+    const QVariantList customers = fetchedSpy.at(0).at(0).toList();
+    const QVariantMap errors = fetchedSpy.at(0).at(1).toMap();
+    QCOMPARE(customers.size(), 4);
+    QCOMPARE(errors.size(), 1);
+    QCOMPARE(errors.first().value<Error *>()->type(), Error::ErrorInvalidRequest);
+}
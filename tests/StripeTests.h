@@ -8,9 +8,14 @@ public:
     explicit StripeTests(QString customerID, QString cardID, QObject *parent = nullptr);
 
 private slots:
+    void init();
+    void cleanup();
+
     void testFetchCustomer();
     void testFetchCard();
+    void testFetchCustomers();
 
 private:
     QString m_CustomerID, m_CardID;
+    QString m_ApiBaseUrl, m_SecretKey;
 };
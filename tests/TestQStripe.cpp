@@ -2,11 +2,16 @@
 #include <QSignalSpy>
 // Tests
 #include "ShippingInformationTests.h"
+#include "NetworkTransportTests.h"
+#include "NetworkUtilsTests.h"
+#include "ListIteratorTests.h"
+#include "ObjectCacheTests.h"
 #include "CustomerTests.h"
 #include "AddressTests.h"
 #include "TestQStripe.h"
 #include "StripeTests.h"
 #include "TokenTests.h"
+#include "UtilsTests.h"
 #include "ErrorTests.h"
 #include "CardTests.h"
 // QStripe
@@ -33,10 +38,20 @@ int main(int argc, char *argv[])
     CustomerTests customerTests;
     TokenTests tokenTests;
     ErrorTests errorTests;
+    NetworkUtilsTests networkTests;
+    NetworkTransportTests transportTests;
+    ListIteratorTests listIteratorTests;
+    ObjectCacheTests objectCacheTests;
+    UtilsTests utilsTests;
 
     int status = 0;
     // The order of the tests is important.
     status |= QTest::qExec(&ts, argc, argv);
+    status |= QTest::qExec(&networkTests, argc, argv);
+    status |= QTest::qExec(&transportTests, argc, argv);
+    status |= QTest::qExec(&listIteratorTests, argc, argv);
+    status |= QTest::qExec(&objectCacheTests, argc, argv);
+    status |= QTest::qExec(&utilsTests, argc, argv);
     status |= QTest::qExec(&addressTests, argc, argv);
     status |= QTest::qExec(&shippingTests, argc, argv);
     status |= QTest::qExec(&customerTests, argc, argv);
@@ -0,0 +1,78 @@
+#include "UtilsTests.h"
+#include <QtTest/QtTest>
+#include <QUrlQuery>
+// QStripe
+#include "QStripe/Utils.h"
+
+using namespace QStripe;
+
+UtilsTests::UtilsTests(QObject *parent)
+    : QObject(parent)
+{
+
+}
+
+void UtilsTests::testFormData()
+{
+    QVariantMap address;
+    address["line1"] = "1 Main St";
+    QVariantMap shipping;
+    shipping["name"] = "Jane+Doe";
+    shipping["address"] = address;
+
+    QVariantMap item;
+    item["plan"] = "gold";
+
+    QVariantMap data;
+    data["email"] = "jane@example.com";
+    data["shipping"] = shipping;
+    data["expand"] = QStringList({"customer", "invoice"});
+    data["items"] = QVariantList({item});
+    data["metadata[order]"] = 12;
+    data["livemode"] = false;
+
+    const QByteArray expected = "email=jane%40example.com&expand[]=customer&expand[]=invoice&items[0][plan]=gold&livemode=false&metadata[order]=12"
+                                "&shipping[address][line1]=1+Main+St&shipping[name]=Jane%2BDoe";
+    QCOMPARE(Utils::toFormData(data), expected);
+    QCOMPARE(Utils::toFormData(QVariantMap()), QByteArray());
+}
+
+void UtilsTests::benchmarkFormEncoding_data()
+{
+    QTest::addColumn<bool>("useUrlQuery");
+    QTest::newRow("QUrlQuery") << true;
+    QTest::newRow("toFormData") << false;
+}
+
+void UtilsTests::benchmarkFormEncoding()
+{
+    QFETCH(bool, useUrlQuery);
+
+    // A card token request with a billing address and metadata.
+    QVariantMap data;
+    data["currency"] = "usd";
+    for (const QString &field : {"number", "cvc", "exp_month", "exp_year", "name", "address_line1", "address_city", "address_zip", "address_country"}) {
+        data["card[" + field + "]"] = "value of " + field;
+    }
+
+    for (int index = 0; index < 10; index++) {
+        data["metadata[key_" + QString::number(index) + "]"] = "metadata value " + QString::number(index);
+    }
+
+    QByteArray body;
+    QBENCHMARK {
+        if (useUrlQuery) {
+            QUrlQuery query;
+            for (auto it = data.constBegin(); it != data.constEnd(); it++) {
+                query.addQueryItem(it.key(), it.value().toString());
+            }
+
+            body = query.toString(QUrl::FullyEncoded).toUtf8();
+        }
+        else {
+            body = Utils::toFormData(data);
+        }
+    }
+
+    QVERIFY(body.size() > 0);
+}
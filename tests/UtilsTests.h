@@ -0,0 +1,15 @@
+#pragma once
+#include <QObject>
+
+class UtilsTests : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UtilsTests(QObject *parent = nullptr);
+
+private slots:
+    void testFormData();
+    void benchmarkFormEncoding_data();
+    void benchmarkFormEncoding();
+};
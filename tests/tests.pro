@@ -10,7 +10,13 @@ SOURCES += \
     CardTests.cpp \
     TokenTests.cpp \
     ErrorTests.cpp \
-    StripeTests.cpp
+    StripeTests.cpp \
+    NetworkUtilsTests.cpp \
+    NetworkTransportTests.cpp \
+    ListIteratorTests.cpp \
+    ObjectCacheTests.cpp \
+    UtilsTests.cpp \
+    LocalServer.cpp
 
 HEADERS += \
     TestQStripe.h \
@@ -20,7 +26,13 @@ HEADERS += \
     CardTests.h \
     TokenTests.h \
     ErrorTests.h \
-    StripeTests.h
+    StripeTests.h \
+    NetworkUtilsTests.h \
+    NetworkTransportTests.h \
+    ListIteratorTests.h \
+    ObjectCacheTests.h \
+    UtilsTests.h \
+    LocalServer.h
 
 include(../qstripe.pri)
 